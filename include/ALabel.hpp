@@ -4,7 +4,11 @@
 #include <gtkmm/label.h>
 #include <json/json.h>
 
+#include <unordered_map>
+
 #include "AModule.hpp"
+#include "util/cached_label.hpp"
+#include "util/format_template.hpp"
 
 namespace waybar {
 
@@ -13,24 +17,40 @@ class ALabel : public AModule {
   ALabel(const Json::Value &, const std::string &, const std::string &, const std::string &format,
          uint16_t interval = 0, bool ellipsize = false, bool enable_click = false,
          bool enable_scroll = false);
-  virtual ~ALabel() = default;
+  virtual ~ALabel();
   auto update() -> void override;
   virtual std::string getIcon(uint16_t, const std::string &alt = "", uint16_t max = 0);
   virtual std::string getIcon(uint16_t, const std::vector<std::string> &alts, uint16_t max = 0);
 
  protected:
-  Gtk::Label label_;
+  util::CachedLabel label_;
   std::string format_;
   const std::chrono::milliseconds interval_;
+  // Wake up on wall clock multiples of interval_, together with the other aligned modules
+  const bool interval_align_;
   bool alt_ = false;
   std::string default_format_;
 
   bool handleToggle(GdkEventButton *const &e) override;
   virtual std::string getState(uint8_t value, bool lesser = false);
+  // Parsed once per distinct format string
+  const util::FormatTemplate &compiledFormat(const std::string &format);
+  // "format-<state>" when configured, format_ otherwise
+  const util::FormatTemplate &stateFormat(const std::string &state);
+  // Requests an update() from a polling thread, batched per tick when interval_align_ is set
+  void emitUpdate();
 
   std::map<std::string, GtkMenuItem *> submenus_;
   std::map<std::string, std::string> menuActionsMap_;
   static void handleGtkMenuEvent(GtkMenuItem *menuitem, gpointer data);
+
+ private:
+  std::unordered_map<std::string, util::FormatTemplate> compiled_formats_;
+  std::unordered_map<std::string, util::FormatTemplate> state_formats_;
+  // "states" from the config, sorted by decreasing value
+  std::vector<std::pair<std::string, uint8_t>> states_;
+  std::string current_state_;
+  std::chrono::steady_clock::time_point label_stats_since_ = std::chrono::steady_clock::now();
 };
 
 }  // namespace waybar
@@ -2,18 +2,20 @@
 
 #include <fmt/format.h>
 
-#include <filesystem>
-#if defined(__linux__)
-#include <sys/inotify.h>
-#endif
-
 #include <algorithm>
+#include <atomic>
+#include <filesystem>
 #include <fstream>
+#include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "ALabel.hpp"
 #include "bar.hpp"
+#include "util/procfs.hpp"
+#include "util/scheduler.hpp"
 #include "util/sleeper_thread.hpp"
 
 namespace waybar::modules {
@@ -31,17 +33,20 @@ class Battery : public ALabel {
 
   void refreshBatteries();
   void worker();
-  const std::string getAdapterStatus(uint8_t capacity) const;
+  void handleUevent(std::string_view message);
+  const std::string getAdapterStatus(uint8_t capacity);
   std::tuple<uint8_t, float, std::string, float, uint16_t, float> getInfos();
   const std::string formatTimeRemaining(float hoursRemaining);
   void setBarClass(std::string&);
   void processEvents(std::string& state, std::string& status, uint8_t capacity);
 
-  int global_watch;
-  std::map<fs::path, int> batteries_;
+  // The uevent file of each battery, holding all of its attributes, kept open across reads
+  std::map<fs::path, std::unique_ptr<util::procfs::File>> batteries_;
   fs::path adapter_;
-  int battery_watch_fd_;
-  int global_watch_fd_;
+  std::unique_ptr<util::procfs::File> adapter_uevent_;
+  // Kernel uevents socket, telling when power supplies change or come and go
+  int uevent_fd_{-1};
+  std::atomic<bool> uevents_{false};
   std::mutex battery_list_mutex_;
   std::string old_status_;
   std::string last_event_;
@@ -49,8 +54,7 @@ class Battery : public ALabel {
   const Bar& bar_;
 
   util::SleeperThread thread_;
-  util::SleeperThread thread_battery_update_;
-  util::SleeperThread thread_timer_;
+  util::ScheduledTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -4,13 +4,14 @@
 
 #include <cstdint>
 #include <fstream>
+#include <memory>
 #include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules {
 
@@ -21,9 +22,9 @@ class Cpu : public ALabel {
   auto update() -> void override;
 
  private:
-  std::vector<std::tuple<size_t, size_t>> prev_times_;
+  std::shared_ptr<const std::vector<std::tuple<size_t, size_t>>> prev_times_;
 
-  util::SleeperThread thread_;
+  util::ScheduledTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -10,7 +10,7 @@
 #include <vector>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules {
 
@@ -21,12 +21,13 @@ class CpuFrequency : public ALabel {
   auto update() -> void override;
 
   // This is a static member because it is also used by the cpu module.
-  static std::tuple<float, float, float> getCpuFrequency();
+  // Frequencies are sampled once for every module instance, max_age is how stale they may be.
+  static std::tuple<float, float, float> getCpuFrequency(std::chrono::milliseconds max_age);
 
  private:
   static std::vector<float> parseCpuFrequencies();
 
-  util::SleeperThread thread_;
+  util::ScheduledTask timer_;
 };
 
 }  // namespace waybar::modules
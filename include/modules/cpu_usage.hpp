@@ -4,13 +4,16 @@
 
 #include <cstdint>
 #include <fstream>
+#include <memory>
 #include <numeric>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules {
 
@@ -20,16 +23,23 @@ class CpuUsage : public ALabel {
   virtual ~CpuUsage() = default;
   auto update() -> void override;
 
+  // (idle, total) times of the whole system, then of each core
+  using CpuTimes = std::vector<std::tuple<size_t, size_t>>;
+
   // This is a static member because it is also used by the cpu module.
+  // Times are sampled once for every module instance, max_age is how stale they may be.
   static std::tuple<std::vector<uint16_t>, std::string> getCpuUsage(
-      std::vector<std::tuple<size_t, size_t>>&);
+      std::shared_ptr<const CpuTimes>& prev_times, std::chrono::milliseconds max_age);
+  // Index in the getCpuUsage() vector of the "<prefix><core>" format field, if that core exists
+  static std::optional<size_t> coreIndex(std::string_view field, std::string_view prefix,
+                                         const std::vector<uint16_t>& usage);
 
  private:
-  static std::vector<std::tuple<size_t, size_t>> parseCpuinfo();
+  static CpuTimes parseCpuinfo();
 
-  std::vector<std::tuple<size_t, size_t>> prev_times_;
+  std::shared_ptr<const CpuTimes> prev_times_;
 
-  util::SleeperThread thread_;
+  util::ScheduledTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -2,16 +2,95 @@
 
 #include <fmt/format.h>
 
+#include <atomic>
+#include <chrono>
 #include <csignal>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "ALabel.hpp"
 #include "util/command.hpp"
 #include "util/json.hpp"
+#include "util/line_reader.hpp"
+#include "util/scheduler.hpp"
 #include "util/sleeper_thread.hpp"
 
 namespace waybar::modules {
 
+/**
+ * Runs the "exec" command of a custom module and passes its output on: every "interval", on
+ * signals and events only, or line by line when the command runs continuously.
+ * With "shared", the instances of a module on every bar get the same runner, so the command runs
+ * once for all of them.
+ */
+class CustomRunner {
+ public:
+  using Callback = std::function<void(const util::command::res&)>;
+
+  CustomRunner(const std::string& name, const Json::Value& config,
+               std::chrono::milliseconds interval, const std::string& output_name);
+  ~CustomRunner();
+
+  /// The runner of every module running the same command, WAYBAR_OUTPUT_NAME isn't set for it
+  static std::shared_ptr<CustomRunner> shared(const std::string& name, const Json::Value& config,
+                                              std::chrono::milliseconds interval);
+
+  /// The callback gets the last output right away if there is one
+  uint64_t subscribe(Callback callback);
+  /// No callback runs for the subscription once this returns
+  void unsubscribe(uint64_t id);
+  /// Runs the command again, once `children` (the module's actions) exited
+  void wake_up(std::vector<int> children = {});
+
+ private:
+  void delayWorker();
+  void continuousWorker();
+  void waitingWorker();
+  void waitChildren();
+  void run();
+  void handleContinuous();
+  void readContinuous(int fd);
+  void publish(const util::command::res& output);
+
+  const std::string name_;
+  const Json::Value config_;
+  const std::chrono::milliseconds interval_;
+  const std::string output_name_;
+  // Run the commands without /bin/sh when they don't need it
+  const bool exec_direct_;
+  bool continuous_ = false;
+  int pid_ = -1;
+
+  std::mutex subscribers_mutex_;
+  uint64_t next_id_ = 1;
+  std::map<uint64_t, Callback> subscribers_;
+  std::optional<util::command::res> last_;
+
+  // Waited for before the next run
+  std::mutex children_mutex_;
+  std::vector<int> children_;
+
+  util::SleeperThread thread_;
+
+  // Continuous "exec": its output is read by the shared LineReader, the task reaps the command
+  // once the output ended and restarts it after "restart-interval"
+  std::mutex continuous_mutex_;
+  int pending_fd_ = -1;
+  bool continuous_stopped_ = false;
+  std::atomic<bool> stream_ended_ = false;
+  // Until the command exits once its output ended
+  static constexpr std::chrono::milliseconds MIN_REAP_DELAY{10};
+  static constexpr std::chrono::milliseconds MAX_REAP_DELAY{1000};
+  std::chrono::milliseconds reap_delay_ = MIN_REAP_DELAY;
+  util::LineStream stream_;
+  util::ScheduledTask continuous_task_;
+};
+
 class Custom : public ALabel {
  public:
   Custom(const std::string&, const std::string&, const Json::Value&, const std::string&);
@@ -20,17 +99,16 @@ class Custom : public ALabel {
   void refresh(int /*signal*/) override;
 
  private:
-  void delayWorker();
-  void continuousWorker();
-  void waitingWorker();
   void parseOutputRaw();
   void parseOutputJson();
+  void parseOutputTsv();
   void handleEvent();
   bool handleScroll(GdkEventScroll* e) override;
   bool handleToggle(GdkEventButton* const& e) override;
 
   const std::string name_;
   const std::string output_name_;
+  const std::string return_type_;
   std::string text_;
   std::string id_;
   std::string alt_;
@@ -38,12 +116,11 @@ class Custom : public ALabel {
   const bool tooltip_format_enabled_;
   std::vector<std::string> class_;
   int percentage_;
-  FILE* fp_;
-  int pid_;
   util::command::res output_;
   util::JsonParser parser_;
 
-  util::SleeperThread thread_;
+  std::shared_ptr<CustomRunner> runner_;
+  uint64_t subscription_ = 0;
 };
 
 }  // namespace waybar::modules
@@ -8,6 +8,7 @@
 #include "bar.hpp"
 #include "dwl-ipc-unstable-v2-client-protocol.h"
 #include "util/json.hpp"
+#include "util/rewrite_string.hpp"
 
 namespace waybar::modules::dwl {
 
@@ -31,6 +32,7 @@ class Window : public AAppIconLabel, public sigc::trackable {
   std::string appid_;
   std::string layout_symbol_;
   uint32_t layout_;
+  util::RewriteRules rewrite_rules_;
 
   struct zdwl_ipc_output_v2 *output_status_;
 };
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <future>
 #include <list>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "modules/hyprland/state.hpp"
 #include "util/json.hpp"
 
 namespace waybar::modules::hyprland {
@@ -30,21 +38,51 @@ class IPC {
   void registerForIPC(const std::string& ev, EventHandler* ev_handler);
   void unregisterForIPC(EventHandler* handler);
 
+  /// Parsed reply, shared with the other callers until the next event. Never null.
+  using JsonReply = std::shared_ptr<const Json::Value>;
+
   static std::string getSocket1Reply(const std::string& rq);
-  Json::Value getSocket1JsonReply(const std::string& rq);
+  JsonReply getSocket1JsonReply(const std::string& rq);
+  /// Sends the queries as one [[BATCH]] request and returns the replies in the same order
+  std::vector<JsonReply> getSocket1JsonReplies(const std::vector<std::string>& rqs);
   static std::filesystem::path getSocketFolder(const char* instanceSig);
+  /// Model of the compositor state, up to date with the events already dispatched. Loaded on
+  /// first use if the event socket isn't connected yet.
+  const State& state();
 
  protected:
   static std::filesystem::path socketFolder_;
+  // Splits the reply of a [[BATCH]] request, empty if it doesn't hold `count` replies
+  static std::vector<std::string> splitBatchReply(const std::string& reply, size_t count);
 
  private:
   void socketListener();
   void parseIPC(const std::string&);
+  // Rebuilds state_ from full queries, unless it was already loaded and `force` isn't set
+  void resyncState(bool force = true);
+  // Shares the reply of a query already in flight, from another module or bar, with the caller.
+  // Only queries sent since the event that started `generation` are shared.
+  std::string getCoalescedReply(const std::string& rq, uint64_t generation);
+  JsonReply getCachedReply(const std::string& rq, uint64_t generation);
+  void cacheReply(const std::string& rq, uint64_t generation, JsonReply value);
 
   std::thread ipcThread_;
   std::mutex callbackMutex_;
   util::JsonParser parser_;
   std::list<std::pair<std::string, EventHandler*>> callbacks_;
+  std::mutex inflightMutex_;
+  std::map<std::pair<std::string, uint64_t>, std::shared_future<std::string>> inflight_;
+  // Parsed state queries, valid until the next socket2 event bumps generation_
+  struct CachedReply {
+    uint64_t generation = 0;
+    JsonReply value;
+  };
+  std::atomic<uint64_t> generation_ = 0;
+  std::mutex cacheMutex_;
+  std::unordered_map<std::string, CachedReply> cache_;
+  State state_;
+  std::mutex resyncMutex_;
+  std::atomic<bool> stateLoaded_ = false;  // Set once a load was attempted, even a failed one
   int socketfd_;  // the hyprland socket file descriptor
   pid_t socketOwnerPid_;
   bool running_ = true;  // the ipcThread will stop running when this is false
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <json/value.h>
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace waybar::modules::hyprland {
+
+/**
+ * In-memory model of Hyprland's monitors, workspaces and windows.
+ *
+ * It is filled once from the socket1 queries, then kept up to date by applying each socket2 event
+ * as a delta, so modules can look up a window or workspace in constant time instead of fetching
+ * and scanning full `clients`/`workspaces` dumps. The IPC thread applies the events; the
+ * accessors can be used from any thread and return JSON shaped like Hyprland's own replies.
+ * Only the fields that events keep track of are modelled: the windows are the mapped ones, without
+ * "mapped" or "hidden" fields.
+ */
+class State {
+ public:
+  /// Replaces the whole model with the replies of the matching queries
+  void reset(const Json::Value& monitors, const Json::Value& workspaces, const Json::Value& clients,
+             const Json::Value& activeWindow);
+  /// Applies a socket2 event, returns false if the event isn't part of the model
+  bool apply(std::string_view event, std::string_view payload);
+
+  std::optional<Json::Value> client(std::string_view address) const;
+  Json::Value clients() const;
+  /// Clients on the workspace `workspace`
+  Json::Value clients(int workspace) const;
+  Json::Value workspaces() const;
+  /// Workspace named `name`, "special:" prefix included
+  std::optional<Json::Value> workspace(std::string_view name) const;
+  Json::Value monitors() const;
+  std::optional<Json::Value> monitor(const std::string& name) const;
+  /// Active workspace of the focused monitor, or of `monitor`
+  Json::Value activeWorkspace(const std::string& monitor = "") const;
+
+ private:
+  struct Window {
+    std::string address;  // Without the 0x prefix, as in events
+    int workspace = 0;
+    std::string windowClass;
+    std::string title;
+    std::string initialClass;
+    std::string initialTitle;
+    bool floating = false;
+    bool fullscreen = false;
+  };
+  struct Workspace {
+    int id = 0;
+    std::string name;
+    std::string monitor;
+    int windows = 0;
+    int fullscreenWindows = 0;
+    std::string lastWindow;
+    std::string lastWindowTitle;
+  };
+  struct Monitor {
+    int id = 0;
+    std::string name;
+    int activeWorkspace = 0;
+    int specialWorkspace = 0;
+  };
+
+  Workspace* findWorkspace(int id);
+  Workspace* findWorkspace(std::string_view name);
+  void addWindow(Window window);
+  void removeWindow(const std::string& address);
+  void moveWindow(Window& window, int workspace);
+  void removeWorkspace(int id);
+
+  Json::Value toJson(const Window& window) const;
+  Json::Value toJson(const Workspace& workspace) const;
+  Json::Value toJson(const Monitor& monitor) const;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Window> windows_;
+  std::unordered_map<int, Workspace> workspaces_;
+  std::unordered_map<std::string, int> workspaceIds_;  // By name
+  std::unordered_map<std::string, Monitor> monitors_;
+  std::string focusedMonitor_;
+  std::string activeWindow_;
+};
+
+}  // namespace waybar::modules::hyprland
@@ -8,6 +8,7 @@
 #include "bar.hpp"
 #include "modules/hyprland/backend.hpp"
 #include "util/json.hpp"
+#include "util/rewrite_string.hpp"
 
 namespace waybar::modules::hyprland {
 
@@ -51,6 +52,7 @@ class Window : public waybar::AAppIconLabel, public EventHandler {
   std::mutex mutex_;
   const Bar& bar_;
   util::JsonParser parser_;
+  util::RewriteRules rewriteRules_;
   WindowData windowData_;
   Workspace workspace_;
   std::string soloClass_;
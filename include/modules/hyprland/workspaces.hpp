@@ -138,7 +138,7 @@ class Workspaces : public AModule, public EventHandler {
   void doUpdate();
   void removeWorkspacesToRemove();
   void createWorkspacesToCreate();
-  static std::vector<int> getVisibleWorkspaces();
+  static std::vector<int> getVisibleWorkspaces(const Json::Value& monitors);
   void updateWorkspaceStates();
   bool updateWindowsToCreate();
 
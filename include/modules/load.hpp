@@ -10,7 +10,7 @@
 #include <vector>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules {
 
@@ -21,10 +21,13 @@ class Load : public ALabel {
   auto update() -> void override;
 
   // This is a static member because it is also used by the cpu module.
-  static std::tuple<double, double, double> getLoad();
+  // The load is sampled once for every module instance, max_age is how stale it may be.
+  static std::tuple<double, double, double> getLoad(std::chrono::milliseconds max_age);
 
  private:
-  util::SleeperThread thread_;
+  static std::tuple<double, double, double> readLoad();
+
+  util::ScheduledTask timer_;
 };
 
 }  // namespace waybar::modules
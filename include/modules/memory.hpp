@@ -3,10 +3,9 @@
 #include <fmt/format.h>
 
 #include <fstream>
-#include <unordered_map>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules {
 
@@ -17,11 +16,24 @@ class Memory : public ALabel {
   auto update() -> void override;
 
  private:
-  void parseMeminfo();
-
-  std::unordered_map<std::string, unsigned long> meminfo_;
-
-  util::SleeperThread thread_;
+  // Fields of /proc/meminfo we use, in kB
+  struct Meminfo {
+    unsigned long mem_total = 0;
+    unsigned long mem_free = 0;
+    unsigned long mem_available = 0;
+    bool has_mem_available = false;
+    unsigned long buffers = 0;
+    unsigned long cached = 0;
+    unsigned long sreclaimable = 0;
+    unsigned long shmem = 0;
+    unsigned long swap_total = 0;
+    unsigned long swap_free = 0;
+    unsigned long zfs_size = 0;
+  };
+
+  static Meminfo parseMeminfo();
+
+  util::ScheduledTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -8,10 +8,16 @@
 #include <netlink/netlink.h>
 #include <sys/epoll.h>
 
+#include <atomic>
+#include <chrono>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "ALabel.hpp"
+#include "util/procfs.hpp"
+#include "util/scheduler.hpp"
 #include "util/sleeper_thread.hpp"
 #ifdef WANT_RFKILL
 #include "util/rfkill.hpp"
@@ -34,6 +40,7 @@ class Network : public ALabel {
   static int handleEvents(struct nl_msg*, void*);
   static int handleEventsDone(struct nl_msg*, void*);
   static int handleScan(struct nl_msg*, void*);
+  static int handleStats(struct nl_msg*, void*);
 
   void askForStateDump(void);
 
@@ -45,18 +52,24 @@ class Network : public ALabel {
   void parseFreq(struct nlattr**);
   void parseBssid(struct nlattr**);
   bool associatedOrJoined(struct nlattr**);
-  bool matchInterface(const std::string& ifname, const std::vector<std::string>& altnames,
-                      std::string& matched) const;
+  bool matchInterface(std::string_view ifname) const;
+  void requestUpdate();
   auto getInfo() -> void;
   const std::string getNetworkState() const;
   void clearIface();
   std::optional<std::pair<unsigned long long, unsigned long long>> readBandwidthUsage();
+  void sampleBandwidth();
 
   int ifid_{-1};
+  // "interface", when configured
+  std::optional<std::string> interface_pattern_;
+  std::atomic<bool> update_pending_{false};
   ip_addr_pref addr_pref_{ip_addr_pref::IPV4};
   struct sockaddr_nl nladdr_{0};
   struct nl_sock* sock_{nullptr};
   struct nl_sock* ev_sock_{nullptr};
+  // Synchronous RTM_GETLINK requests for the interface counters
+  struct nl_sock* stats_sock_{nullptr};
   int efd_{-1};
   int ev_fd_{-1};
   int nl80211_id_{-1};
@@ -68,8 +81,21 @@ class Network : public ALabel {
   bool dump_in_progress_{false};
   bool is_p2p_{false};
 
+  // Only read when the statistics can't be requested over netlink
+  util::procfs::File netdev_{"/proc/net/dev"};
+  std::optional<std::pair<unsigned long long, unsigned long long>> stats_reply_;
+  // Interface whose counters are the totals, -1 until they are read
+  int bandwidth_ifid_{-1};
+  std::chrono::steady_clock::time_point bandwidth_time_;
   unsigned long long bandwidth_down_total_{0};
   unsigned long long bandwidth_up_total_{0};
+  // Bytes per second, smoothed by bandwidth_smoothing_ (weight of the previous rate)
+  double bandwidth_down_rate_{0};
+  double bandwidth_up_rate_{0};
+  bool bandwidth_rate_valid_{false};
+  double bandwidth_smoothing_{0};
+  // Sampling independently of the updates, disabled when zero
+  std::chrono::milliseconds bandwidth_interval_{0};
 
   std::string state_;
   std::string essid_;
@@ -89,7 +115,8 @@ class Network : public ALabel {
   uint32_t route_priority;
 
   util::SleeperThread thread_;
-  util::SleeperThread thread_timer_;
+  util::ScheduledTask timer_;
+  util::ScheduledTask bandwidth_timer_;
 #ifdef WANT_RFKILL
   util::Rfkill rfkill_{RFKILL_TYPE_WLAN};
 #endif
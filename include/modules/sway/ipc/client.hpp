@@ -1,21 +1,35 @@
 #pragma once
 
+#include <json/value.h>
 #include <sigc++/sigc++.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <cstring>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "ipc.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/debouncer.hpp"
 
 namespace waybar::modules::sway {
 
+/**
+ * Sway IPC client of a module.
+ *
+ * All the clients share the connections of IpcHub: signal_event is emitted from the hub's event
+ * thread for the events this client subscribed to, signal_cmd from the thread calling sendCmd.
+ */
 class Ipc {
  public:
   Ipc();
@@ -31,23 +45,75 @@ class Ipc {
   sigc::signal<void, const struct ipc_response &> signal_cmd;
 
   void sendCmd(uint32_t type, const std::string &payload = "");
+  /// Subscribes to a JSON array of event names, e.g. ["window","workspace"]
   void subscribe(const std::string &payload);
-  void handleEvent();
-  void setWorker(std::function<void()> &&func);
+};
+
+/**
+ * Debouncer for the tree refreshes following events, so a burst of events (e.g. switching to a
+ * workspace with many windows) costs a single GET_TREE and update. Its delay and upper bound come
+ * from the module's "event-debounce" and "event-max-latency" (milliseconds).
+ */
+util::Debouncer makeRefreshDebouncer(const Json::Value &config, std::function<void()> refresh);
+
+/**
+ * Process-wide Sway IPC connection, shared by the modules of every bar.
+ *
+ * It holds one socket subscribed to the union of the clients' events, read by a single thread
+ * that fans them out, and one socket for the commands. GET_TREE and GET_WORKSPACES replies are
+ * shared by all the clients until the next event, so the modules refreshing on the same event
+ * cost one round trip.
+ */
+class IpcHub {
+ public:
+  static IpcHub &inst();
+  ~IpcHub();
+
+  void addClient(Ipc *client);
+  void removeClient(Ipc *client);
+  void subscribe(Ipc *client, const std::string &payload);
+  Ipc::ipc_response sendCmd(uint32_t type, const std::string &payload);
 
  protected:
+  IpcHub();  // use IpcHub::inst() instead
+
+ private:
   static inline const std::string ipc_magic_ = "i3-ipc";
   static inline const size_t ipc_header_size_ = ipc_magic_.size() + 8;
 
   const std::string getSocketPath() const;
   int open(const std::string &) const;
-  struct ipc_response send(int fd, uint32_t type, const std::string &payload = "");
-  struct ipc_response recv(int fd);
+  void write(int fd, uint32_t type, const std::string &payload);
+  struct Ipc::ipc_response send(int fd, uint32_t type, const std::string &payload = "");
+  struct Ipc::ipc_response recv(int fd);
+  void eventListener();
+  void dispatch(const Ipc::ipc_response &event);
+  // Whether the subscribed events invalidate the reply of `type`
+  bool isCacheable(uint32_t type, const std::string &payload) const;
 
   int fd_;
   int fd_event_;
-  std::mutex mutex_;
-  util::SleeperThread thread_;
+  pid_t socketOwnerPid_;
+  std::atomic<bool> running_ = true;
+  std::thread thread_;
+
+  std::mutex mutex_;  // Commands
+  struct CachedReply {
+    uint64_t generation;
+    Ipc::ipc_response response;
+  };
+  std::unordered_map<uint32_t, CachedReply> cache_;
+  // Bumped by every event, replies of an older generation are stale
+  std::atomic<uint64_t> generation_ = 0;
+
+  std::mutex subscribeMutex_;
+  std::atomic<uint32_t> subscribed_ = 0;  // event_mask() of the events of fd_event_
+  // The reply to a subscription arrives on fd_event_, the event thread hands it over
+  std::mutex replyMutex_;
+  std::optional<std::promise<Ipc::ipc_response>> subscribeReply_;
+
+  std::mutex clientsMutex_;
+  std::vector<std::pair<Ipc *, uint32_t>> clients_;  // With the event_mask() of their events
 };
 
 }  // namespace waybar::modules::sway
@@ -2,6 +2,7 @@
 
 #include <fmt/format.h>
 
+#include <chrono>
 #include <tuple>
 
 #include "AAppIconLabel.hpp"
@@ -9,13 +10,14 @@
 #include "client.hpp"
 #include "modules/sway/ipc/client.hpp"
 #include "util/json.hpp"
+#include "util/rewrite_string.hpp"
 
 namespace waybar::modules::sway {
 
 class Window : public AAppIconLabel, public sigc::trackable {
  public:
   Window(const std::string&, const waybar::Bar&, const Json::Value&);
-  virtual ~Window() = default;
+  virtual ~Window();
   auto update() -> void override;
 
  private:
@@ -38,8 +40,12 @@ class Window : public AAppIconLabel, public sigc::trackable {
   std::string shell_;
   std::string marks_;
   int floating_count_;
+  util::RewriteRules rewrite_rules_;
   util::JsonParser parser_;
   std::mutex mutex_;
+  // Stopped by the destructor, ipc_ is destroyed first and can't trigger it anymore
+  util::Debouncer refresh_;
+  std::chrono::steady_clock::time_point refresh_stats_since_;
   Ipc ipc_;
 };
 
@@ -4,6 +4,8 @@
 #include <gtkmm/button.h>
 #include <gtkmm/label.h>
 
+#include <chrono>
+#include <optional>
 #include <string_view>
 #include <unordered_map>
 
@@ -19,7 +21,7 @@ namespace waybar::modules::sway {
 class Workspaces : public AModule, public sigc::trackable {
  public:
   Workspaces(const std::string&, const waybar::Bar&, const Json::Value&);
-  ~Workspaces() override = default;
+  ~Workspaces() override;
   auto update() -> void override;
 
  private:
@@ -32,11 +34,13 @@ class Workspaces : public AModule, public sigc::trackable {
 
   void onCmd(const struct Ipc::ipc_response&);
   void onEvent(const struct Ipc::ipc_response&);
+  void refreshTree();
   bool filterButtons();
   static bool hasFlag(const Json::Value&, const std::string&);
   void updateWindows(const Json::Value&, std::string&);
   Gtk::Button& addButton(const Json::Value&);
   void onButtonReady(const Json::Value&, Gtk::Button&);
+  uint8_t buttonClasses(const Json::Value&) const;
   std::string getIcon(const std::string&, const Json::Value&);
   std::string getCycleWorkspace(std::vector<Json::Value>::iterator, bool prev) const;
   uint16_t getWorkspaceIndex(const std::string& name) const;
@@ -52,7 +56,18 @@ class Workspaces : public AModule, public sigc::trackable {
   util::RegexCollection m_windowRewriteRules;
   util::JsonParser parser_;
   std::unordered_map<std::string, Gtk::Button> buttons_;
+  // What was last applied to each button, so updates only touch the widgets that changed
+  struct ButtonState {
+    Json::Value node;  // The workspace the label and classes were computed from
+    std::optional<std::string> label;  // Unset until the first update formats it
+    uint8_t classes = 0;  // Bits of the classes in buttonClasses()
+    int position = -1;
+  };
+  std::unordered_map<std::string, ButtonState> button_states_;
   std::mutex mutex_;
+  // Stopped by the destructor, ipc_ is destroyed first and can't trigger it anymore
+  util::Debouncer refresh_;
+  std::chrono::steady_clock::time_point refresh_stats_since_;
   Ipc ipc_;
 };
 
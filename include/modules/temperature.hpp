@@ -2,10 +2,14 @@
 
 #include <fmt/format.h>
 
+#include <atomic>
+#include <cstdint>
 #include <fstream>
+#include <limits>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
+#include "util/sensor.hpp"
 
 namespace waybar::modules {
 
@@ -21,7 +25,11 @@ class Temperature : public ALabel {
   bool isWarning(uint16_t);
 
   std::string file_path_;
-  util::SleeperThread thread_;
+  // Last reading of the shared sensor, in millidegrees Celsius
+  static constexpr int64_t NO_READING = std::numeric_limits<int64_t>::min();
+  std::atomic<int64_t> millidegrees_ = NO_READING;
+  util::ScheduledTask timer_;
+  util::SensorSubscription sensor_;
 };
 
 }  // namespace waybar::modules
@@ -3,6 +3,7 @@
 #include "AAppIconLabel.hpp"
 #include "bar.hpp"
 #include "modules/wayfire/backend.hpp"
+#include "util/rewrite_string.hpp"
 
 namespace waybar::modules::wayfire {
 
@@ -12,6 +13,7 @@ class Window : public AAppIconLabel {
 
   const Bar& bar_;
   std::string old_app_id_;
+  util::RewriteRules rewrite_rules_;
 
  public:
   Window(const std::string& id, const Bar& bar, const Json::Value& config);
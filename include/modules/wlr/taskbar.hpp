@@ -21,6 +21,7 @@
 #include "giomm/desktopappinfo.h"
 #include "util/icon_loader.hpp"
 #include "util/json.hpp"
+#include "util/rewrite_string.hpp"
 #include "wlr-foreign-toplevel-management-unstable-v1-client-protocol.h"
 
 namespace waybar::modules::wlr {
@@ -154,6 +155,7 @@ class Taskbar : public waybar::AModule {
   IconLoader icon_loader_;
   std::unordered_set<std::string> ignore_list_;
   std::map<std::string, std::string> app_ids_replace_map_;
+  util::RewriteRules rewrite_rules_;
 
   struct zwlr_foreign_toplevel_manager_v1 *manager_;
   struct wl_seat *seat_;
@@ -179,6 +181,7 @@ class Taskbar : public waybar::AModule {
   const IconLoader &icon_loader() const;
   const std::unordered_set<std::string> &ignore_list() const;
   const std::map<std::string, std::string> &app_ids_replace_map() const;
+  util::RewriteRules &rewrite_rules();
 };
 
 } /* namespace waybar::modules::wlr */
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <gtkmm/label.h>
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace waybar::util {
+
+/**
+ * Gtk::Label that ignores updates identical to the current markup or tooltip.
+ *
+ * Setting the same markup again still makes GTK re-run the Pango layout and queue a resize of
+ * the whole bar, and most modules set their label on every update whether it changed or not.
+ * Only a hash of the last value is kept. The setters hide the Gtk::Label ones, so they apply when
+ * called on a CachedLabel, as modules do with label_.
+ */
+class CachedLabel : public Gtk::Label {
+ public:
+  void set_markup(const Glib::ustring& markup);
+  void set_text(const Glib::ustring& text);
+  void set_label(const Glib::ustring& label);
+  void set_tooltip_text(const Glib::ustring& text);
+  void set_tooltip_markup(const Glib::ustring& markup);
+  void set_has_tooltip(bool has_tooltip = true);
+
+  // Updates applied and skipped since the last call
+  std::pair<uint64_t, uint64_t> takeStats();
+
+ private:
+  // Records `hash`, returns false if it is the one already applied
+  bool changed(std::optional<size_t>& last, size_t hash);
+
+  std::optional<size_t> markup_hash_;
+  std::optional<size_t> tooltip_hash_;
+  uint64_t applied_ = 0;
+  uint64_t skipped_ = 0;
+};
+
+}  // namespace waybar::util
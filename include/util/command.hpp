@@ -6,15 +6,11 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
-#ifdef __linux__
-#include <sys/prctl.h>
-#endif
-#ifdef __FreeBSD__
-#include <sys/procctl.h>
-#endif
-
 #include <array>
 
+#include "util/exec_helper.hpp"
+#include "util/spawn.hpp"
+
 extern std::mutex reap_mtx;
 extern std::list<pid_t> reap;
 
@@ -42,32 +38,22 @@ inline std::string read(FILE* fp) {
 }
 
 inline int close(FILE* fp, pid_t pid) {
-  int stat = -1;
-  pid_t ret;
-
   fclose(fp);
-  do {
-    ret = waitpid(pid, &stat, WCONTINUED | WUNTRACED);
-
-    if (WIFEXITED(stat)) {
-      spdlog::debug("Cmd exited with code {}", WEXITSTATUS(stat));
-    } else if (WIFSIGNALED(stat)) {
-      spdlog::debug("Cmd killed by {}", WTERMSIG(stat));
-    } else if (WIFSTOPPED(stat)) {
-      spdlog::debug("Cmd stopped by {}", WSTOPSIG(stat));
-    } else if (WIFCONTINUED(stat)) {
-      spdlog::debug("Cmd continued");
-    } else if (ret == -1) {
-      spdlog::debug("waitpid failed: {}", strerror(errno));
-    } else {
-      break;
-    }
-  } while (!WIFEXITED(stat) && !WIFSIGNALED(stat));
+  int stat = util::waitChild(pid);
+  if (stat == -1) {
+    spdlog::debug("waitpid failed: {}", strerror(errno));
+  } else if (WIFEXITED(stat)) {
+    spdlog::debug("Cmd exited with code {}", WEXITSTATUS(stat));
+  } else if (WIFSIGNALED(stat)) {
+    spdlog::debug("Cmd killed by {}", WTERMSIG(stat));
+  }
   return stat;
 }
 
-inline FILE* open(const std::string& cmd, int& pid, const std::string& output_name) {
-  if (cmd == "") return nullptr;
+// Like open(), returns the read end of the pipe, or -1
+inline int openFd(const std::string& cmd, int& pid, const std::string& output_name,
+                  bool direct = false) {
+  if (cmd == "") return -1;
   int fd[2];
   // Open the pipe with the close-on-exec flag set, so it will not be inherited
   // by any other subprocesses launched by other threads (which could result in
@@ -75,64 +61,47 @@ inline FILE* open(const std::string& cmd, int& pid, const std::string& output_na
   // to read from it)
   if (pipe2(fd, O_CLOEXEC) != 0) {
     spdlog::error("Unable to pipe fd");
-    return nullptr;
+    return -1;
   }
 
-  pid_t child_pid = fork();
+  // Killed if Waybar exits
+  pid_t child_pid = util::spawn(cmd, {.stdout_fd = fd[1],
+                                      .output_name = output_name,
+                                      .die_with_parent = true,
+                                      .direct = direct,
+                                      .pidfd = true});
+  ::close(fd[1]);
 
   if (child_pid < 0) {
     spdlog::error("Unable to exec cmd {}, error {}", cmd.c_str(), strerror(errno));
     ::close(fd[0]);
-    ::close(fd[1]);
-    return nullptr;
-  }
-
-  if (!child_pid) {
-    int err;
-    sigset_t mask;
-    sigfillset(&mask);
-    // Reset sigmask
-    err = pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
-    if (err != 0) spdlog::error("pthread_sigmask in open failed: {}", strerror(err));
-    // Kill child if Waybar exits
-    int deathsig = SIGTERM;
-#ifdef __linux__
-    if (prctl(PR_SET_PDEATHSIG, deathsig) != 0) {
-      spdlog::error("prctl(PR_SET_PDEATHSIG) in open failed: {}", strerror(errno));
-    }
-#endif
-#ifdef __FreeBSD__
-    if (procctl(P_PID, 0, PROC_PDEATHSIG_CTL, reinterpret_cast<void*>(&deathsig)) == -1) {
-      spdlog::error("procctl(PROC_PDEATHSIG_CTL) in open failed: {}", strerror(errno));
-    }
-#endif
-    ::close(fd[0]);
-    dup2(fd[1], 1);
-    setpgid(child_pid, child_pid);
-    if (output_name != "") {
-      setenv("WAYBAR_OUTPUT_NAME", output_name.c_str(), 1);
-    }
-    execlp("/bin/sh", "sh", "-c", cmd.c_str(), (char*)0);
-    exit(0);
-  } else {
-    ::close(fd[1]);
+    return -1;
   }
   pid = child_pid;
-  return fdopen(fd[0], "r");
+  return fd[0];
+}
+
+// `direct` skips /bin/sh for commands that don't need it, see util::splitSimpleCommand()
+inline FILE* open(const std::string& cmd, int& pid, const std::string& output_name,
+                  bool direct = false) {
+  int fd = openFd(cmd, pid, output_name, direct);
+  if (fd == -1) return nullptr;
+  return fdopen(fd, "r");
 }
 
-inline struct res exec(const std::string& cmd, const std::string& output_name) {
+inline struct res exec(const std::string& cmd, const std::string& output_name,
+                       bool direct = false) {
   int pid;
-  auto fp = command::open(cmd, pid, output_name);
+  auto fp = command::open(cmd, pid, output_name, direct);
   if (!fp) return {-1, ""};
   auto output = command::read(fp);
   auto stat = command::close(fp, pid);
   return {WEXITSTATUS(stat), output};
 }
 
-inline struct res execNoRead(const std::string& cmd) {
+inline struct res execNoRead(const std::string& cmd, bool direct = false) {
   int pid;
-  auto fp = command::open(cmd, pid, "");
+  auto fp = command::open(cmd, pid, "", direct);
   if (!fp) return {-1, ""};
   auto stat = command::close(fp, pid);
   return {WEXITSTATUS(stat), ""};
@@ -141,25 +110,15 @@ inline struct res execNoRead(const std::string& cmd) {
 inline int32_t forkExec(const std::string& cmd) {
   if (cmd == "") return -1;
 
-  pid_t pid = fork();
+  pid_t pid = util::spawn(cmd, {});
 
   if (pid < 0) {
     spdlog::error("Unable to exec cmd {}, error {}", cmd.c_str(), strerror(errno));
     return pid;
   }
 
-  // Child executes the command
-  if (!pid) {
-    int err;
-    sigset_t mask;
-    sigfillset(&mask);
-    // Reset sigmask
-    err = pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
-    if (err != 0) spdlog::error("pthread_sigmask in forkExec failed: {}", strerror(err));
-    setpgid(pid, pid);
-    execl("/bin/sh", "sh", "-c", cmd.c_str(), (char*)0);
-    exit(0);
-  } else {
+  // The helper reaps its own children
+  if (util::ExecHelper::get() == nullptr) {
     reap_mtx.lock();
     reap.push_back(pid);
     reap_mtx.unlock();
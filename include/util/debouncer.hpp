@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#include "util/scheduler.hpp"
+
+namespace waybar::util {
+
+/**
+ * Coalesces bursts of triggers into one run of a callback on the Scheduler.
+ *
+ * The callback runs once `delay` passed without a new trigger, and at the latest `max_latency`
+ * after the first trigger of a burst, so a steady stream of events still refreshes regularly.
+ * Triggers arriving while the callback runs schedule one more run right after it.
+ */
+class Debouncer {
+ public:
+  Debouncer(std::chrono::milliseconds delay, std::chrono::milliseconds max_latency,
+            std::function<void()> callback);
+  ~Debouncer() { stop(); }
+
+  void trigger();
+  /// Waits for a running callback, later triggers are ignored
+  void stop();
+  /// Triggers and callback runs since the last call
+  std::pair<uint64_t, uint64_t> takeStats();
+
+ private:
+  void run();
+
+  std::chrono::milliseconds delay_;
+  std::chrono::milliseconds max_latency_;
+  std::function<void()> callback_;
+
+  std::mutex mutex_;
+  bool pending_ = false;
+  bool stopped_ = false;
+  Scheduler::Clock::time_point first_trigger_;
+  uint64_t triggers_ = 0;
+  uint64_t runs_ = 0;
+
+  ScheduledTask task_;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "util/spawn.hpp"
+
+namespace waybar::util {
+
+/**
+ * A small process forked when waybar starts, before GTK and the other threads, that spawns the
+ * commands on waybar's behalf.
+ *
+ * Spawning from the helper doesn't depend on waybar's size and thread count, and the helper
+ * reaps every child it starts. Requests go over a socketpair, with the pipe the child writes its
+ * output to passed along, and the helper sends back the pid and then the exit status.
+ * util::spawn() and util::waitChild() go through it once it is started, and fall back to spawning
+ * from waybar if it dies.
+ */
+class ExecHelper {
+ public:
+  /// Forks the helper. Must be called while waybar is still single-threaded.
+  static void start();
+  /// The running helper, null if it wasn't started or exited
+  static ExecHelper* get();
+
+  /// Fails with EPIPE when the helper exited
+  pid_t spawn(const std::string& cmd, const SpawnOptions& options);
+  /// waitpid() status of a child spawned with `pidfd`, empty if the helper doesn't know the pid
+  std::optional<int> wait(pid_t pid);
+  /// Whether a child spawned by the helper hasn't exited yet
+  bool running(pid_t pid);
+
+ private:
+  struct Spawned {
+    bool waitable;
+    std::optional<pid_t> pid = std::nullopt;
+    int error = 0;
+  };
+
+  explicit ExecHelper(int fd, pid_t pid);
+
+  void readReplies();
+
+  const int fd_;
+  const pid_t pid_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::atomic<bool> alive_ = true;
+  uint64_t next_id_ = 1;
+  std::unordered_map<uint64_t, Spawned> requests_;
+  // Children that haven't exited yet, and the exit status of those that will be waited for
+  std::unordered_set<pid_t> running_;
+  std::unordered_set<pid_t> waitable_;
+  std::unordered_map<pid_t, int> statuses_;
+  std::thread reader_;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <fmt/args.h>
+#include <fmt/format.h>
+
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace waybar::util {
+
+/**
+ * A format string parsed once into literal text and replacement fields.
+ *
+ * Formatting copies the literal parts and only formats the fields the string references, so the
+ * whole string isn't parsed again on every update. uses() tells modules which named arguments
+ * they need to compute at all.
+ * Strings this parser doesn't handle (nested replacement fields in a spec, mixed automatic and
+ * manual indexing, syntax errors) are left to fmt as a whole, which also reports the errors.
+ */
+class FormatTemplate {
+ public:
+  FormatTemplate() = default;
+  explicit FormatTemplate(std::string format);
+
+  const std::string& str() const { return format_; }
+  bool empty() const { return format_.empty(); }
+
+  /// Whether the string references the named argument `name`
+  bool uses(std::string_view name) const;
+  /// Whether the string references any named argument starting with `prefix`
+  bool usesPrefix(std::string_view prefix) const;
+
+  template <typename... Args>
+  std::string format(const Args&... args) const {
+    return vformat(fmt::make_format_args(args...));
+  }
+  std::string vformat(fmt::format_args args) const;
+
+  /**
+   * Formats with arguments resolved on demand, for modules with many possible fields (e.g. one per
+   * core). `lookup(name, emit)` is called for each referenced field and calls `emit(value)` if it
+   * knows the field. Positional fields are looked up by their name in `positional`, the order the
+   * module passes its arguments in; the ones past its end aren't found.
+   */
+  template <typename Lookup>
+  std::string formatLookup(Lookup&& lookup,
+                           std::span<const std::string_view> positional = {}) const;
+
+ private:
+  struct Field {
+    std::string literal;  // Text before the field
+    std::string name;     // Empty for positional fields
+    int index = -1;
+    std::string spec;  // "{}" or "{:<spec>}" applied to the single argument
+  };
+
+  std::string format_;
+  std::vector<Field> fields_;
+  std::string trailing_;
+  std::vector<std::string> names_;
+  bool positional_ = false;
+  // Formatted by fmt as a whole
+  bool passthrough_ = false;
+};
+
+template <typename Lookup>
+std::string FormatTemplate::formatLookup(Lookup&& lookup,
+                                         std::span<const std::string_view> positional) const {
+  if (passthrough_) {
+    fmt::dynamic_format_arg_store<fmt::format_context> store;
+    // Positional arguments come first, like the module would push them
+    for (size_t i = 0; positional_ && i < positional.size(); ++i) {
+      bool found = false;
+      lookup(positional[i], [&](const auto& value) {
+        found = true;
+        store.push_back(value);
+      });
+      if (!found) {
+        break;
+      }
+    }
+    for (const auto& name : names_) {
+      lookup(std::string_view(name),
+             [&](const auto& value) { store.push_back(fmt::arg(name.c_str(), value)); });
+    }
+    return fmt::vformat(format_, store);
+  }
+  fmt::memory_buffer buffer;
+  auto out = std::back_inserter(buffer);
+  for (const auto& field : fields_) {
+    buffer.append(field.literal.data(), field.literal.data() + field.literal.size());
+    bool found = false;
+    std::string_view name = field.name;
+    if (field.name.empty()) {
+      if (static_cast<size_t>(field.index) >= positional.size()) {
+        throw fmt::format_error("argument not found");
+      }
+      name = positional[field.index];
+    }
+    lookup(name, [&](const auto& value) {
+      found = true;
+      fmt::vformat_to(out, field.spec, fmt::make_format_args(value));
+    });
+    if (!found) {
+      throw fmt::format_error("argument not found");
+    }
+  }
+  buffer.append(trailing_.data(), trailing_.data() + trailing_.size());
+  return fmt::to_string(buffer);
+}
+
+}  // namespace waybar::util
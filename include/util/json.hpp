@@ -8,6 +8,8 @@
 #include <iostream>
 #include <locale>
 #include <regex>
+#include <string_view>
+#include <unordered_set>
 
 #if (FMT_VERSION >= 90000)
 
@@ -20,28 +22,21 @@ namespace waybar::util {
 
 class JsonParser {
  public:
-  JsonParser() = default;
+  /// Member names kept by the selective parse()
+  using Keys = std::unordered_set<std::string_view>;
 
-  Json::Value parse(const std::string& jsonStr) {
-    Json::Value root;
+  JsonParser() = default;
 
-    // replace all occurrences of "\x" with "\u00", because JSON doesn't allow "\x" escape sequences
-    std::string modifiedJsonStr = replaceHexadecimalEscape(jsonStr);
+  Json::Value parse(std::string_view json) const;
 
-    std::istringstream jsonStream(modifiedJsonStr);
-    std::string errs;
-    if (!Json::parseFromStream(m_readerBuilder, jsonStream, &root, &errs)) {
-      throw std::runtime_error("Error parsing JSON: " + errs);
-    }
-    return root;
-  }
+  /**
+   * Parses only the object members named in `keys`, at any depth; the other members are skipped
+   * without building their values. Large replies (e.g. sway's tree) can be read this way when
+   * only a few fields are used, the result has the same shape as the full one otherwise.
+   */
+  Json::Value parse(std::string_view json, const Keys& keys) const;
 
  private:
   Json::CharReaderBuilder m_readerBuilder;
-
-  static std::string replaceHexadecimalEscape(const std::string& str) {
-    static std::regex re("\\\\x");
-    return std::regex_replace(str, re, "\\u00");
-  }
 };
 }  // namespace waybar::util
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace waybar::util {
+
+/**
+ * Reads the output of long running commands, one line at a time, for every module instance.
+ *
+ * A single thread poll()s the pipes, made non-blocking, and keeps the partial lines of each until
+ * they are complete, instead of every streaming module blocking a thread of its own in getline().
+ * Callbacks are called from that thread.
+ */
+class LineReader {
+ public:
+  using LineCallback = std::function<void(std::string_view)>;
+  using EndCallback = std::function<void()>;
+  using Id = uint64_t;
+
+  static LineReader& inst();
+
+  /**
+   * Takes ownership of `fd`. `on_line` is called with every line, without its newline, and
+   * `on_end` once the end of the output is reached or reading fails, after which the fd is closed.
+   */
+  Id add(int fd, LineCallback on_line, EndCallback on_end);
+  /// Closes the fd. No callback runs for it once this returns, unless called from one.
+  void remove(Id id);
+
+ protected:
+  LineReader();  // use LineReader::inst() instead
+
+ private:
+  struct Stream;
+
+  void readLoop();
+  void read(Id id, Stream& stream);
+  void wake();
+
+  std::mutex mutex_;
+  std::condition_variable done_cv_;
+  Id next_id_ = 1;
+  std::unordered_map<Id, std::shared_ptr<Stream>> streams_;
+  // Stream whose callbacks are running
+  Id running_ = 0;
+
+  // Interrupts poll() when streams are added or removed
+  std::array<int, 2> wake_fds_ = {-1, -1};
+  std::thread thread_;
+};
+
+/// A LineReader stream, removed on destruction
+class LineStream {
+ public:
+  LineStream() = default;
+  LineStream(int fd, LineReader::LineCallback on_line, LineReader::EndCallback on_end)
+      : id_{LineReader::inst().add(fd, std::move(on_line), std::move(on_end))} {}
+  LineStream(const LineStream&) = delete;
+  LineStream& operator=(const LineStream&) = delete;
+  LineStream(LineStream&& other) noexcept : id_{std::exchange(other.id_, 0)} {}
+  LineStream& operator=(LineStream&& other) noexcept {
+    if (this != &other) {
+      reset();
+      id_ = std::exchange(other.id_, 0);
+    }
+    return *this;
+  }
+  ~LineStream() { reset(); }
+
+  void reset() {
+    if (id_ != 0) {
+      LineReader::inst().remove(std::exchange(id_, 0));
+    }
+  }
+
+ private:
+  LineReader::Id id_ = 0;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace waybar::util {
+
+/**
+ * Results keyed by string, keeping the `capacity` most recently used ones.
+ *
+ * For memoizing string transformations of window titles and the like, whose set of inputs keeps
+ * growing over a session. Copies start empty. Not thread-safe.
+ */
+template <typename Value>
+class LruCache {
+ public:
+  explicit LruCache(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+  LruCache(const LruCache& other) : capacity_(other.capacity_) {}
+  LruCache& operator=(const LruCache& other) {
+    if (this != &other) {
+      clear();
+      capacity_ = other.capacity_;
+    }
+    return *this;
+  }
+  // Moving the list keeps its nodes, and the index pointing into them, valid
+  LruCache(LruCache&&) noexcept = default;
+  LruCache& operator=(LruCache&&) noexcept = default;
+
+  /// The cached value, marked as the most recently used, or nullptr
+  Value* find(std::string_view key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->second;
+  }
+
+  /// Evicts the least recently used value when full. The reference is valid until the next insert
+  Value& insert(std::string key, Value value) {
+    if (auto it = index_.find(key); it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      it->second->second = std::move(value);
+      return it->second->second;
+    }
+    if (index_.size() >= capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(std::move(key), std::move(value));
+    index_.emplace(entries_.front().first, entries_.begin());
+    return entries_.front().second;
+  }
+
+  void clear() {
+    index_.clear();
+    entries_.clear();
+  }
+
+  size_t size() const { return index_.size(); }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  using Entries = std::list<std::pair<std::string, Value>>;
+
+  size_t capacity_;
+  // Most recently used first
+  Entries entries_;
+  // Keys point into the entries
+  std::unordered_map<std::string_view, typename Entries::iterator> index_;
+};
+
+}  // namespace waybar::util
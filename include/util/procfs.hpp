@@ -0,0 +1,147 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace waybar::util::procfs {
+
+/**
+ * A procfs/sysfs file that is kept open and re-read from offset 0 with pread().
+ * The read buffer grows to fit the file once and is reused afterwards, so steady state reads
+ * don't allocate.
+ */
+class File {
+ public:
+  explicit File(std::string path);
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+  ~File();
+
+  const std::string& path() const { return path_; }
+
+  /// Whole content of the file, valid until the next read(). Retries to open a missing file.
+  std::optional<std::string_view> read();
+
+ private:
+  std::string path_;
+  int fd_ = -1;
+  std::vector<char> buffer_;
+};
+
+/// Splits the next line off `content`, without its trailing newline
+inline bool nextLine(std::string_view& content, std::string_view& line) {
+  if (content.empty()) {
+    return false;
+  }
+  auto end = content.find('\n');
+  line = content.substr(0, end);
+  content.remove_prefix(end == std::string_view::npos ? content.size() : end + 1);
+  return true;
+}
+
+inline void skipBlanks(std::string_view& sv) {
+  auto start = sv.find_first_not_of(" \t");
+  sv.remove_prefix(start == std::string_view::npos ? sv.size() : start);
+}
+
+/// Returns the next blank separated word of `sv` and advances past it
+inline std::string_view nextWord(std::string_view& sv) {
+  skipBlanks(sv);
+  auto end = sv.find_first_of(" \t");
+  auto word = sv.substr(0, end);
+  sv.remove_prefix(word.size());
+  return word;
+}
+
+/// Parses the next unsigned decimal number of `sv` and advances past it
+inline bool nextNumber(std::string_view& sv, uint64_t& value) {
+  skipBlanks(sv);
+  auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+  if (ec != std::errc()) {
+    return false;
+  }
+  sv.remove_prefix(ptr - sv.data());
+  return true;
+}
+
+/// Calls fn(key, value) for every "Key:   value [unit]" line, as found in /proc/meminfo
+template <typename Fn>
+void forEachKeyValue(std::string_view content, Fn&& fn) {
+  std::string_view line;
+  while (nextLine(content, line)) {
+    auto delim = line.find(':');
+    if (delim == std::string_view::npos) {
+      continue;
+    }
+    auto rest = line.substr(delim + 1);
+    uint64_t value;
+    if (nextNumber(rest, value)) {
+      fn(line.substr(0, delim), value);
+    }
+  }
+}
+
+/**
+ * Calls fn(key, value) for every "KEY=value" field of a uevent: the lines of a sysfs uevent file,
+ * or with `separator` '\0' the fields of a kobject uevent netlink message.
+ */
+template <typename Fn>
+void forEachUeventProperty(std::string_view content, Fn&& fn, char separator = '\n') {
+  while (!content.empty()) {
+    auto end = content.find(separator);
+    auto field = content.substr(0, end);
+    content.remove_prefix(end == std::string_view::npos ? content.size() : end + 1);
+    auto delim = field.find('=');
+    if (delim != std::string_view::npos) {
+      fn(field.substr(0, delim), field.substr(delim + 1));
+    }
+  }
+}
+
+/**
+ * Calls fn(cpu, idle, total) for every leading "cpu" line of /proc/stat.
+ * `cpu` is -1 for the aggregated line, idle includes iowait. Lines with less than 5 fields are
+ * reported with zero times.
+ */
+template <typename Fn>
+void forEachCpuTime(std::string_view content, Fn&& fn) {
+  std::string_view line;
+  while (nextLine(content, line) && line.starts_with("cpu")) {
+    line.remove_prefix(3);
+    long cpu = -1;
+    if (!line.empty() && line.front() != ' ') {
+      uint64_t index;
+      if (!nextNumber(line, index)) {
+        break;
+      }
+      cpu = static_cast<long>(index);
+    }
+    uint64_t total = 0;
+    uint64_t idle = 0;
+    uint64_t time;
+    int fields = 0;
+    while (nextNumber(line, time)) {
+      // user nice system idle iowait irq softirq...
+      if (fields == 3 || fields == 4) {
+        idle += time;
+      }
+      total += time;
+      ++fields;
+    }
+    if (fields < 5) {
+      idle = total = 0;
+    }
+    fn(cpu, idle, total);
+  }
+}
+
+/// Received and transmitted byte counters of `ifname` in /proc/net/dev
+std::optional<std::pair<uint64_t, uint64_t>> netDevBytes(std::string_view content,
+                                                         std::string_view ifname);
+
+}  // namespace waybar::util::procfs
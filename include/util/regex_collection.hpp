@@ -3,51 +3,97 @@
 #include <json/json.h>
 
 #include <functional>
+#include <optional>
 #include <regex>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
+
+#include "util/lru_cache.hpp"
 
 namespace waybar::util {
 
+/* Matcher for the patterns made of literal text and ".*" wildcards, optionally anchored with "^"
+ * and "$", which is what most window-rewrite rules look like ("class<firefox>",
+ * "title<.*youtube.*>"). It gives the same result as a case-insensitive regex_search with a few
+ * substring searches.
+ */
+class LiteralPattern {
+ public:
+  // Empty for patterns using any other regex feature
+  static std::optional<LiteralPattern> parse(std::string_view pattern);
+
+  // `value` must have been passed through lower()
+  bool matches(std::string_view value) const;
+  // Whether matches() is valid for `value`: "." doesn't match line terminators
+  static bool applicable(std::string_view value);
+  static std::string lower(std::string_view value);
+
+ private:
+  std::vector<std::string> parts_;  // Lowercase, separated by ".*"
+  bool anchored_start_ = false;
+  bool anchored_end_ = false;
+};
+
 struct Rule {
   std::regex rule;
   std::string repr;
   int priority;
+  // Set when the rule can be matched without the regex
+  std::optional<LiteralPattern> literal;
 
   // Fix for Clang < 16
   // See https://en.cppreference.com/w/cpp/compiler_support/20 "Parenthesized initialization of
   // aggregates"
-  Rule(std::regex rule, std::string repr, int priority)
-      : rule(std::move(rule)), repr(std::move(repr)), priority(priority) {}
+  Rule(std::regex rule, std::string repr, int priority,
+       std::optional<LiteralPattern> literal = std::nullopt)
+      : rule(std::move(rule)),
+        repr(std::move(repr)),
+        priority(priority),
+        literal(std::move(literal)) {}
 };
 
 int default_priority_function(std::string& key);
 
 /* A collection of regexes and strings, with a default string to return if no regexes.
  * When a regex is matched, the corresponding string is returned.
- * All regexes that are matched are cached, so that the regexes are only
- * evaluated once against a given string.
+ * The results of the last `cache_size` distinct strings are cached, so that the regexes are only
+ * evaluated once against a given string while it keeps showing up, without growing forever with
+ * ever-changing window titles.
  * Regexes may be given a higher priority than others, so that they are matched
  * first. The priority function is given the regex string, and should return a
  * higher number for higher priority regexes.
+ * Rules that are plain text with ".*" wildcards are matched without the regex engine.
  */
 class RegexCollection {
  private:
+  struct CacheEntry {
+    std::string repr;
+    bool matched_any;
+  };
+
   std::vector<Rule> rules;
-  std::map<std::string, std::string> regex_cache;
+  LruCache<CacheEntry> regex_cache{DEFAULT_CACHE_SIZE};
   std::string default_repr;
 
   std::string find_match(std::string& value, bool& matched_any);
 
  public:
+  static constexpr size_t DEFAULT_CACHE_SIZE = 512;
+
   RegexCollection() = default;
   RegexCollection(
       const Json::Value& map, std::string default_repr = "",
-      const std::function<int(std::string&)>& priority_function = default_priority_function);
+      const std::function<int(std::string&)>& priority_function = default_priority_function,
+      size_t cache_size = DEFAULT_CACHE_SIZE);
   ~RegexCollection() = default;
 
+  // The returned reference is valid until the next call
   std::string& get(std::string& value, bool& matched_any);
   std::string& get(std::string& value);
+  // Number of values whose result is cached
+  size_t cache_size() const { return regex_cache.size(); }
 };
 
 }  // namespace waybar::util
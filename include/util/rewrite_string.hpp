@@ -1,10 +1,45 @@
 #pragma once
 #include <json/json.h>
 
+#include <regex>
 #include <string>
+#include <vector>
+
+#include "util/lru_cache.hpp"
 
 namespace waybar::util {
 std::string rewriteString(const std::string&, const Json::Value&);
 std::string rewriteStringOnce(const std::string& value, const Json::Value& rules,
                               bool& matched_any);
+
+/**
+ * The "rewrite" map of a module, compiled once.
+ *
+ * Every rule whose regex matches the whole value is applied in turn, like rewriteString(). The
+ * results of the recently seen values are cached, window titles tend to come back.
+ */
+class RewriteRules {
+ public:
+  static constexpr size_t DEFAULT_CACHE_SIZE = 256;
+
+  RewriteRules() = default;
+  explicit RewriteRules(const Json::Value& rules, size_t cache_size = DEFAULT_CACHE_SIZE);
+
+  bool empty() const { return rules_.empty(); }
+  std::string apply(const std::string& value);
+
+ private:
+  struct Rule {
+    std::regex regex;
+    std::string replacement;
+    // Lowercase text any matching value contains, to skip the regex for most values
+    std::string required;
+  };
+
+  std::string rewrite(const std::string& value) const;
+
+  std::vector<Rule> rules_;
+  LruCache<std::string> cache_{DEFAULT_CACHE_SIZE};
+};
+
 }  // namespace waybar::util
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace waybar::util {
+
+/**
+ * Process-wide scheduler for interval based modules.
+ *
+ * One timer thread keeps a min-heap of deadlines and hands due tasks to a small pool of workers,
+ * instead of every polling module owning a mostly sleeping SleeperThread.
+ * A task is never run concurrently with itself, and its next deadline is taken from the moment
+ * its callback returns, matching the "run, then sleep for interval" loop of SleeperThread.
+ */
+class Scheduler {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+  using TaskId = uint64_t;
+
+  static Scheduler& inst();
+
+  Scheduler(const Scheduler&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+  ~Scheduler();
+
+  /// Registers `cb` to be run right away and then every `interval`.
+  /// Aligned tasks are re-armed on multiples of their interval since the wall clock epoch, so
+  /// tasks whose intervals share a divisor wake up together instead of at arbitrary phases.
+  TaskId add(std::chrono::milliseconds interval, Callback cb, bool aligned = false);
+  /// Unregisters a task, waiting for a running callback to return unless called from it
+  void remove(TaskId id);
+  /// Runs the task as soon as possible, like SleeperThread::wake_up()
+  void wakeUp(TaskId id);
+  /// Moves the next run of the task to `deadline`, not before it returns if it is running
+  void wakeUpAt(TaskId id, Clock::time_point deadline);
+  void wakeUpAll();
+
+  size_t workerCount() const { return workers_.size(); }
+
+ protected:
+  explicit Scheduler(size_t workers);
+
+ private:
+  struct Task {
+    std::chrono::milliseconds interval;
+    Callback callback;
+    bool aligned = false;
+    Clock::time_point deadline;
+    std::thread::id runner;
+    bool running = false;
+    bool removed = false;
+    bool wake_pending = false;
+    Clock::time_point wake_deadline;  // Of the pending wakeup
+  };
+  using HeapEntry = std::pair<Clock::time_point, TaskId>;
+
+  void timerLoop();
+  void workerLoop();
+  void schedule(TaskId id, Task& task, Clock::time_point deadline);
+  Clock::time_point nextDeadline(const Task& task) const;
+  void reportStats(Clock::time_point now);
+
+  std::mutex mutex_;
+  std::condition_variable timer_cv_;
+  std::condition_variable worker_cv_;
+  std::condition_variable done_cv_;
+  std::unordered_map<TaskId, Task> tasks_;
+  std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<>> heap_;
+  std::deque<TaskId> ready_;
+  TaskId next_id_ = 1;
+  bool do_run_ = true;
+
+  // Wakeup accounting, logged at debug level to compare against powertop
+  Clock::time_point stats_since_ = Clock::now();
+  uint64_t timer_wakeups_ = 0;
+  uint64_t task_runs_ = 0;
+
+  std::thread timer_;
+  std::vector<std::thread> workers_;
+};
+
+/**
+ * Owning handle of a Scheduler task.
+ * Meant as a drop-in for the `thread_ = [this] { dp.emit(); thread_.sleep_for(interval_); }`
+ * pattern: the task is unregistered when the handle is destroyed or reassigned.
+ */
+class ScheduledTask {
+ public:
+  ScheduledTask() = default;
+  ScheduledTask(std::chrono::milliseconds interval, Scheduler::Callback cb, bool aligned = false)
+      : id_{Scheduler::inst().add(interval, std::move(cb), aligned)} {}
+  ScheduledTask(const ScheduledTask&) = delete;
+  ScheduledTask& operator=(const ScheduledTask&) = delete;
+  ScheduledTask(ScheduledTask&& other) noexcept : id_{std::exchange(other.id_, 0)} {}
+  ScheduledTask& operator=(ScheduledTask&& other) noexcept {
+    if (this != &other) {
+      stop();
+      id_ = std::exchange(other.id_, 0);
+    }
+    return *this;
+  }
+  ~ScheduledTask() { stop(); }
+
+  bool isRunning() const { return id_ != 0; }
+
+  void wake_up() {
+    if (id_ != 0) {
+      Scheduler::inst().wakeUp(id_);
+    }
+  }
+
+  void wake_up_at(Scheduler::Clock::time_point deadline) {
+    if (id_ != 0) {
+      Scheduler::inst().wakeUpAt(id_, deadline);
+    }
+  }
+
+  void stop() {
+    if (id_ != 0) {
+      Scheduler::inst().remove(std::exchange(id_, 0));
+    }
+  }
+
+ private:
+  Scheduler::TaskId id_ = 0;
+};
+
+}  // namespace waybar::util
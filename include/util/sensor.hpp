@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace waybar::util {
+
+/**
+ * How often a sensor is read: the base interval, less often while the value stays within
+ * `tolerance` of where it settled, more often once it is within `margin` of `critical`.
+ */
+class AdaptiveInterval {
+ public:
+  struct Policy {
+    std::chrono::milliseconds interval{0};
+    std::optional<int64_t> critical = std::nullopt;
+    // Disabled: always the base interval
+    bool adaptive = true;
+    int64_t tolerance = 0;
+    int64_t margin = 0;
+  };
+
+  // Stable reads before each doubling of the interval, and how far it backs off
+  static constexpr int STABLE_READS = 3;
+  static constexpr int MAX_BACKOFF = 4;
+  static constexpr std::chrono::milliseconds MIN_INTERVAL{1000};
+
+  explicit AdaptiveInterval(Policy policy) : policy_{policy} {}
+
+  std::chrono::milliseconds base() const { return policy_.interval; }
+
+  /// Delay before the read following the one that returned `value`
+  std::chrono::milliseconds next(int64_t value);
+
+ private:
+  Policy policy_;
+  std::optional<int64_t> settled_;
+  int stable_reads_ = 0;
+};
+
+/**
+ * Sysfs sensors (hwmon inputs, thermal zones) shared by every module instance reading them.
+ *
+ * Each sensor keeps its attribute open and re-reads it with pread() from a scheduler task, at the
+ * shortest of its subscribers' adaptive intervals. The alarm attributes next to a hwmon input
+ * (tempN_crit_alarm...) are watched with poll(POLLPRI), drivers sysfs_notify() them when a limit
+ * is crossed, and trigger an immediate read.
+ * Subscribers are called from the scheduler with the first value and then whenever it changes.
+ */
+class SensorService {
+ public:
+  using Callback = std::function<void(int64_t)>;
+  using Id = uint64_t;
+
+  static SensorService& inst();
+
+  /// The callback is called with the service locked, it must not (un)subscribe
+  Id subscribe(const std::string& path, AdaptiveInterval::Policy policy, bool aligned,
+               Callback callback);
+  /// No callback runs for the subscription once this returns
+  void unsubscribe(Id id);
+
+ protected:
+  SensorService();  // use SensorService::inst() instead
+
+ private:
+  struct Sensor;
+
+  void read(Sensor& sensor);
+  void watchAlarms(Sensor& sensor);
+  void alarmLoop();
+
+  std::mutex mutex_;
+  Id next_id_ = 1;
+  std::unordered_map<std::string, std::unique_ptr<Sensor>> sensors_;
+  std::unordered_map<Id, std::string> paths_;
+
+  // Interrupts the alarm thread's poll() when the watched attributes change
+  std::array<int, 2> wake_fds_ = {-1, -1};
+  std::thread alarm_thread_;
+  // Alarm fds of removed sensors, closed by the alarm thread once it doesn't poll them anymore
+  std::vector<int> retired_fds_;
+};
+
+/// A SensorService subscription, unsubscribed on destruction
+class SensorSubscription {
+ public:
+  SensorSubscription() = default;
+  SensorSubscription(const std::string& path, AdaptiveInterval::Policy policy, bool aligned,
+                     SensorService::Callback callback)
+      : id_{SensorService::inst().subscribe(path, policy, aligned, std::move(callback))} {}
+  SensorSubscription(const SensorSubscription&) = delete;
+  SensorSubscription& operator=(const SensorSubscription&) = delete;
+  SensorSubscription(SensorSubscription&& other) noexcept : id_{std::exchange(other.id_, 0)} {}
+  SensorSubscription& operator=(SensorSubscription&& other) noexcept {
+    if (this != &other) {
+      reset();
+      id_ = std::exchange(other.id_, 0);
+    }
+    return *this;
+  }
+  ~SensorSubscription() { reset(); }
+
+  void reset() {
+    if (id_ != 0) {
+      SensorService::inst().unsubscribe(std::exchange(id_, 0));
+    }
+  }
+
+ private:
+  SensorService::Id id_ = 0;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace waybar::util {
+
+/**
+ * A value read from the system (procfs, sysctl...) shared by every module instance.
+ *
+ * Module instances on every bar ask for the value with the staleness they tolerate; the source is
+ * only read again once the cached snapshot is older than that. Snapshots are immutable and handed
+ * out as shared_ptr, so consumers can keep the previous one around to compute deltas.
+ */
+template <typename T>
+class SharedSample {
+ public:
+  // Upper bound on the tolerated staleness, whatever the consumer's interval is
+  static constexpr std::chrono::milliseconds MAX_AGE{1000};
+
+  explicit SharedSample(std::function<T()> read) : read_{std::move(read)} {}
+
+  std::shared_ptr<const T> get(std::chrono::milliseconds max_age) {
+    std::lock_guard lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (!value_ || now - taken_at_ > std::min(max_age, MAX_AGE)) {
+      value_ = std::make_shared<const T>(read_());
+      taken_at_ = now;
+    }
+    return value_;
+  }
+
+ private:
+  std::function<T()> read_;
+  std::mutex mutex_;
+  std::shared_ptr<const T> value_;
+  std::chrono::steady_clock::time_point taken_at_;
+};
+
+}  // namespace waybar::util
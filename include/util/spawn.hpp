@@ -0,0 +1,49 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace waybar::util {
+
+/**
+ * Argv of a command line that doesn't need a shell: words separated by blanks, without quotes,
+ * escapes, expansions, globs, redirections, control operators or leading variable assignments.
+ * Empty for anything else, which must go through /bin/sh.
+ */
+std::optional<std::vector<std::string>> splitSimpleCommand(std::string_view cmd);
+
+struct SpawnOptions {
+  // Becomes the child's stdout when set
+  int stdout_fd = -1;
+  // Exported as WAYBAR_OUTPUT_NAME when not empty
+  std::string output_name{};
+  // SIGTERM the child when waybar exits
+  bool die_with_parent = false;
+  // Exec the command directly when splitSimpleCommand() allows it, rather than with /bin/sh -c
+  bool direct = false;
+  // The child will be waited for with waitChild(), keep its pidfd or exit status for it
+  bool pidfd = false;
+};
+
+/**
+ * Starts `cmd` in its own process group, with all signals unblocked.
+ *
+ * On Linux the child shares waybar's memory until it execs (clone with CLONE_VM | CLONE_VFORK,
+ * as posix_spawn does), so the cost doesn't grow with waybar's size and thread count like fork()
+ * does. posix_spawn itself can't set the parent death signal.
+ * Spawned by the ExecHelper instead when it runs.
+ * Returns the pid, or -1 with errno set when the child couldn't be started.
+ */
+pid_t spawn(const std::string& cmd, const SpawnOptions& options);
+
+/// Waits for a spawned child to exit, through its pidfd if it has one. Returns a waitpid() status.
+int waitChild(pid_t pid);
+
+/// Like waitChild(), but empty instead of blocking while the child is still running
+std::optional<int> tryWaitChild(pid_t pid);
+
+}  // namespace waybar::util
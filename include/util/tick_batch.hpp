@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glibmm/dispatcher.h>
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace waybar::util {
+
+/**
+ * Runs callbacks posted from any thread on the main thread, using a single Glib::Dispatcher
+ * emission for everything posted before the main loop gets to it.
+ * Used by modules with "interval-align", which all wake up on the same scheduler tick: their
+ * updates then cost one main loop wakeup per tick instead of one per module.
+ */
+class TickBatch {
+ public:
+  // Must be first called from the main thread, as Glib::Dispatcher binds to its main context
+  static TickBatch& inst();
+
+  /// Queues `fn`, at most once per `owner` until the batch runs
+  void post(const void* owner, std::function<void()> fn);
+  /// Drops a pending callback, to be called before `owner` is destroyed
+  void cancel(const void* owner);
+
+ private:
+  TickBatch();
+  void run();
+
+  Glib::Dispatcher dp_;
+  std::mutex mutex_;
+  std::vector<std::pair<const void*, std::function<void()>>> pending_;
+
+  uint64_t emissions_ = 0;
+  uint64_t updates_ = 0;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+/**
+ * Tab separated lines, the compact alternative to one JSON object per line for commands that
+ * update often. Tabs, newlines and backslashes in a field are escaped as \t, \n and \\.
+ * Nothing here allocates once the output strings have grown to fit.
+ */
+namespace waybar::util::tsv {
+
+/**
+ * Splits `line` at its tabs into `fields`, without copying. The fields missing from the line are
+ * empty and the ones past `fields.size()` are ignored. Returns the number of fields in the line.
+ */
+size_t split(std::string_view line, std::span<std::string_view> fields);
+
+/// Replaces `out` with `field`, escapes resolved. Unknown escapes are kept as they are.
+void unescape(std::string_view field, std::string& out);
+
+/// `field` as a number rounded to the nearest integer, `fallback` if it isn't one
+int toInt(std::string_view field, int fallback = 0);
+
+}  // namespace waybar::util::tsv
@@ -7,6 +7,7 @@
 #include <util/command.hpp>
 
 #include "config.hpp"
+#include "util/tick_batch.hpp"
 
 namespace waybar {
 
@@ -28,7 +29,25 @@ ALabel::ALabel(const Json::Value& config, const std::string& name, const std::st
                                ? std::max(1L,  // Minimum 1ms due to millisecond precision
                                           static_cast<long>(config_["interval"].asDouble()) * 1000)
                                : 1000 * (long)interval))),
+      interval_align_(config_["interval-align"].isBool() && config_["interval-align"].asBool()),
       default_format_(format_) {
+  if (interval_align_) {
+    // Make sure the dispatcher is created on the main thread
+    util::TickBatch::inst();
+  }
+  if (config_["states"].isObject()) {
+    for (auto it = config_["states"].begin(); it != config_["states"].end(); ++it) {
+      if (it->isUInt() && it.key().isString()) {
+        auto state = it.key().asString();
+        if (config_["format-" + state].isString()) {
+          state_formats_.emplace(state,
+                                 util::FormatTemplate(config_["format-" + state].asString()));
+        }
+        states_.emplace_back(std::move(state), it->asUInt());
+      }
+    }
+    std::ranges::sort(states_, [](auto& a, auto& b) { return a.second > b.second; });
+  }
   label_.set_name(name);
   if (!id.empty()) {
     label_.get_style_context()->add_class(id);
@@ -127,7 +146,36 @@ ALabel::ALabel(const Json::Value& config, const std::string& name, const std::st
   }
 }
 
-auto ALabel::update() -> void { AModule::update(); }
+ALabel::~ALabel() {
+  if (interval_align_) {
+    util::TickBatch::inst().cancel(this);
+  }
+}
+
+auto ALabel::update() -> void {
+  // How many label and tooltip updates didn't need a relayout
+  auto now = std::chrono::steady_clock::now();
+  if (now - label_stats_since_ >= std::chrono::minutes(1)) {
+    auto [applied, skipped] = label_.takeStats();
+    spdlog::debug("{}: {} label updates applied, {} unchanged skipped", name_, applied, skipped);
+    label_stats_since_ = now;
+  }
+  AModule::update();
+}
+
+void ALabel::emitUpdate() {
+  if (!interval_align_) {
+    dp.emit();
+    return;
+  }
+  util::TickBatch::inst().post(this, [this] {
+    try {
+      update();
+    } catch (const std::exception& e) {
+      spdlog::error("{}: {}", name_, e.what());
+    }
+  });
+}
 
 std::string ALabel::getIcon(uint16_t percentage, const std::string& alt, uint16_t max) {
   auto format_icons = config_["format-icons"];
@@ -194,32 +242,50 @@ void ALabel::handleGtkMenuEvent(GtkMenuItem* /*menuitem*/, gpointer data) {
 }
 
 std::string ALabel::getState(uint8_t value, bool lesser) {
-  if (!config_["states"].isObject()) {
+  if (states_.empty()) {
     return "";
   }
-  // Get current state
-  std::vector<std::pair<std::string, uint8_t>> states;
-  if (config_["states"].isObject()) {
-    for (auto it = config_["states"].begin(); it != config_["states"].end(); ++it) {
-      if (it->isUInt() && it.key().isString()) {
-        states.emplace_back(it.key().asString(), it->asUInt());
-      }
-    }
-  }
-  // Sort states
-  std::ranges::sort(states.begin(), states.end(), [&lesser](auto& a, auto& b) {
-    return lesser ? a.second < b.second : a.second > b.second;
-  });
+  // Get current state, states_ is sorted by decreasing value
   std::string valid_state;
-  for (auto const& state : states) {
-    if ((lesser ? value <= state.second : value >= state.second) && valid_state.empty()) {
-      label_.get_style_context()->add_class(state.first);
-      valid_state = state.first;
-    } else {
-      label_.get_style_context()->remove_class(state.first);
+  auto matches = [&](auto const& state) {
+    return lesser ? value <= state.second : value >= state.second;
+  };
+  if (lesser) {
+    auto it = std::find_if(states_.rbegin(), states_.rend(), matches);
+    if (it != states_.rend()) valid_state = it->first;
+  } else {
+    auto it = std::find_if(states_.begin(), states_.end(), matches);
+    if (it != states_.end()) valid_state = it->first;
+  }
+  // Only touch the style context when the state changes
+  if (valid_state != current_state_) {
+    if (!current_state_.empty()) {
+      label_.get_style_context()->remove_class(current_state_);
     }
+    if (!valid_state.empty()) {
+      label_.get_style_context()->add_class(valid_state);
+    }
+    current_state_ = valid_state;
   }
   return valid_state;
 }
 
+const util::FormatTemplate& ALabel::compiledFormat(const std::string& format) {
+  auto it = compiled_formats_.find(format);
+  if (it == compiled_formats_.end()) {
+    it = compiled_formats_.emplace(format, util::FormatTemplate(format)).first;
+  }
+  return it->second;
+}
+
+const util::FormatTemplate& ALabel::stateFormat(const std::string& state) {
+  if (!state.empty()) {
+    auto it = state_formats_.find(state);
+    if (it != state_formats_.end()) {
+      return it->second;
+    }
+  }
+  return compiledFormat(format_);
+}
+
 }  // namespace waybar
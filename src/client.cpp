@@ -235,6 +235,7 @@ int waybar::Client::main(int argc, char *argv[]) {
   std::string config_opt;
   std::string style_opt;
   std::string log_level;
+  bool exec_helper = false;  // Started by main()
   auto cli = clara::detail::Help(show_help) |
              clara::detail::Opt(show_version)["-v"]["--version"]("Show version") |
              clara::detail::Opt(config_opt, "config")["-c"]["--config"]("Config path") |
@@ -242,7 +243,9 @@ int waybar::Client::main(int argc, char *argv[]) {
              clara::detail::Opt(
                  log_level,
                  "trace|debug|info|warning|error|critical|off")["-l"]["--log-level"]("Log level") |
-             clara::detail::Opt(bar_id, "id")["-b"]["--bar"]("Bar id");
+             clara::detail::Opt(bar_id, "id")["-b"]["--bar"]("Bar id") |
+             clara::detail::Opt(exec_helper)["--exec-helper"](
+                 "Spawn commands from a helper process started at launch");
   auto res = cli.parse(clara::detail::Args(argc, argv));
   if (!res) {
     spdlog::error("Error in command line: {}", res.errorMessage());
@@ -6,10 +6,12 @@
 #include <csignal>
 #include <list>
 #include <mutex>
+#include <string_view>
 
 #include "bar.hpp"
 #include "client.hpp"
 #include "util/SafeSignal.hpp"
+#include "util/exec_helper.hpp"
 
 std::mutex reap_mtx;
 std::list<pid_t> reap;
@@ -156,6 +158,14 @@ static void handleSignalMainThread(int signum, bool& reload) {
 
 int main(int argc, char* argv[]) {
   try {
+    // Forked before anything else, while waybar is small and has a single thread
+    for (int i = 1; i < argc; ++i) {
+      if (std::string_view(argv[i]) == "--exec-helper") {
+        waybar::util::ExecHelper::start();
+        break;
+      }
+    }
+
     auto* client = waybar::Client::inst();
 
     bool reload;
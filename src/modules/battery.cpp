@@ -1,32 +1,130 @@
 #include "modules/battery.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <optional>
+#include <unordered_map>
 
 #include "util/command.hpp"
 #if defined(__FreeBSD__)
 #include <sys/sysctl.h>
 #endif
+#if defined(__linux__)
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 #include <spdlog/spdlog.h>
 
-waybar::modules::Battery::Battery(const std::string& id, const Bar& bar, const Json::Value& config)
-    : ALabel(config, "battery", id, "{capacity}%", 60), last_event_(""), bar_(bar) {
 #if defined(__linux__)
-  battery_watch_fd_ = inotify_init1(IN_CLOEXEC);
-  if (battery_watch_fd_ == -1) {
-    throw std::runtime_error("Unable to listen batteries.");
+namespace {
+
+// The attributes of a power supply, as listed by its uevent file
+struct PowerSupply {
+  std::optional<std::string> status;
+  std::optional<int64_t> online;
+  std::optional<int64_t> capacity;
+  std::optional<int64_t> current_now;
+  std::optional<int64_t> current_avg;
+  std::optional<int64_t> voltage_now;
+  std::optional<int64_t> voltage_avg;
+  std::optional<int64_t> power_now;
+  std::optional<int64_t> charge_now;
+  std::optional<int64_t> charge_full;
+  std::optional<int64_t> charge_full_design;
+  std::optional<int64_t> energy_now;
+  std::optional<int64_t> energy_full;
+  std::optional<int64_t> energy_full_design;
+  std::optional<int64_t> cycle_count;
+  std::optional<int64_t> time_to_empty_now;
+  std::optional<int64_t> time_to_full_now;
+};
+
+// One read of the uevent file instead of an open and a read per attribute
+std::optional<PowerSupply> readPowerSupply(waybar::util::procfs::File* uevent) {
+  static const std::unordered_map<std::string_view, std::optional<int64_t> PowerSupply::*>
+      numbers = {
+          {"ONLINE", &PowerSupply::online},
+          {"CAPACITY", &PowerSupply::capacity},
+          {"CURRENT_NOW", &PowerSupply::current_now},
+          {"CURRENT_AVG", &PowerSupply::current_avg},
+          {"VOLTAGE_NOW", &PowerSupply::voltage_now},
+          {"VOLTAGE_AVG", &PowerSupply::voltage_avg},
+          {"POWER_NOW", &PowerSupply::power_now},
+          {"CHARGE_NOW", &PowerSupply::charge_now},
+          {"CHARGE_FULL", &PowerSupply::charge_full},
+          {"CHARGE_FULL_DESIGN", &PowerSupply::charge_full_design},
+          {"ENERGY_NOW", &PowerSupply::energy_now},
+          {"ENERGY_FULL", &PowerSupply::energy_full},
+          {"ENERGY_FULL_DESIGN", &PowerSupply::energy_full_design},
+          {"CYCLE_COUNT", &PowerSupply::cycle_count},
+          {"TIME_TO_EMPTY_NOW", &PowerSupply::time_to_empty_now},
+          {"TIME_TO_FULL_NOW", &PowerSupply::time_to_full_now},
+      };
+  if (uevent == nullptr) {
+    return std::nullopt;
   }
+  auto content = uevent->read();
+  if (!content) {
+    return std::nullopt;
+  }
+  PowerSupply supply;
+  waybar::util::procfs::forEachUeventProperty(
+      *content, [&supply](std::string_view key, std::string_view value) {
+        constexpr std::string_view prefix = "POWER_SUPPLY_";
+        if (!key.starts_with(prefix)) {
+          return;
+        }
+        key.remove_prefix(prefix.size());
+        if (key == "STATUS") {
+          supply.status.emplace(value);
+          return;
+        }
+        auto field = numbers.find(key);
+        int64_t number;
+        if (field != numbers.end() &&
+            std::from_chars(value.data(), value.data() + value.size(), number).ec ==
+                std::errc()) {
+          supply.*(field->second) = number;
+        }
+      });
+  return supply;
+}
 
-  global_watch_fd_ = inotify_init1(IN_CLOEXEC);
-  if (global_watch_fd_ == -1) {
-    throw std::runtime_error("Unable to listen batteries.");
+int openUeventSocket() {
+  int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+  if (fd == -1) {
+    return -1;
   }
+  sockaddr_nl addr{};
+  addr.nl_family = AF_NETLINK;
+  // The kernel's own uevents, udev isn't needed to tell that a battery changed
+  addr.nl_groups = 1;
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+    int error = errno;
+    close(fd);
+    errno = error;
+    return -1;
+  }
+  return fd;
+}
 
-  // Watch the directory for any added or removed batteries
-  global_watch = inotify_add_watch(global_watch_fd_, data_dir_.c_str(), IN_CREATE | IN_DELETE);
-  if (global_watch < 0) {
-    throw std::runtime_error("Could not watch for battery plug/unplug");
+}  // namespace
+#endif
+
+waybar::modules::Battery::Battery(const std::string& id, const Bar& bar, const Json::Value& config)
+    : ALabel(config, "battery", id, "{capacity}%", 60), last_event_(""), bar_(bar) {
+#if defined(__linux__)
+  uevent_fd_ = openUeventSocket();
+  if (uevent_fd_ == -1) {
+    spdlog::warn("battery: can't listen to uevents ({}), rescanning batteries every interval",
+                 strerror(errno));
   }
+  uevents_ = uevent_fd_ != -1;
 #endif
   spdlog::debug("battery: worker interval is {}", interval_.count());
   worker();
@@ -34,61 +132,87 @@ waybar::modules::Battery::Battery(const std::string& id, const Bar& bar, const J
 
 waybar::modules::Battery::~Battery() {
 #if defined(__linux__)
-  std::lock_guard<std::mutex> guard(battery_list_mutex_);
-
-  if (global_watch >= 0) {
-    inotify_rm_watch(global_watch_fd_, global_watch);
-  }
-  close(global_watch_fd_);
-
-  for (auto it = batteries_.cbegin(), next_it = it; it != batteries_.cend(); it = next_it) {
-    ++next_it;
-    auto watch_id = (*it).second;
-    if (watch_id >= 0) {
-      inotify_rm_watch(battery_watch_fd_, watch_id);
-    }
-    batteries_.erase(it);
+  thread_.stop();
+  if (uevent_fd_ != -1) {
+    close(uevent_fd_);
   }
-  close(battery_watch_fd_);
 #endif
 }
 
 void waybar::modules::Battery::worker() {
 #if defined(__FreeBSD__)
-  thread_timer_ = [this] {
-    dp.emit();
-    thread_timer_.sleep_for(interval_);
-  };
+  timer_ = util::ScheduledTask(interval_, [this] { emitUpdate(); }, interval_align_);
 #else
-  thread_timer_ = [this] {
-    // Make sure we eventually update the list of batteries even if we miss an
-    // inotify event for some reason
-    refreshBatteries();
-    dp.emit();
-    thread_timer_.sleep_for(interval_);
-  };
+  timer_ = util::ScheduledTask(
+      interval_,
+      [this, scanned = false]() mutable {
+        // Batteries coming and going are otherwise told by uevents
+        if (!scanned || !uevents_) {
+          refreshBatteries();
+          scanned = true;
+        }
+        emitUpdate();
+      },
+      interval_align_);
+  if (uevent_fd_ == -1) {
+    return;
+  }
   thread_ = [this] {
-    struct inotify_event event = {0};
-    int nbytes = read(battery_watch_fd_, &event, sizeof(event));
-    if (nbytes != sizeof(event) || event.mask & IN_IGNORED) {
+    // Kernel uevents are smaller than UEVENT_BUFFER_SIZE
+    std::array<char, 2048> buffer;
+    sockaddr_nl sender{};
+    socklen_t sender_len = sizeof(sender);
+    auto n = recvfrom(uevent_fd_, buffer.data(), buffer.size(), 0,
+                      reinterpret_cast<sockaddr*>(&sender), &sender_len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        return;
+      }
+      if (errno == ENOBUFS) {
+        // Events were dropped, batteries may have come or gone
+        refreshBatteries();
+        dp.emit();
+        return;
+      }
+      if (thread_.isRunning()) {
+        spdlog::warn("battery: lost uevents ({}), rescanning batteries every interval",
+                     strerror(errno));
+      }
+      uevents_ = false;
       thread_.stop();
       return;
     }
-    dp.emit();
-  };
-  thread_battery_update_ = [this] {
-    struct inotify_event event = {0};
-    int nbytes = read(global_watch_fd_, &event, sizeof(event));
-    if (nbytes != sizeof(event) || event.mask & IN_IGNORED) {
-      thread_.stop();
-      return;
+    // Only the kernel sends to this group
+    if (sender.nl_pid == 0) {
+      handleUevent({buffer.data(), static_cast<size_t>(n)});
     }
-    refreshBatteries();
-    dp.emit();
   };
 #endif
 }
 
+void waybar::modules::Battery::handleUevent(std::string_view message) {
+  std::string_view action;
+  std::string_view subsystem;
+  util::procfs::forEachUeventProperty(
+      message,
+      [&](std::string_view key, std::string_view value) {
+        if (key == "ACTION") {
+          action = value;
+        } else if (key == "SUBSYSTEM") {
+          subsystem = value;
+        }
+      },
+      '\0');
+  if (subsystem != "power_supply") {
+    return;
+  }
+  // Attribute changes only need an update, which reads them
+  if (action == "add" || action == "remove") {
+    refreshBatteries();
+  }
+  dp.emit();
+}
+
 void waybar::modules::Battery::refreshBatteries() {
 #if defined(__linux__)
   std::lock_guard<std::mutex> guard(battery_list_mutex_);
@@ -125,22 +249,19 @@ void waybar::modules::Battery::refreshBatteries() {
           }
 
           check_map[node.path()] = true;
-          auto search = batteries_.find(node.path());
-          if (search == batteries_.end()) {
-            // We've found a new battery save it and start listening for events
-            auto event_path = (node.path() / "uevent");
-            auto wd = inotify_add_watch(battery_watch_fd_, event_path.c_str(), IN_ACCESS);
-            if (wd < 0) {
-              throw std::runtime_error("Could not watch events for " + node.path().string());
-            }
-            batteries_[node.path()] = wd;
+          auto& uevent = batteries_[node.path()];
+          if (!uevent) {
+            // We've found a new battery, its uevent file stays open for the updates
+            uevent = std::make_unique<util::procfs::File>(node.path() / "uevent");
           }
         }
       }
       auto adap_defined = config_["adapter"].isString();
       if (((adap_defined && dir_name == config_["adapter"].asString()) || !adap_defined) &&
-          (fs::exists(node.path() / "online") || fs::exists(node.path() / "status"))) {
+          (fs::exists(node.path() / "online") || fs::exists(node.path() / "status")) &&
+          node.path() != adapter_) {
         adapter_ = node.path();
+        adapter_uevent_ = std::make_unique<util::procfs::File>(adapter_ / "uevent");
       }
     }
   } catch (fs::filesystem_error& e) {
@@ -156,13 +277,9 @@ void waybar::modules::Battery::refreshBatteries() {
     warnFirstTime_ = false;
   }
 
-  // Remove any batteries that are no longer present and unwatch them
+  // Remove any batteries that are no longer present, closing their uevent file
   for (auto const& check : check_map) {
     if (!check.second) {
-      auto watch_id = batteries_[check.first];
-      if (watch_id >= 0) {
-        inotify_rm_watch(battery_watch_fd_, watch_id);
-      }
       batteries_.erase(check.first);
     }
   }
@@ -262,110 +379,64 @@ waybar::modules::Battery::getInfos() {
 
     std::string status = "Unknown";
     for (auto const& item : batteries_) {
-      auto bat = item.first;
+      // A battery that can't be read counts as one without attributes
+      auto supply = readPowerSupply(item.second.get()).value_or(PowerSupply{});
       std::string _status;
 
       /* Check for adapter status if battery is not available */
-      if (!std::ifstream(bat / "status")) {
-        std::getline(std::ifstream(adapter_ / "status"), _status);
-      } else {
-        std::getline(std::ifstream(bat / "status"), _status);
+      if (supply.status) {
+        _status = *supply.status;
+      } else if (auto adapter = readPowerSupply(adapter_uevent_.get())) {
+        _status = adapter->status.value_or("");
       }
 
       // Some battery will report current and charge in μA/μAh.
       // Scale these by the voltage to get μW/μWh.
 
-      uint32_t current_now = 0;
-      int32_t _current_now_int = 0;
-      bool current_now_exists = false;
-      if (fs::exists(bat / "current_now")) {
-        current_now_exists = true;
-        std::ifstream(bat / "current_now") >> _current_now_int;
-      } else if (fs::exists(bat / "current_avg")) {
-        current_now_exists = true;
-        std::ifstream(bat / "current_avg") >> _current_now_int;
-      }
       // Documentation ABI allows a negative value when discharging, positive
       // value when charging.
-      current_now = std::abs(_current_now_int);
+      auto current = supply.current_now ? supply.current_now : supply.current_avg;
+      bool current_now_exists = current.has_value();
+      uint32_t current_now = std::abs(static_cast<int32_t>(current.value_or(0)));
 
-      if (fs::exists(bat / "time_to_empty_now")) {
+      if (supply.time_to_empty_now) {
         time_to_empty_now_exists = true;
-        std::ifstream(bat / "time_to_empty_now") >> time_to_empty_now;
+        time_to_empty_now = *supply.time_to_empty_now;
       }
 
-      if (fs::exists(bat / "time_to_full_now")) {
+      if (supply.time_to_full_now) {
         time_to_full_now_exists = true;
-        std::ifstream(bat / "time_to_full_now") >> time_to_full_now;
+        time_to_full_now = *supply.time_to_full_now;
       }
 
-      uint32_t voltage_now = 0;
-      bool voltage_now_exists = false;
-      if (fs::exists(bat / "voltage_now")) {
-        voltage_now_exists = true;
-        std::ifstream(bat / "voltage_now") >> voltage_now;
-      } else if (fs::exists(bat / "voltage_avg")) {
-        voltage_now_exists = true;
-        std::ifstream(bat / "voltage_avg") >> voltage_now;
-      }
+      auto voltage = supply.voltage_now ? supply.voltage_now : supply.voltage_avg;
+      bool voltage_now_exists = voltage.has_value();
+      uint32_t voltage_now = voltage.value_or(0);
 
-      uint32_t charge_full = 0;
-      bool charge_full_exists = false;
-      if (fs::exists(bat / "charge_full")) {
-        charge_full_exists = true;
-        std::ifstream(bat / "charge_full") >> charge_full;
-      }
+      bool charge_full_exists = supply.charge_full.has_value();
+      uint32_t charge_full = supply.charge_full.value_or(0);
 
-      uint32_t charge_full_design = 0;
-      bool charge_full_design_exists = false;
-      if (fs::exists(bat / "charge_full_design")) {
-        charge_full_design_exists = true;
-        std::ifstream(bat / "charge_full_design") >> charge_full_design;
-      }
+      bool charge_full_design_exists = supply.charge_full_design.has_value();
+      uint32_t charge_full_design = supply.charge_full_design.value_or(0);
 
-      uint32_t charge_now = 0;
-      bool charge_now_exists = false;
-      if (fs::exists(bat / "charge_now")) {
-        charge_now_exists = true;
-        std::ifstream(bat / "charge_now") >> charge_now;
-      }
+      bool charge_now_exists = supply.charge_now.has_value();
+      uint32_t charge_now = supply.charge_now.value_or(0);
 
-      uint32_t power_now = 0;
-      int32_t _power_now_int = 0;
-      bool power_now_exists = false;
-      if (fs::exists(bat / "power_now")) {
-        power_now_exists = true;
-        std::ifstream(bat / "power_now") >> _power_now_int;
-      }
       // Some drivers (example: Qualcomm) exposes use a negative value when
       // discharging, positive value when charging.
-      power_now = std::abs(_power_now_int);
+      bool power_now_exists = supply.power_now.has_value();
+      uint32_t power_now = std::abs(static_cast<int32_t>(supply.power_now.value_or(0)));
 
-      uint32_t energy_now = 0;
-      bool energy_now_exists = false;
-      if (fs::exists(bat / "energy_now")) {
-        energy_now_exists = true;
-        std::ifstream(bat / "energy_now") >> energy_now;
-      }
+      bool energy_now_exists = supply.energy_now.has_value();
+      uint32_t energy_now = supply.energy_now.value_or(0);
 
-      uint32_t energy_full = 0;
-      bool energy_full_exists = false;
-      if (fs::exists(bat / "energy_full")) {
-        energy_full_exists = true;
-        std::ifstream(bat / "energy_full") >> energy_full;
-      }
+      bool energy_full_exists = supply.energy_full.has_value();
+      uint32_t energy_full = supply.energy_full.value_or(0);
 
-      uint32_t energy_full_design = 0;
-      bool energy_full_design_exists = false;
-      if (fs::exists(bat / "energy_full_design")) {
-        energy_full_design_exists = true;
-        std::ifstream(bat / "energy_full_design") >> energy_full_design;
-      }
+      bool energy_full_design_exists = supply.energy_full_design.has_value();
+      uint32_t energy_full_design = supply.energy_full_design.value_or(0);
 
-      uint16_t cycleCount = 0;
-      if (fs::exists(bat / "cycle_count")) {
-        std::ifstream(bat / "cycle_count") >> cycleCount;
-      }
+      uint16_t cycleCount = supply.cycle_count.value_or(0);
       if (charge_full_design >= largestDesignCapacity) {
         largestDesignCapacity = charge_full_design;
 
@@ -394,9 +465,9 @@ waybar::modules::Battery::getInfos() {
       } else if (energy_now_exists && energy_full_exists && energy_full != 0) {
         capacity_exists = true;
         capacity = 100 * (uint64_t)energy_now / (uint64_t)energy_full;
-      } else if (fs::exists(bat / "capacity")) {
+      } else if (supply.capacity) {
         capacity_exists = true;
-        std::ifstream(bat / "capacity") >> capacity;
+        capacity = *supply.capacity;
       }
 
       if (!voltage_now_exists) {
@@ -546,12 +617,10 @@ waybar::modules::Battery::getInfos() {
 
     // Give `Plugged` higher priority over `Not charging`.
     // So in a setting where TLP is used, `Plugged` is shown when the threshold is reached
-    if (!adapter_.empty() && (status == "Discharging" || status == "Not charging")) {
-      bool online;
-      std::string current_status;
-      std::ifstream(adapter_ / "online") >> online;
-      std::getline(std::ifstream(adapter_ / "status"), current_status);
-      if (online && current_status != "Discharging") status = "Plugged";
+    if (status == "Discharging" || status == "Not charging") {
+      auto adapter = readPowerSupply(adapter_uevent_.get());
+      if (adapter && adapter->online.value_or(0) != 0 && adapter->status != "Discharging")
+        status = "Plugged";
     }
 
     float time_remaining{0.0f};
@@ -622,7 +691,7 @@ waybar::modules::Battery::getInfos() {
   }
 }
 
-const std::string waybar::modules::Battery::getAdapterStatus(uint8_t capacity) const {
+const std::string waybar::modules::Battery::getAdapterStatus(uint8_t capacity) {
 #if defined(__FreeBSD__)
   int state;
   size_t size_state = sizeof state;
@@ -633,11 +702,10 @@ const std::string waybar::modules::Battery::getAdapterStatus(uint8_t capacity) c
   std::string status{"Unknown"};  // TODO: add status in FreeBSD
   {
 #else
-  if (!adapter_.empty()) {
-    bool online;
-    std::string status;
-    std::ifstream(adapter_ / "online") >> online;
-    std::getline(std::ifstream(adapter_ / "status"), status);
+  std::lock_guard<std::mutex> guard(battery_list_mutex_);
+  if (auto adapter = readPowerSupply(adapter_uevent_.get())) {
+    bool online = adapter->online.value_or(0) != 0;
+    std::string status = adapter->status.value_or("");
 #endif
     if (capacity == 100) {
       return "Full";
@@ -663,8 +731,8 @@ const std::string waybar::modules::Battery::formatTimeRemaining(float hoursRemai
     format = config_["format-time"].asString();
   }
   std::string zero_pad_minutes = fmt::format("{:02d}", minutes);
-  return fmt::format(fmt::runtime(format), fmt::arg("H", full_hours), fmt::arg("M", minutes),
-                     fmt::arg("m", zero_pad_minutes));
+  return compiledFormat(format).format(fmt::arg("H", full_hours), fmt::arg("M", minutes),
+                                       fmt::arg("m", zero_pad_minutes));
 }
 
 auto waybar::modules::Battery::update() -> void {
@@ -708,11 +776,13 @@ auto waybar::modules::Battery::update() -> void {
     } else if (config_["tooltip-format"].isString()) {
       tooltip_format = config_["tooltip-format"].asString();
     }
-    label_.set_tooltip_markup(
-        fmt::format(fmt::runtime(tooltip_format), fmt::arg("timeTo", tooltip_text_default),
-                    fmt::arg("power", power), fmt::arg("capacity", capacity),
-                    fmt::arg("time", time_remaining_formatted), fmt::arg("cycles", cycles),
-                    fmt::arg("health", fmt::format("{:.3}", health))));
+    const auto& compiled_tooltip = compiledFormat(tooltip_format);
+    label_.set_tooltip_markup(compiled_tooltip.format(
+        fmt::arg("timeTo", tooltip_text_default), fmt::arg("power", power),
+        fmt::arg("capacity", capacity), fmt::arg("time", time_remaining_formatted),
+        fmt::arg("cycles", cycles),
+        fmt::arg("health",
+                 compiled_tooltip.uses("health") ? fmt::format("{:.3}", health) : "")));
   }
   if (!old_status_.empty()) {
     label_.get_style_context()->remove_class(old_status_);
@@ -730,11 +800,15 @@ auto waybar::modules::Battery::update() -> void {
     event_box_.hide();
   } else {
     event_box_.show();
-    auto icons = std::vector<std::string>{status + "-" + state, status, state};
-    label_.set_markup(fmt::format(
-        fmt::runtime(format), fmt::arg("capacity", capacity), fmt::arg("power", power),
-        fmt::arg("icon", getIcon(capacity, icons)), fmt::arg("time", time_remaining_formatted),
-        fmt::arg("cycles", cycles), fmt::arg("health", fmt::format("{:.3}", health))));
+    const auto& compiled = compiledFormat(format);
+    std::string icon;
+    if (compiled.uses("icon")) {
+      icon = getIcon(capacity, std::vector<std::string>{status + "-" + state, status, state});
+    }
+    label_.set_markup(compiled.format(
+        fmt::arg("capacity", capacity), fmt::arg("power", power), fmt::arg("icon", icon),
+        fmt::arg("time", time_remaining_formatted), fmt::arg("cycles", cycles),
+        fmt::arg("health", compiled.uses("health") ? fmt::format("{:.3}", health) : "")));
   }
   // Call parent update
   ALabel::update();
@@ -1,5 +1,7 @@
 #include "modules/cpu_frequency.hpp"
 
+#include "util/shared_sample.hpp"
+
 // In the 80000 version of fmt library authors decided to optimize imports
 // and moved declarations required for fmt::dynamic_format_arg_store in new
 // header fmt/args.h
@@ -11,15 +13,13 @@
 
 waybar::modules::CpuFrequency::CpuFrequency(const std::string& id, const Json::Value& config)
     : ALabel(config, "cpu_frequency", id, "{avg_frequency}", 10) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+  timer_ = util::ScheduledTask(interval_, [this] { emitUpdate(); }, interval_align_);
 }
 
 auto waybar::modules::CpuFrequency::update() -> void {
   // TODO: as creating dynamic fmt::arg arrays is buggy we have to calc both
-  auto [max_frequency, min_frequency, avg_frequency] = CpuFrequency::getCpuFrequency();
+  auto [max_frequency, min_frequency, avg_frequency] =
+      CpuFrequency::getCpuFrequency(interval_ / 2);
   if (tooltipEnabled()) {
     auto tooltip =
         fmt::format("Minimum frequency: {}\nAverage frequency: {}\nMaximum frequency: {}\n",
@@ -49,8 +49,12 @@ auto waybar::modules::CpuFrequency::update() -> void {
   ALabel::update();
 }
 
-std::tuple<float, float, float> waybar::modules::CpuFrequency::getCpuFrequency() {
-  std::vector<float> frequencies = CpuFrequency::parseCpuFrequencies();
+std::tuple<float, float, float> waybar::modules::CpuFrequency::getCpuFrequency(
+    std::chrono::milliseconds max_age) {
+  // /proc/cpuinfo is read once for the cpu and cpu_frequency modules of every bar
+  static util::SharedSample<std::vector<float>> sample{&CpuFrequency::parseCpuFrequencies};
+  auto snapshot = sample.get(max_age);
+  const auto& frequencies = *snapshot;
   if (frequencies.empty()) {
     return {0.f, 0.f, 0.f};
   }
@@ -1,77 +1,98 @@
 #include "modules/cpu_usage.hpp"
 
-// In the 80000 version of fmt library authors decided to optimize imports
-// and moved declarations required for fmt::dynamic_format_arg_store in new
-// header fmt/args.h
-#if (FMT_VERSION >= 80000)
-#include <fmt/args.h>
-#else
-#include <fmt/core.h>
-#endif
+#include <array>
+#include <charconv>
+
+#include "util/shared_sample.hpp"
 
 waybar::modules::CpuUsage::CpuUsage(const std::string& id, const Json::Value& config)
     : ALabel(config, "cpu_usage", id, "{usage}%", 10) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+  timer_ = util::ScheduledTask(interval_, [this] { emitUpdate(); }, interval_align_);
 }
 
 auto waybar::modules::CpuUsage::update() -> void {
-  // TODO: as creating dynamic fmt::arg arrays is buggy we have to calc both
-  auto [cpu_usage, tooltip] = CpuUsage::getCpuUsage(prev_times_);
+  auto [cpu_usage, tooltip] = CpuUsage::getCpuUsage(prev_times_, interval_ / 2);
   if (tooltipEnabled()) {
     label_.set_tooltip_text(tooltip);
   }
-  auto format = format_;
   auto total_usage = cpu_usage.empty() ? 0 : cpu_usage[0];
   auto state = getState(total_usage);
-  if (!state.empty() && config_["format-" + state].isString()) {
-    format = config_["format-" + state].asString();
-  }
+  const auto& format = stateFormat(state);
 
   if (format.empty()) {
     event_box_.hide();
   } else {
     event_box_.show();
     auto icons = std::vector<std::string>{state};
-    fmt::dynamic_format_arg_store<fmt::format_context> store;
-    store.push_back(fmt::arg("usage", total_usage));
-    store.push_back(fmt::arg("icon", getIcon(total_usage, icons)));
-    for (size_t i = 1; i < cpu_usage.size(); ++i) {
-      auto core_i = i - 1;
-      auto core_format = fmt::format("usage{}", core_i);
-      store.push_back(fmt::arg(core_format.c_str(), cpu_usage[i]));
-      auto icon_format = fmt::format("icon{}", core_i);
-      store.push_back(fmt::arg(icon_format.c_str(), getIcon(cpu_usage[i], icons)));
-    }
-    label_.set_markup(fmt::vformat(format, store));
+    // Only the fields, and cores, the format references are computed
+    auto lookup = [&](std::string_view field, auto emit) {
+      if (field == "usage") {
+        emit(total_usage);
+      } else if (field == "icon") {
+        emit(getIcon(total_usage, icons));
+      } else if (auto core = coreIndex(field, "usage", cpu_usage)) {
+        emit(cpu_usage[*core]);
+      } else if (auto icon_core = coreIndex(field, "icon", cpu_usage)) {
+        emit(getIcon(cpu_usage[*icon_core], icons));
+      }
+    };
+    static constexpr std::array<std::string_view, 2> POSITIONAL = {"usage", "icon"};
+    label_.set_markup(format.formatLookup(lookup, POSITIONAL));
   }
 
   // Call parent update
   ALabel::update();
 }
 
+std::optional<size_t> waybar::modules::CpuUsage::coreIndex(std::string_view field,
+                                                          std::string_view prefix,
+                                                          const std::vector<uint16_t>& usage) {
+  if (!field.starts_with(prefix) || field.size() == prefix.size()) {
+    return std::nullopt;
+  }
+  size_t core;
+  auto end = field.data() + field.size();
+  auto [ptr, ec] = std::from_chars(field.data() + prefix.size(), end, core);
+  // The first entry is the total usage
+  if (ec != std::errc() || ptr != end || core + 1 >= usage.size()) {
+    return std::nullopt;
+  }
+  return core + 1;
+}
+
 std::tuple<std::vector<uint16_t>, std::string> waybar::modules::CpuUsage::getCpuUsage(
-    std::vector<std::tuple<size_t, size_t>>& prev_times) {
-  if (prev_times.empty()) {
-    prev_times = CpuUsage::parseCpuinfo();
+    std::shared_ptr<const CpuTimes>& prev_times, std::chrono::milliseconds max_age) {
+  // /proc/stat is read once for the cpu and cpu_usage modules of every bar
+  static util::SharedSample<CpuTimes> cpu_times{&CpuUsage::parseCpuinfo};
+
+  if (!prev_times) {
+    prev_times = cpu_times.get(max_age);
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // Force a new sample, the cached one would give an empty delta
+    max_age = std::chrono::milliseconds(0);
   }
-  std::vector<std::tuple<size_t, size_t>> curr_times = CpuUsage::parseCpuinfo();
+  auto curr_times = cpu_times.get(max_age);
   std::string tooltip;
   std::vector<uint16_t> usage;
 
-  if (curr_times.size() != prev_times.size()) {
+  auto get_usage = [](const auto& curr, const auto& prev) -> uint16_t {
+    auto [curr_idle, curr_total] = curr;
+    auto [prev_idle, prev_total] = prev;
+    const float delta_idle = curr_idle - prev_idle;
+    const float delta_total = curr_total - prev_total;
+    if (delta_total <= 0) {
+      // Same snapshot as last time
+      return 0;
+    }
+    return 100 * (1 - delta_idle / delta_total);
+  };
+
+  if (curr_times->size() != prev_times->size()) {
     // The number of CPUs has changed, eg. due to CPU hotplug
     // We don't know which CPU came up or went down
     // so only give total usage (if we can)
-    if (!curr_times.empty() && !prev_times.empty()) {
-      auto [curr_idle, curr_total] = curr_times[0];
-      auto [prev_idle, prev_total] = prev_times[0];
-      const float delta_idle = curr_idle - prev_idle;
-      const float delta_total = curr_total - prev_total;
-      uint16_t tmp = 100 * (1 - delta_idle / delta_total);
+    if (!curr_times->empty() && !prev_times->empty()) {
+      uint16_t tmp = get_usage((*curr_times)[0], (*prev_times)[0]);
       tooltip = fmt::format("Total: {}%\nCores: (pending)", tmp);
       usage.push_back(tmp);
     } else {
@@ -82,18 +103,16 @@ std::tuple<std::vector<uint16_t>, std::string> waybar::modules::CpuUsage::getCpu
     return {usage, tooltip};
   }
 
-  for (size_t i = 0; i < curr_times.size(); ++i) {
-    auto [curr_idle, curr_total] = curr_times[i];
-    auto [prev_idle, prev_total] = prev_times[i];
+  for (size_t i = 0; i < curr_times->size(); ++i) {
+    auto [curr_idle, curr_total] = (*curr_times)[i];
+    auto [prev_idle, prev_total] = (*prev_times)[i];
     if (i > 0 && (curr_total == 0 || prev_total == 0)) {
       // This CPU is offline
       tooltip = tooltip + fmt::format("\nCore{}: offline", i - 1);
       usage.push_back(0);
       continue;
     }
-    const float delta_idle = curr_idle - prev_idle;
-    const float delta_total = curr_total - prev_total;
-    uint16_t tmp = 100 * (1 - delta_idle / delta_total);
+    uint16_t tmp = get_usage((*curr_times)[i], (*prev_times)[i]);
     if (i == 0) {
       tooltip = fmt::format("Total: {}%", tmp);
     } else {
@@ -2,148 +2,258 @@
 
 #include <spdlog/spdlog.h>
 
-#include "util/scope_guard.hpp"
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <utility>
 
-waybar::modules::Custom::Custom(const std::string& name, const std::string& id,
-                                const Json::Value& config, const std::string& output_name)
-    : ALabel(config, "custom-" + name, id, "{}"),
-      name_(name),
-      output_name_(output_name),
-      id_(id),
-      tooltip_format_enabled_{config_["tooltip-format"].isString()},
-      percentage_(0),
-      fp_(nullptr),
-      pid_(-1) {
-  if (config.isNull()) {
-    spdlog::warn("There is no configuration for 'custom/{}', element will be hidden", name);
-  }
-  dp.emit();
+#include "util/tsv.hpp"
+
+waybar::modules::CustomRunner::CustomRunner(const std::string& name, const Json::Value& config,
+                                            std::chrono::milliseconds interval,
+                                            const std::string& output_name)
+    : name_{name},
+      config_{config},
+      interval_{interval},
+      output_name_{output_name},
+      exec_direct_{config_["exec-direct"].asBool()} {
   if (!config_["signal"].empty() && config_["interval"].empty() &&
       config_["restart-interval"].empty()) {
     waitingWorker();
   } else if (interval_.count() > 0) {
     delayWorker();
   } else if (config_["exec"].isString()) {
+    continuous_ = true;
     continuousWorker();
   }
 }
 
-waybar::modules::Custom::~Custom() {
+waybar::modules::CustomRunner::~CustomRunner() {
+  {
+    std::lock_guard lock(continuous_mutex_);
+    continuous_stopped_ = true;
+    // Nothing wakes the task up once the stream is removed
+    stream_.reset();
+    if (pending_fd_ != -1) {
+      ::close(pending_fd_);
+    }
+  }
+  continuous_task_.stop();
   if (pid_ != -1) {
     killpg(pid_, SIGTERM);
-    waitpid(pid_, NULL, 0);
+    util::waitChild(pid_);
     pid_ = -1;
   }
 }
 
-void waybar::modules::Custom::delayWorker() {
-  thread_ = [this] {
-    for (int i : this->pid_children_) {
-      int status;
-      waitpid(i, &status, 0);
-    }
+std::shared_ptr<waybar::modules::CustomRunner> waybar::modules::CustomRunner::shared(
+    const std::string& name, const Json::Value& config, std::chrono::milliseconds interval) {
+  static std::mutex mutex;
+  static std::map<std::string, std::weak_ptr<CustomRunner>> runners;
 
-    this->pid_children_.clear();
+  // Modules share a runner when they run the same commands the same way
+  Json::Value settings;
+  for (const char* key :
+       {"exec", "exec-if", "exec-direct", "interval", "restart-interval", "signal"}) {
+    settings[key] = config[key];
+  }
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  auto key = Json::writeString(builder, settings);
 
-    bool can_update = true;
-    if (config_["exec-if"].isString()) {
-      output_ = util::command::execNoRead(config_["exec-if"].asString());
-      if (output_.exit_code != 0) {
-        can_update = false;
-        dp.emit();
-      }
-    }
-    if (can_update) {
-      if (config_["exec"].isString()) {
-        output_ = util::command::exec(config_["exec"].asString(), output_name_);
-      }
-      dp.emit();
+  std::lock_guard lock(mutex);
+  std::erase_if(runners, [](const auto& entry) { return entry.second.expired(); });
+  auto& runner = runners[key];
+  auto shared = runner.lock();
+  if (!shared) {
+    shared = std::make_shared<CustomRunner>(name, config, interval, "");
+    runner = shared;
+  }
+  return shared;
+}
+
+uint64_t waybar::modules::CustomRunner::subscribe(Callback callback) {
+  std::lock_guard lock(subscribers_mutex_);
+  if (last_) {
+    callback(*last_);
+  }
+  auto id = next_id_++;
+  subscribers_.emplace(id, std::move(callback));
+  return id;
+}
+
+void waybar::modules::CustomRunner::unsubscribe(uint64_t id) {
+  std::lock_guard lock(subscribers_mutex_);
+  subscribers_.erase(id);
+}
+
+void waybar::modules::CustomRunner::publish(const util::command::res& output) {
+  std::lock_guard lock(subscribers_mutex_);
+  last_ = output;
+  for (auto& [id, callback] : subscribers_) {
+    callback(output);
+  }
+}
+
+void waybar::modules::CustomRunner::wake_up(std::vector<int> children) {
+  if (continuous_) {
+    // Updated by the command itself
+    return;
+  }
+  {
+    std::lock_guard lock(children_mutex_);
+    children_.insert(children_.end(), children.begin(), children.end());
+  }
+  thread_.wake_up();
+}
+
+void waybar::modules::CustomRunner::waitChildren() {
+  std::vector<int> children;
+  {
+    std::lock_guard lock(children_mutex_);
+    children.swap(children_);
+  }
+  for (int pid : children) {
+    if (pid > 0) {
+      util::waitChild(pid);
     }
+  }
+}
+
+void waybar::modules::CustomRunner::run() {
+  util::command::res output{0, ""};
+  if (config_["exec-if"].isString()) {
+    output = util::command::execNoRead(config_["exec-if"].asString(), exec_direct_);
+  }
+  if (output.exit_code == 0 && config_["exec"].isString()) {
+    output = util::command::exec(config_["exec"].asString(), output_name_, exec_direct_);
+  }
+  publish(output);
+}
+
+void waybar::modules::CustomRunner::delayWorker() {
+  thread_ = [this] {
+    waitChildren();
+    run();
     thread_.sleep_for(interval_);
   };
 }
 
-void waybar::modules::Custom::continuousWorker() {
+void waybar::modules::CustomRunner::waitingWorker() {
+  thread_ = [this] {
+    waitChildren();
+    run();
+    thread_.sleep();
+  };
+}
+
+void waybar::modules::CustomRunner::continuousWorker() {
   auto cmd = config_["exec"].asString();
   pid_ = -1;
-  fp_ = util::command::open(cmd, pid_, output_name_);
-  if (!fp_) {
+  pending_fd_ = util::command::openFd(cmd, pid_, output_name_, exec_direct_);
+  if (pending_fd_ == -1) {
     throw std::runtime_error("Unable to open " + cmd);
   }
-  thread_ = [this, cmd] {
-    char* buff = nullptr;
-    waybar::util::ScopeGuard buff_deleter([&buff]() {
-      if (buff) {
-        free(buff);
-      }
-    });
-    size_t len = 0;
-    if (getline(&buff, &len, fp_) == -1) {
-      int exit_code = 1;
-      if (fp_) {
-        exit_code = WEXITSTATUS(util::command::close(fp_, pid_));
-        fp_ = nullptr;
-      }
-      if (exit_code != 0) {
-        output_ = {exit_code, ""};
-        dp.emit();
-        spdlog::error("{} stopped unexpectedly, is it endless?", name_);
-      }
-      if (config_["restart-interval"].isNumeric()) {
-        pid_ = -1;
-        thread_.sleep_for(std::chrono::milliseconds(
-            std::max(1L,  // Minimum 1ms due to millisecond precision
-                     static_cast<long>(config_["restart-interval"].asDouble() * 1000))));
-        fp_ = util::command::open(cmd, pid_, output_name_);
-        if (!fp_) {
-          throw std::runtime_error("Unable to open " + cmd);
-        }
-      } else {
-        thread_.stop();
-        return;
-      }
-    } else {
-      std::string output = buff;
+  // Runs right away to start reading. It waits for the lock until the task is assigned.
+  std::lock_guard lock(continuous_mutex_);
+  continuous_task_ =
+      util::ScheduledTask(std::chrono::milliseconds::max(), [this] { handleContinuous(); });
+}
 
-      // Remove last newline
-      if (!output.empty() && output[output.length() - 1] == '\n') {
-        output.erase(output.length() - 1);
-      }
-      output_ = {0, output};
-      dp.emit();
+void waybar::modules::CustomRunner::handleContinuous() {
+  std::lock_guard lock(continuous_mutex_);
+  if (continuous_stopped_) {
+    return;
+  }
+  if (pid_ == -1) {
+    // Restarted after "restart-interval"
+    auto cmd = config_["exec"].asString();
+    pending_fd_ = util::command::openFd(cmd, pid_, output_name_, exec_direct_);
+    if (pending_fd_ == -1) {
+      spdlog::error("Unable to open {}", cmd);
+      return;
     }
-  };
+  }
+  if (pending_fd_ != -1) {
+    readContinuous(std::exchange(pending_fd_, -1));
+    return;
+  }
+  if (!stream_ended_) {
+    return;
+  }
+
+  stream_.reset();
+  // Not waited for: the command may close its output and keep running, which mustn't hold up the
+  // scheduler's workers or the destructor. Checked again, less and less often, until it exits.
+  auto status = util::tryWaitChild(pid_);
+  if (!status) {
+    continuous_task_.wake_up_at(util::Scheduler::Clock::now() + reap_delay_);
+    reap_delay_ = std::min(reap_delay_ * 2, MAX_REAP_DELAY);
+    return;
+  }
+  stream_ended_ = false;
+  reap_delay_ = MIN_REAP_DELAY;
+  int exit_code = WEXITSTATUS(*status);
+  pid_ = -1;
+  if (exit_code != 0) {
+    publish({exit_code, ""});
+    spdlog::error("{} stopped unexpectedly, is it endless?", name_);
+  }
+  if (config_["restart-interval"].isNumeric()) {
+    auto restart_interval = std::chrono::milliseconds(
+        std::max(1L,  // Minimum 1ms due to millisecond precision
+                 static_cast<long>(config_["restart-interval"].asDouble() * 1000)));
+    continuous_task_.wake_up_at(util::Scheduler::Clock::now() + restart_interval);
+  }
 }
 
-void waybar::modules::Custom::waitingWorker() {
-  thread_ = [this] {
-    bool can_update = true;
-    if (config_["exec-if"].isString()) {
-      output_ = util::command::execNoRead(config_["exec-if"].asString());
-      if (output_.exit_code != 0) {
-        can_update = false;
-        dp.emit();
-      }
-    }
-    if (can_update) {
-      if (config_["exec"].isString()) {
-        output_ = util::command::exec(config_["exec"].asString(), output_name_);
-      }
-      dp.emit();
-    }
-    thread_.sleep();
-  };
+// Must be called with continuous_mutex_ held
+void waybar::modules::CustomRunner::readContinuous(int fd) {
+  stream_ended_ = false;
+  stream_ = util::LineStream(
+      fd, [this](std::string_view line) { publish({0, std::string(line)}); },
+      [this] {
+        stream_ended_ = true;
+        continuous_task_.wake_up();
+      });
 }
 
+waybar::modules::Custom::Custom(const std::string& name, const std::string& id,
+                                const Json::Value& config, const std::string& output_name)
+    : ALabel(config, "custom-" + name, id, "{}"),
+      name_(name),
+      output_name_(output_name),
+      return_type_(config_["return-type"].asString()),
+      id_(id),
+      tooltip_format_enabled_{config_["tooltip-format"].isString()},
+      percentage_(0) {
+  if (config.isNull()) {
+    spdlog::warn("There is no configuration for 'custom/{}', element will be hidden", name);
+  }
+  dp.emit();
+  if (config_["shared"].asBool()) {
+    runner_ = CustomRunner::shared(name, config_, interval_);
+  } else {
+    runner_ = std::make_shared<CustomRunner>(name, config_, interval_, output_name);
+  }
+  subscription_ = runner_->subscribe([this](const util::command::res& output) {
+    output_ = output;
+    dp.emit();
+  });
+}
+
+waybar::modules::Custom::~Custom() { runner_->unsubscribe(subscription_); }
+
 void waybar::modules::Custom::refresh(int sig) {
   if (sig == SIGRTMIN + config_["signal"].asInt()) {
-    thread_.wake_up();
+    runner_->wake_up();
   }
 }
 
 void waybar::modules::Custom::handleEvent() {
   if (!config_["exec-on-event"].isBool() || config_["exec-on-event"].asBool()) {
-    thread_.wake_up();
+    // The runner waits for the actions before running the command again
+    runner_->wake_up(std::exchange(pid_children_, {}));
   }
 }
 
@@ -165,8 +275,10 @@ auto waybar::modules::Custom::update() -> void {
       (output_.out.empty() || output_.exit_code != 0)) {
     event_box_.hide();
   } else {
-    if (config_["return-type"].asString() == "json") {
+    if (return_type_ == "json") {
       parseOutputJson();
+    } else if (return_type_ == "tsv") {
+      parseOutputTsv();
     } else {
       parseOutputRaw();
     }
@@ -294,3 +406,44 @@ void waybar::modules::Custom::parseOutputJson() {
     break;
   }
 }
+
+void waybar::modules::Custom::parseOutputTsv() {
+  // Only the first line, like with json. The fields are resolved into the buffers of the
+  // previous update, so that commands updating many times a second don't allocate.
+  std::string_view line = output_.out;
+  line = line.substr(0, line.find('\n'));
+  std::array<std::string_view, 5> fields;
+  util::tsv::split(line, fields);
+
+  const bool escape = config_["escape"].isBool() && config_["escape"].asBool();
+  auto assign = [escape](std::string_view field, std::string& out) {
+    util::tsv::unescape(field, out);
+    if (escape) {
+      out = Glib::Markup::escape_text(out);
+    }
+  };
+  assign(fields[0], text_);
+  assign(fields[1], tooltip_);
+
+  // Blank separated classes
+  size_t classes = 0;
+  auto names = fields[2];
+  while (!names.empty()) {
+    auto end = names.find(' ');
+    auto name = names.substr(0, end);
+    names.remove_prefix(end == std::string_view::npos ? names.size() : end + 1);
+    if (name.empty()) {
+      continue;
+    }
+    if (classes < class_.size()) {
+      class_[classes].assign(name);
+    } else {
+      class_.emplace_back(name);
+    }
+    ++classes;
+  }
+  class_.resize(classes);
+
+  percentage_ = util::tsv::toInt(fields[3]);
+  assign(fields[4], alt_);
+}
@@ -1,13 +1,13 @@
 #include "modules/disk.hpp"
 
+#include <array>
+#include <string_view>
+
 using namespace waybar::util;
 
 waybar::modules::Disk::Disk(const std::string& id, const Json::Value& config)
     : ALabel(config, "disk", id, "{}%", 30), path_("/") {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+  timer_ = util::ScheduledTask(interval_, [this] { emitUpdate(); }, interval_align_);
   if (config["path"].isString()) {
     path_ = config["path"].asString();
   }
@@ -46,47 +46,51 @@ auto waybar::modules::Disk::update() -> void {
     return;
   }
 
-  float specific_free, specific_used, specific_total, divisor;
-
-  divisor = calc_specific_divisor(unit_);
-  specific_free = (stats.f_bavail * stats.f_frsize) / divisor;
-  specific_used = ((stats.f_blocks - stats.f_bfree) * stats.f_frsize) / divisor;
-  specific_total = (stats.f_blocks * stats.f_frsize) / divisor;
-
-  auto free = pow_format(stats.f_bavail * stats.f_frsize, "B", true);
-  auto used = pow_format((stats.f_blocks - stats.f_bfree) * stats.f_frsize, "B", true);
-  auto total = pow_format(stats.f_blocks * stats.f_frsize, "B", true);
   auto percentage_used = (stats.f_blocks - stats.f_bfree) * 100 / stats.f_blocks;
+  auto percentage_free = stats.f_bavail * 100 / stats.f_blocks;
+
+  // Only the fields the formats reference are computed and formatted
+  auto lookup = [&](std::string_view field, auto emit) {
+    if (field == "free") {
+      emit(pow_format(stats.f_bavail * stats.f_frsize, "B", true));
+    } else if (field == "percentage_free") {
+      emit(percentage_free);
+    } else if (field == "used") {
+      emit(pow_format((stats.f_blocks - stats.f_bfree) * stats.f_frsize, "B", true));
+    } else if (field == "percentage_used") {
+      emit(percentage_used);
+    } else if (field == "total") {
+      emit(pow_format(stats.f_blocks * stats.f_frsize, "B", true));
+    } else if (field == "path") {
+      emit(path_);
+    } else if (field == "specific_free") {
+      emit(static_cast<float>(stats.f_bavail * stats.f_frsize) / calc_specific_divisor(unit_));
+    } else if (field == "specific_used") {
+      emit(static_cast<float>((stats.f_blocks - stats.f_bfree) * stats.f_frsize) /
+           calc_specific_divisor(unit_));
+    } else if (field == "specific_total") {
+      emit(static_cast<float>(stats.f_blocks * stats.f_frsize) / calc_specific_divisor(unit_));
+    }
+  };
+  // "{}" is the free percentage
+  static constexpr std::array<std::string_view, 1> POSITIONAL = {"percentage_free"};
 
-  auto format = format_;
   auto state = getState(percentage_used);
-  if (!state.empty() && config_["format-" + state].isString()) {
-    format = config_["format-" + state].asString();
-  }
+  const auto& format = stateFormat(state);
 
   if (format.empty()) {
     event_box_.hide();
   } else {
     event_box_.show();
-    label_.set_markup(fmt::format(
-        fmt::runtime(format), stats.f_bavail * 100 / stats.f_blocks, fmt::arg("free", free),
-        fmt::arg("percentage_free", stats.f_bavail * 100 / stats.f_blocks), fmt::arg("used", used),
-        fmt::arg("percentage_used", percentage_used), fmt::arg("total", total),
-        fmt::arg("path", path_), fmt::arg("specific_free", specific_free),
-        fmt::arg("specific_used", specific_used), fmt::arg("specific_total", specific_total)));
+    label_.set_markup(format.formatLookup(lookup, POSITIONAL));
   }
 
   if (tooltipEnabled()) {
-    std::string tooltip_format = "{used} used out of {total} on {path} ({percentage_used}%)";
-    if (config_["tooltip-format"].isString()) {
-      tooltip_format = config_["tooltip-format"].asString();
-    }
-    label_.set_tooltip_text(fmt::format(
-        fmt::runtime(tooltip_format), stats.f_bavail * 100 / stats.f_blocks, fmt::arg("free", free),
-        fmt::arg("percentage_free", stats.f_bavail * 100 / stats.f_blocks), fmt::arg("used", used),
-        fmt::arg("percentage_used", percentage_used), fmt::arg("total", total),
-        fmt::arg("path", path_), fmt::arg("specific_free", specific_free),
-        fmt::arg("specific_used", specific_used), fmt::arg("specific_total", specific_total)));
+    const auto& tooltip_format =
+        compiledFormat(config_["tooltip-format"].isString()
+                           ? config_["tooltip-format"].asString()
+                           : "{used} used out of {total} on {path} ({percentage_used}%)");
+    label_.set_tooltip_text(tooltip_format.formatLookup(lookup, POSITIONAL));
   }
   // Call parent update
   ALabel::update();
@@ -9,8 +9,11 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
 #include <filesystem>
 #include <string>
+#include <string_view>
 
 namespace waybar::modules::hyprland {
 
@@ -111,6 +114,8 @@ void IPC::socketListener() {
     spdlog::error("Hyprland IPC: Couldn't open file descriptor");
     return;
   }
+  // Events received from now on are applied on top of this
+  resyncState();
   while (running_) {
     std::array<char, 1024> buffer;  // Hyprland socket2 events are max 1024 bytes
 
@@ -140,6 +145,14 @@ void IPC::socketListener() {
 
 void IPC::parseIPC(const std::string& ev) {
   std::string request = ev.substr(0, ev.find_first_of('>'));
+  // Any event may change the state, handlers and the updates they trigger query it again
+  ++generation_;
+  if (request == "configreloaded") {
+    // Rules may have moved or renamed anything, the model can't follow that with deltas
+    resyncState();
+  } else if (auto delim = ev.find(">>"); delim != std::string::npos) {
+    state_.apply(std::string_view(ev).substr(0, delim), std::string_view(ev).substr(delim + 2));
+  }
   std::unique_lock lock(callbackMutex_);
 
   for (auto& [eventname, handler] : callbacks_) {
@@ -149,6 +162,28 @@ void IPC::parseIPC(const std::string& ev) {
   }
 }
 
+void IPC::resyncState(bool force) {
+  std::lock_guard lock(resyncMutex_);
+  if (!force && stateLoaded_) {
+    return;
+  }
+  stateLoaded_ = true;
+  try {
+    auto replies = getSocket1JsonReplies({"monitors", "workspaces", "clients", "activewindow"});
+    state_.reset(*replies[0], *replies[1], *replies[2], *replies[3]);
+  } catch (const std::exception& e) {
+    spdlog::error("Hyprland IPC: couldn't load the compositor state: {}", e.what());
+  }
+}
+
+const State& IPC::state() {
+  // The listener reloads it once connected, so that no event is missed
+  if (!stateLoaded_) {
+    resyncState(false);
+  }
+  return state_;
+}
+
 void IPC::registerForIPC(const std::string& ev, EventHandler* ev_handler) {
   if (ev_handler == nullptr) {
     return;
@@ -233,14 +268,150 @@ std::string IPC::getSocket1Reply(const std::string& rq) {
   return response;
 }
 
-Json::Value IPC::getSocket1JsonReply(const std::string& rq) {
-  std::string reply = getSocket1Reply("j/" + rq);
+std::string IPC::getCoalescedReply(const std::string& rq, uint64_t generation) {
+  // A query sent before the caller's generation may miss the changes of the newer events
+  const auto key = std::make_pair(rq, generation);
+  std::promise<std::string> promise;
+  std::shared_future<std::string> reply;
+  {
+    std::unique_lock lock(inflightMutex_);
+    auto it = inflight_.find(key);
+    if (it != inflight_.end()) {
+      reply = it->second;
+      lock.unlock();
+      return reply.get();
+    }
+    reply = promise.get_future().share();
+    inflight_.emplace(key, reply);
+  }
+
+  try {
+    promise.set_value(getSocket1Reply(rq));
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+  }
+  {
+    std::unique_lock lock(inflightMutex_);
+    inflight_.erase(key);
+  }
+  return reply.get();
+}
+
+IPC::JsonReply IPC::getCachedReply(const std::string& rq, uint64_t generation) {
+  std::unique_lock lock(cacheMutex_);
+  auto it = cache_.find(rq);
+  if (it == cache_.end() || it->second.generation != generation) {
+    return nullptr;
+  }
+  return it->second.value;
+}
+
+void IPC::cacheReply(const std::string& rq, uint64_t generation, JsonReply value) {
+  // Replies of other queries, e.g. "devices", aren't invalidated by events
+  static const std::array<std::string_view, 4> STATE_QUERIES = {"activeworkspace", "clients",
+                                                                "monitors", "workspaces"};
+  if (std::ranges::find(STATE_QUERIES, rq) == STATE_QUERIES.end()) {
+    return;
+  }
+  std::unique_lock lock(cacheMutex_);
+  auto& cached = cache_[rq];
+  // A query sent before a newer event must not replace a fresher reply
+  if (cached.generation <= generation) {
+    cached = {generation, std::move(value)};
+  }
+}
+
+IPC::JsonReply IPC::getSocket1JsonReply(const std::string& rq) {
+  // The generation is taken before sending the query: if an event arrives meanwhile, the reply
+  // may predate it and is cached as already stale
+  auto generation = generation_.load();
+  if (auto cached = getCachedReply(rq, generation)) {
+    return cached;
+  }
+
+  // Queries don't change anything, the ones already in flight can be shared
+  std::string reply = getCoalescedReply("j/" + rq, generation);
 
   if (reply.empty()) {
+    return std::make_shared<const Json::Value>();
+  }
+
+  auto value = std::make_shared<const Json::Value>(parser_.parse(reply));
+  cacheReply(rq, generation, value);
+  return value;
+}
+
+std::vector<std::string> IPC::splitBatchReply(const std::string& reply, size_t count) {
+  // The replies of a batch are separated by three newlines, which pretty printed JSON never
+  // contains. Hyprland doesn't put one after the last reply.
+  static constexpr std::string_view DELIMITER = "\n\n\n";
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (parts.size() + 1 < count) {
+    auto end = reply.find(DELIMITER, start);
+    if (end == std::string::npos) {
+      return {};
+    }
+    parts.push_back(reply.substr(start, end - start));
+    start = end + DELIMITER.size();
+  }
+  auto last = std::string_view(reply).substr(start);
+  if (last.ends_with(DELIMITER)) {
+    last.remove_suffix(DELIMITER.size());
+  }
+  if (last.find(DELIMITER) != std::string_view::npos) {
     return {};
   }
+  parts.emplace_back(last);
+  return parts;
+}
+
+std::vector<IPC::JsonReply> IPC::getSocket1JsonReplies(const std::vector<std::string>& rqs) {
+  auto generation = generation_.load();
+  std::vector<JsonReply> values(rqs.size());
+  // Only the queries missing from the cache are sent
+  std::vector<size_t> missing;
+  for (size_t i = 0; i < rqs.size(); ++i) {
+    if (auto cached = getCachedReply(rqs[i], generation)) {
+      values[i] = std::move(cached);
+    } else {
+      missing.push_back(i);
+    }
+  }
+  if (missing.size() == 1) {
+    values[missing.front()] = getSocket1JsonReply(rqs[missing.front()]);
+  }
+  if (missing.size() <= 1) {
+    return values;
+  }
+
+  std::string batch = "[[BATCH]]";
+  for (auto i : missing) {
+    if (i != missing.front()) {
+      batch += ';';
+    }
+    batch += "j/" + rqs[i];
+  }
+  std::string reply = getCoalescedReply(batch, generation);
 
-  return parser_.parse(reply);
+  auto parts = splitBatchReply(reply, missing.size());
+  if (parts.empty()) {
+    spdlog::debug("Hyprland IPC: unexpected batch reply, sending the queries one by one");
+    for (auto i : missing) {
+      values[i] = getSocket1JsonReply(rqs[i]);
+    }
+    return values;
+  }
+  for (size_t j = 0; j < missing.size(); ++j) {
+    auto i = missing[j];
+    if (parts[j].empty()) {
+      values[i] = std::make_shared<const Json::Value>();
+    } else {
+      values[i] = std::make_shared<const Json::Value>(parser_.parse(parts[j]));
+      cacheReply(rqs[i], generation, values[i]);
+    }
+  }
+  return values;
 }
 
 }  // namespace waybar::modules::hyprland
@@ -0,0 +1,375 @@
+#include "modules/hyprland/state.hpp"
+
+#include <array>
+#include <charconv>
+#include <utility>
+
+namespace waybar::modules::hyprland {
+
+namespace {
+
+// Splits "a,b,c" in N fields, the last one keeps the remaining commas (e.g. in window titles)
+template <size_t N>
+std::array<std::string_view, N> splitPayload(std::string_view payload) {
+  std::array<std::string_view, N> fields;
+  for (size_t i = 0; i + 1 < N; ++i) {
+    auto comma = payload.find(',');
+    fields[i] = payload.substr(0, comma);
+    payload.remove_prefix(comma == std::string_view::npos ? payload.size() : comma + 1);
+  }
+  fields[N - 1] = payload;
+  return fields;
+}
+
+int toInt(std::string_view str) {
+  int value = 0;
+  std::from_chars(str.data(), str.data() + str.size(), value);
+  return value;
+}
+
+std::string stripAddress(std::string_view address) {
+  if (address.starts_with("0x")) {
+    address.remove_prefix(2);
+  }
+  return std::string(address);
+}
+
+}  // namespace
+
+void State::reset(const Json::Value& monitors, const Json::Value& workspaces,
+                  const Json::Value& clients, const Json::Value& activeWindow) {
+  std::lock_guard lock(mutex_);
+  windows_.clear();
+  workspaces_.clear();
+  workspaceIds_.clear();
+  monitors_.clear();
+  focusedMonitor_.clear();
+
+  for (const auto& monitor : monitors) {
+    auto name = monitor["name"].asString();
+    monitors_[name] = Monitor{
+        .id = monitor["id"].asInt(),
+        .name = name,
+        .activeWorkspace = monitor["activeWorkspace"]["id"].asInt(),
+        .specialWorkspace = monitor["specialWorkspace"]["id"].asInt(),
+    };
+    if (monitor["focused"].asBool()) {
+      focusedMonitor_ = name;
+    }
+  }
+  for (const auto& workspace : workspaces) {
+    auto id = workspace["id"].asInt();
+    // Window counts are rebuilt from the clients below
+    workspaces_[id] = Workspace{
+        .id = id,
+        .name = workspace["name"].asString(),
+        .monitor = workspace["monitor"].asString(),
+        .lastWindow = stripAddress(workspace["lastwindow"].asString()),
+        .lastWindowTitle = workspace["lastwindowtitle"].asString(),
+    };
+    workspaceIds_[workspace["name"].asString()] = id;
+  }
+  for (const auto& client : clients) {
+    if (client.isMember("mapped") && !client["mapped"].asBool()) {
+      continue;
+    }
+    addWindow(Window{
+        .address = stripAddress(client["address"].asString()),
+        .workspace = client["workspace"]["id"].asInt(),
+        .windowClass = client["class"].asString(),
+        .title = client["title"].asString(),
+        .initialClass = client["initialClass"].asString(),
+        .initialTitle = client["initialTitle"].asString(),
+        .floating = client["floating"].asBool(),
+        .fullscreen = client["fullscreen"].asBool(),
+    });
+  }
+  activeWindow_ = stripAddress(activeWindow["address"].asString());
+}
+
+bool State::apply(std::string_view event, std::string_view payload) {
+  std::lock_guard lock(mutex_);
+
+  if (event == "openwindow") {
+    auto [address, workspaceName, windowClass, title] = splitPayload<4>(payload);
+    auto* workspace = findWorkspace(workspaceName);
+    addWindow(Window{
+        .address = std::string(address),
+        .workspace = workspace != nullptr ? workspace->id : 0,
+        .windowClass = std::string(windowClass),
+        .title = std::string(title),
+        .initialClass = std::string(windowClass),
+        .initialTitle = std::string(title),
+    });
+  } else if (event == "closewindow") {
+    removeWindow(std::string(payload));
+  } else if (event == "movewindowv2") {
+    auto [address, workspaceId, _] = splitPayload<3>(payload);
+    if (auto it = windows_.find(std::string(address)); it != windows_.end()) {
+      moveWindow(it->second, toInt(workspaceId));
+    }
+  } else if (event == "windowtitlev2") {
+    auto [address, title] = splitPayload<2>(payload);
+    if (auto it = windows_.find(std::string(address)); it != windows_.end()) {
+      it->second.title = title;
+      auto* workspace = findWorkspace(it->second.workspace);
+      if (workspace != nullptr && workspace->lastWindow == it->first) {
+        workspace->lastWindowTitle = title;
+      }
+    }
+  } else if (event == "activewindowv2") {
+    activeWindow_ = stripAddress(payload);
+    if (auto it = windows_.find(activeWindow_); it != windows_.end()) {
+      if (auto* workspace = findWorkspace(it->second.workspace); workspace != nullptr) {
+        workspace->lastWindow = it->first;
+        workspace->lastWindowTitle = it->second.title;
+      }
+    }
+  } else if (event == "changefloatingmode") {
+    auto [address, floating] = splitPayload<2>(payload);
+    if (auto it = windows_.find(std::string(address)); it != windows_.end()) {
+      it->second.floating = floating == "1";
+    }
+  } else if (event == "fullscreen") {
+    // Always about the active window
+    auto it = windows_.find(activeWindow_);
+    bool fullscreen = payload == "1";
+    if (it != windows_.end() && it->second.fullscreen != fullscreen) {
+      it->second.fullscreen = fullscreen;
+      if (auto* workspace = findWorkspace(it->second.workspace); workspace != nullptr) {
+        workspace->fullscreenWindows += fullscreen ? 1 : -1;
+      }
+    }
+  } else if (event == "workspacev2" || event == "createworkspacev2") {
+    auto [idStr, name] = splitPayload<2>(payload);
+    auto id = toInt(idStr);
+    if (findWorkspace(id) == nullptr) {
+      // Created on the focused monitor, moveworkspacev2 follows otherwise
+      workspaces_[id] = Workspace{.id = id, .name = std::string(name), .monitor = focusedMonitor_};
+      workspaceIds_[std::string(name)] = id;
+    }
+    if (event == "workspacev2") {
+      if (auto monitor = monitors_.find(focusedMonitor_); monitor != monitors_.end()) {
+        monitor->second.activeWorkspace = id;
+      }
+    }
+  } else if (event == "destroyworkspacev2") {
+    auto [id, _] = splitPayload<2>(payload);
+    removeWorkspace(toInt(id));
+  } else if (event == "moveworkspacev2") {
+    auto [id, _, monitor] = splitPayload<3>(payload);
+    if (auto* workspace = findWorkspace(toInt(id)); workspace != nullptr) {
+      workspace->monitor = monitor;
+    }
+  } else if (event == "renameworkspace") {
+    auto [id, name] = splitPayload<2>(payload);
+    if (auto* workspace = findWorkspace(toInt(id)); workspace != nullptr) {
+      workspaceIds_.erase(workspace->name);
+      workspace->name = name;
+      workspaceIds_[workspace->name] = workspace->id;
+    }
+  } else if (event == "focusedmonv2") {
+    auto [name, workspace] = splitPayload<2>(payload);
+    focusedMonitor_ = name;
+    if (auto monitor = monitors_.find(focusedMonitor_); monitor != monitors_.end()) {
+      monitor->second.activeWorkspace = toInt(workspace);
+    }
+  } else if (event == "activespecial") {
+    // An empty name when the special workspace is closed
+    auto [name, monitorName] = splitPayload<2>(payload);
+    if (auto monitor = monitors_.find(std::string(monitorName)); monitor != monitors_.end()) {
+      auto* workspace = findWorkspace(name);
+      monitor->second.specialWorkspace = workspace != nullptr ? workspace->id : 0;
+    }
+  } else if (event == "monitoraddedv2") {
+    auto [id, name, _] = splitPayload<3>(payload);
+    monitors_[std::string(name)] = Monitor{.id = toInt(id), .name = std::string(name)};
+  } else if (event == "monitorremoved") {
+    monitors_.erase(std::string(payload));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::optional<Json::Value> State::client(std::string_view address) const {
+  std::lock_guard lock(mutex_);
+  auto it = windows_.find(stripAddress(address));
+  if (it == windows_.end()) {
+    return std::nullopt;
+  }
+  return toJson(it->second);
+}
+
+Json::Value State::clients() const {
+  std::lock_guard lock(mutex_);
+  Json::Value clients(Json::arrayValue);
+  for (const auto& [_, window] : windows_) {
+    clients.append(toJson(window));
+  }
+  return clients;
+}
+
+Json::Value State::clients(int workspace) const {
+  std::lock_guard lock(mutex_);
+  Json::Value clients(Json::arrayValue);
+  for (const auto& [_, window] : windows_) {
+    if (window.workspace == workspace) {
+      clients.append(toJson(window));
+    }
+  }
+  return clients;
+}
+
+Json::Value State::workspaces() const {
+  std::lock_guard lock(mutex_);
+  Json::Value workspaces(Json::arrayValue);
+  for (const auto& [_, workspace] : workspaces_) {
+    workspaces.append(toJson(workspace));
+  }
+  return workspaces;
+}
+
+std::optional<Json::Value> State::workspace(std::string_view name) const {
+  std::lock_guard lock(mutex_);
+  auto id = workspaceIds_.find(std::string(name));
+  if (id == workspaceIds_.end()) {
+    return std::nullopt;
+  }
+  auto it = workspaces_.find(id->second);
+  if (it == workspaces_.end()) {
+    return std::nullopt;
+  }
+  return toJson(it->second);
+}
+
+Json::Value State::monitors() const {
+  std::lock_guard lock(mutex_);
+  Json::Value monitors(Json::arrayValue);
+  for (const auto& [_, monitor] : monitors_) {
+    monitors.append(toJson(monitor));
+  }
+  return monitors;
+}
+
+std::optional<Json::Value> State::monitor(const std::string& name) const {
+  std::lock_guard lock(mutex_);
+  auto it = monitors_.find(name);
+  if (it == monitors_.end()) {
+    return std::nullopt;
+  }
+  return toJson(it->second);
+}
+
+Json::Value State::activeWorkspace(const std::string& monitor) const {
+  std::lock_guard lock(mutex_);
+  auto it = monitors_.find(monitor.empty() ? focusedMonitor_ : monitor);
+  if (it == monitors_.end()) {
+    return {};
+  }
+  auto workspace = workspaces_.find(it->second.activeWorkspace);
+  if (workspace == workspaces_.end()) {
+    return {};
+  }
+  return toJson(workspace->second);
+}
+
+State::Workspace* State::findWorkspace(int id) {
+  auto it = workspaces_.find(id);
+  return it != workspaces_.end() ? &it->second : nullptr;
+}
+
+State::Workspace* State::findWorkspace(std::string_view name) {
+  auto it = workspaceIds_.find(std::string(name));
+  return it != workspaceIds_.end() ? findWorkspace(it->second) : nullptr;
+}
+
+void State::addWindow(Window window) {
+  // The window may already be known if the event predates the last reset
+  removeWindow(window.address);
+  if (auto* workspace = findWorkspace(window.workspace); workspace != nullptr) {
+    ++workspace->windows;
+    workspace->fullscreenWindows += window.fullscreen ? 1 : 0;
+  }
+  auto address = window.address;
+  windows_.insert_or_assign(std::move(address), std::move(window));
+}
+
+void State::removeWindow(const std::string& address) {
+  auto it = windows_.find(address);
+  if (it == windows_.end()) {
+    return;
+  }
+  if (auto* workspace = findWorkspace(it->second.workspace); workspace != nullptr) {
+    --workspace->windows;
+    workspace->fullscreenWindows -= it->second.fullscreen ? 1 : 0;
+  }
+  windows_.erase(it);
+}
+
+void State::moveWindow(Window& window, int workspace) {
+  if (auto* from = findWorkspace(window.workspace); from != nullptr) {
+    --from->windows;
+    from->fullscreenWindows -= window.fullscreen ? 1 : 0;
+  }
+  window.workspace = workspace;
+  if (auto* to = findWorkspace(workspace); to != nullptr) {
+    ++to->windows;
+    to->fullscreenWindows += window.fullscreen ? 1 : 0;
+  }
+}
+
+void State::removeWorkspace(int id) {
+  auto it = workspaces_.find(id);
+  if (it == workspaces_.end()) {
+    return;
+  }
+  workspaceIds_.erase(it->second.name);
+  workspaces_.erase(it);
+}
+
+Json::Value State::toJson(const Window& window) const {
+  Json::Value client;
+  client["address"] = "0x" + window.address;
+  client["workspace"]["id"] = window.workspace;
+  auto workspace = workspaces_.find(window.workspace);
+  client["workspace"]["name"] = workspace != workspaces_.end() ? workspace->second.name : "";
+  client["class"] = window.windowClass;
+  client["title"] = window.title;
+  client["initialClass"] = window.initialClass;
+  client["initialTitle"] = window.initialTitle;
+  client["floating"] = window.floating;
+  client["fullscreen"] = window.fullscreen;
+  return client;
+}
+
+Json::Value State::toJson(const Workspace& workspace) const {
+  Json::Value value;
+  value["id"] = workspace.id;
+  value["name"] = workspace.name;
+  value["monitor"] = workspace.monitor;
+  value["windows"] = workspace.windows;
+  value["hasfullscreen"] = workspace.fullscreenWindows > 0;
+  value["lastwindow"] = workspace.lastWindow.empty() ? "0x0" : "0x" + workspace.lastWindow;
+  value["lastwindowtitle"] = workspace.lastWindowTitle;
+  return value;
+}
+
+Json::Value State::toJson(const Monitor& monitor) const {
+  Json::Value value;
+  value["id"] = monitor.id;
+  value["name"] = monitor.name;
+  value["focused"] = monitor.name == focusedMonitor_;
+  auto workspaceJson = [this](int id) {
+    Json::Value workspace;
+    workspace["id"] = id;
+    auto it = workspaces_.find(id);
+    workspace["name"] = it != workspaces_.end() ? it->second.name : "";
+    return workspace;
+  };
+  value["activeWorkspace"] = workspaceJson(monitor.activeWorkspace);
+  value["specialWorkspace"] = workspaceJson(monitor.specialWorkspace);
+  return value;
+}
+
+}  // namespace waybar::modules::hyprland
@@ -18,7 +18,10 @@ namespace waybar::modules::hyprland {
 std::shared_mutex windowIpcSmtx;
 
 Window::Window(const std::string& id, const Bar& bar, const Json::Value& config)
-    : AAppIconLabel(config, "window", id, "{title}", 0, true), bar_(bar), m_ipc(IPC::inst()) {
+    : AAppIconLabel(config, "window", id, "{title}", 0, true),
+      bar_(bar),
+      rewriteRules_(config["rewrite"]),
+      m_ipc(IPC::inst()) {
   std::unique_lock<std::shared_mutex> windowIpcUniqueLock(windowIpcSmtx);
 
   separateOutputs_ = config["separate-outputs"].asBool();
@@ -53,12 +56,11 @@ auto Window::update() -> void {
   std::string label_text;
   if (!format_.empty()) {
     label_.show();
-    label_text = waybar::util::rewriteString(
+    label_text = rewriteRules_.apply(
         fmt::format(fmt::runtime(format_), fmt::arg("title", windowName),
                     fmt::arg("initialTitle", windowData_.initial_title),
                     fmt::arg("class", windowData_.class_name),
-                    fmt::arg("initialClass", windowData_.initial_class_name)),
-        config_["rewrite"]);
+                    fmt::arg("initialClass", windowData_.initial_class_name)));
     label_.set_markup(label_text);
   } else {
     label_.hide();
@@ -111,15 +113,16 @@ auto Window::update() -> void {
 auto Window::getActiveWorkspace() -> Workspace {
   const auto workspace = IPC::inst().getSocket1JsonReply("activeworkspace");
 
-  if (workspace.isObject()) {
-    return Workspace::parse(workspace);
+  if (workspace->isObject()) {
+    return Workspace::parse(*workspace);
   }
 
   return {};
 }
 
 auto Window::getActiveWorkspace(const std::string& monitorName) -> Workspace {
-  const auto monitors = IPC::inst().getSocket1JsonReply("monitors");
+  const auto replies = IPC::inst().getSocket1JsonReplies({"monitors", "workspaces"});
+  const auto& monitors = *replies[0];
   if (monitors.isArray()) {
     auto monitor = std::ranges::find_if(
         monitors, [&](Json::Value monitor) { return monitor["name"] == monitorName; });
@@ -134,7 +137,7 @@ auto Window::getActiveWorkspace(const std::string& monitorName) -> Workspace {
     }
     const int id = (*monitor)["activeWorkspace"]["id"].asInt();
 
-    const auto workspaces = IPC::inst().getSocket1JsonReply("workspaces");
+    const auto& workspaces = *replies[1];
     if (workspaces.isArray()) {
       auto workspace = std::ranges::find_if(
           workspaces, [&](Json::Value workspace) { return workspace["id"] == id; });
@@ -185,7 +188,8 @@ void Window::queryActiveWorkspace() {
 
   focused_ = true;
   if (workspace_.windows > 0) {
-    const auto clients = m_ipc.getSocket1JsonReply("clients");
+    const auto reply = m_ipc.getSocket1JsonReply("clients");
+    const auto& clients = *reply;
     if (clients.isArray()) {
       auto activeWindow = std::ranges::find_if(
           clients, [&](Json::Value window) { return window["address"] == workspace_.last_window; });
@@ -66,15 +66,20 @@ auto WindowCount::update() -> void {
 auto WindowCount::getActiveWorkspace() -> Workspace {
   const auto workspace = m_ipc.getSocket1JsonReply("activeworkspace");
 
-  if (workspace.isObject()) {
-    return Workspace::parse(workspace);
+  if (workspace->isObject()) {
+    return Workspace::parse(*workspace);
   }
 
   return {};
 }
 
 auto WindowCount::getActiveWorkspace(const std::string& monitorName) -> Workspace {
-  const auto monitors = m_ipc.getSocket1JsonReply("monitors");
+  if (const auto workspace = m_ipc.state().activeWorkspace(monitorName); workspace.isObject()) {
+    return Workspace::parse(workspace);
+  }
+  // Not known to the state model yet
+  const auto replies = m_ipc.getSocket1JsonReplies({"monitors", "workspaces"});
+  const auto& monitors = *replies[0];
   if (monitors.isArray()) {
     auto monitor = std::ranges::find_if(
         monitors, [&](Json::Value monitor) { return monitor["name"] == monitorName; });
@@ -88,7 +93,7 @@ auto WindowCount::getActiveWorkspace(const std::string& monitorName) -> Workspac
     }
     const int id = (*monitor)["activeWorkspace"]["id"].asInt();
 
-    const auto workspaces = m_ipc.getSocket1JsonReply("workspaces");
+    const auto& workspaces = *replies[1];
     if (workspaces.isArray()) {
       auto workspace = std::ranges::find_if(
           workspaces, [&](Json::Value workspace) { return workspace["id"] == id; });
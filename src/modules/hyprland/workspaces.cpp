@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -40,7 +41,7 @@ Workspaces::~Workspaces() {
 }
 
 void Workspaces::init() {
-  m_activeWorkspaceId = m_ipc.getSocket1JsonReply("activeworkspace")["id"].asInt();
+  m_activeWorkspaceId = (*m_ipc.getSocket1JsonReply("activeworkspace"))["id"].asInt();
 
   initializeWorkspaces();
   dp.emit();
@@ -155,9 +156,8 @@ std::string Workspaces::getRewrite(std::string window_class, std::string window_
   return "";
 }
 
-std::vector<int> Workspaces::getVisibleWorkspaces() {
+std::vector<int> Workspaces::getVisibleWorkspaces(const Json::Value &monitors) {
   std::vector<int> visibleWorkspaces;
-  auto monitors = IPC::inst().getSocket1JsonReply("monitors");
   for (const auto &monitor : monitors) {
     auto ws = monitor["activeWorkspace"];
     if (ws.isObject() && ws["id"].isInt()) {
@@ -181,8 +181,9 @@ void Workspaces::initializeWorkspaces() {
   }
 
   // get all current workspaces
-  auto const workspacesJson = m_ipc.getSocket1JsonReply("workspaces");
-  auto const clientsJson = m_ipc.getSocket1JsonReply("clients");
+  auto const replies = m_ipc.getSocket1JsonReplies({"workspaces", "clients"});
+  auto const &workspacesJson = *replies[0];
+  auto const &clientsJson = *replies[1];
 
   for (Json::Value workspaceJson : workspacesJson) {
     std::string workspaceName = workspaceJson["name"].asString();
@@ -280,7 +281,7 @@ void Workspaces::loadPersistentWorkspacesFromWorkspaceRules(const Json::Value &c
   spdlog::info("Loading persistent workspaces from Hyprland workspace rules");
 
   auto const workspaceRules = m_ipc.getSocket1JsonReply("workspacerules");
-  for (Json::Value const &rule : workspaceRules) {
+  for (Json::Value const &rule : *workspaceRules) {
     if (!rule["workspaceString"].isString()) {
       spdlog::warn("Workspace rules: invalid workspaceString, skipping: {}", rule);
       continue;
@@ -380,8 +381,9 @@ void Workspaces::onWorkspaceCreated(std::string const &payload, Json::Value cons
     return;
   }
 
-  auto const workspaceRules = m_ipc.getSocket1JsonReply("workspacerules");
-  auto const workspacesJson = m_ipc.getSocket1JsonReply("workspaces");
+  auto const replies = m_ipc.getSocket1JsonReplies({"workspacerules", "workspaces"});
+  auto const &workspaceRules = *replies[0];
+  auto const &workspacesJson = *replies[1];
 
   for (Json::Value workspaceJson : workspacesJson) {
     const auto currentId = workspaceJson["id"].asInt();
@@ -420,7 +422,7 @@ void Workspaces::onWorkspaceMoved(std::string const &payload) {
   spdlog::debug("Workspace moved: {}", payload);
 
   // Update active workspace
-  m_activeWorkspaceId = (m_ipc.getSocket1JsonReply("activeworkspace"))["id"].asInt();
+  m_activeWorkspaceId = m_ipc.state().activeWorkspace()["id"].asInt();
 
   if (allOutputs()) return;
 
@@ -429,8 +431,10 @@ void Workspaces::onWorkspaceMoved(std::string const &payload) {
   const auto subPayload = makePayload(workspaceIdStr, workspaceName);
 
   if (m_bar.output->name == monitorName) {
-    Json::Value clientsData = m_ipc.getSocket1JsonReply("clients");
-    onWorkspaceCreated(subPayload, clientsData);
+    // Only the clients of the moved workspace are looked at
+    if (auto workspaceId = parseWorkspaceId(workspaceIdStr); workspaceId.has_value()) {
+      onWorkspaceCreated(subPayload, m_ipc.state().clients(*workspaceId));
+    }
   } else {
     spdlog::debug("Removing workspace because it was moved to another monitor: {}", subPayload);
     onWorkspaceDestroyed(subPayload);
@@ -467,11 +471,9 @@ void Workspaces::onMonitorFocused(std::string const &payload) {
 
   m_activeWorkspaceId = *workspaceId;
 
-  for (Json::Value &monitor : m_ipc.getSocket1JsonReply("monitors")) {
-    if (monitor["name"].asString() == monitorName) {
-      const auto name = monitor["specialWorkspace"]["name"].asString();
-      m_activeSpecialWorkspaceName = !name.starts_with("special:") ? name : name.substr(8);
-    }
+  if (auto monitor = m_ipc.state().monitor(monitorName); monitor.has_value()) {
+    const auto name = (*monitor)["specialWorkspace"]["name"].asString();
+    m_activeSpecialWorkspaceName = !name.starts_with("special:") ? name : name.substr(8);
   }
 }
 
@@ -577,14 +579,7 @@ void Workspaces::onWindowTitleEvent(std::string const &payload) {
   }
 
   if (inserter.has_value()) {
-    Json::Value clientsData = m_ipc.getSocket1JsonReply("clients");
-    std::string jsonWindowAddress = fmt::format("0x{}", windowAddress);
-
-    auto client = std::ranges::find_if(clientsData, [jsonWindowAddress](auto &client) {
-      return client["address"].asString() == jsonWindowAddress;
-    });
-
-    if (client != clientsData.end() && !client->empty()) {
+    if (auto client = m_ipc.state().client(windowAddress); client.has_value()) {
       (*inserter)({*client});
     }
   }
@@ -904,11 +899,11 @@ void Workspaces::removeWorkspace(std::string const &workspaceString) {
 void Workspaces::setCurrentMonitorId() {
   // get monitor ID from name (used by persistent workspaces)
   m_monitorId = 0;
-  auto monitors = m_ipc.getSocket1JsonReply("monitors");
-  auto currentMonitor = std::ranges::find_if(monitors, [this](const Json::Value &m) {
+  auto const monitors = m_ipc.getSocket1JsonReply("monitors");
+  auto currentMonitor = std::ranges::find_if(*monitors, [this](const Json::Value &m) {
     return m["name"].asString() == m_bar.output->name;
   });
-  if (currentMonitor == monitors.end()) {
+  if (currentMonitor == monitors->end()) {
     spdlog::error("Monitor '{}' does not have an ID? Using 0", m_bar.output->name);
   } else {
     m_monitorId = (*currentMonitor)["id"].asInt();
@@ -1126,14 +1121,9 @@ void Workspaces::sortWorkspaces() {
 }
 
 void Workspaces::setUrgentWorkspace(std::string const &windowaddress) {
-  const Json::Value clientsJson = m_ipc.getSocket1JsonReply("clients");
   int workspaceId = -1;
-
-  for (Json::Value clientJson : clientsJson) {
-    if (clientJson["address"].asString().ends_with(windowaddress)) {
-      workspaceId = clientJson["workspace"]["id"].asInt();
-      break;
-    }
+  if (auto client = m_ipc.state().client(windowaddress); client.has_value()) {
+    workspaceId = (*client)["workspace"]["id"].asInt();
   }
 
   auto workspace = std::ranges::find_if(m_workspaces, [workspaceId](std::unique_ptr<Workspace> &x) {
@@ -1149,15 +1139,22 @@ auto Workspaces::update() -> void {
   AModule::update();
 }
 
+// The compositor's view of `workspace`, whose special workspace names lost their prefix
+static std::optional<Json::Value> findWorkspaceState(const State &state,
+                                                     const Workspace &workspace) {
+  auto workspaceJson = state.workspace(workspace.name());
+  if (!workspaceJson.has_value() && workspace.isSpecial()) {
+    workspaceJson = state.workspace("special:" + workspace.name());
+  }
+  return workspaceJson;
+}
+
 void Workspaces::updateWindowCount() {
-  const Json::Value workspacesJson = m_ipc.getSocket1JsonReply("workspaces");
+  const State &state = m_ipc.state();
   for (auto const &workspace : m_workspaces) {
-    auto workspaceJson = std::ranges::find_if(workspacesJson, [&](Json::Value const &x) {
-      return x["name"].asString() == workspace->name() ||
-             (workspace->isSpecial() && x["name"].asString() == "special:" + workspace->name());
-    });
+    auto workspaceJson = findWorkspaceState(state, *workspace);
     uint32_t count = 0;
-    if (workspaceJson != workspacesJson.end()) {
+    if (workspaceJson.has_value()) {
       try {
         count = (*workspaceJson)["windows"].asUInt();
       } catch (const std::exception &e) {
@@ -1195,10 +1192,10 @@ bool Workspaces::updateWindowsToCreate() {
 }
 
 void Workspaces::updateWorkspaceStates() {
-  const std::vector<int> visibleWorkspaces = getVisibleWorkspaces();
-  auto updatedWorkspaces = m_ipc.getSocket1JsonReply("workspaces");
+  const State &state = m_ipc.state();
+  const std::vector<int> visibleWorkspaces = getVisibleWorkspaces(state.monitors());
 
-  auto currentWorkspace = m_ipc.getSocket1JsonReply("activeworkspace");
+  auto const currentWorkspace = state.activeWorkspace();
   std::string currentWorkspaceName =
       currentWorkspace.isMember("name") ? currentWorkspace["name"].asString() : "";
 
@@ -1218,12 +1215,8 @@ void Workspaces::updateWorkspaceStates() {
     if (m_withIcon) {
       workspaceIcon = workspace->selectIcon(m_iconsMap);
     }
-    auto updatedWorkspace = std::ranges::find_if(updatedWorkspaces, [&workspace](const auto &w) {
-      auto wNameRaw = w["name"].asString();
-      auto wName = wNameRaw.starts_with("special:") ? wNameRaw.substr(8) : wNameRaw;
-      return wName == workspace->name();
-    });
-    if (updatedWorkspace != updatedWorkspaces.end()) {
+    if (auto updatedWorkspace = findWorkspaceState(state, *workspace);
+        updatedWorkspace.has_value()) {
       workspace->setOutput((*updatedWorkspace)["monitor"].asString());
     }
     workspace->update(workspaceIcon);
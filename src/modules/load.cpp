@@ -1,5 +1,7 @@
 #include "modules/load.hpp"
 
+#include "util/shared_sample.hpp"
+
 // In the 80000 version of fmt library authors decided to optimize imports
 // and moved declarations required for fmt::dynamic_format_arg_store in new
 // header fmt/args.h
@@ -11,15 +13,12 @@
 
 waybar::modules::Load::Load(const std::string& id, const Json::Value& config)
     : ALabel(config, "load", id, "{load1}", 10) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+  timer_ = util::ScheduledTask(interval_, [this] { emitUpdate(); }, interval_align_);
 }
 
 auto waybar::modules::Load::update() -> void {
   // TODO: as creating dynamic fmt::arg arrays is buggy we have to calc both
-  auto [load1, load5, load15] = Load::getLoad();
+  auto [load1, load5, load15] = Load::getLoad(interval_ / 2);
   if (tooltipEnabled()) {
     auto tooltip = fmt::format("Load 1: {}\nLoad 5: {}\nLoad 15: {}", load1, load5, load15);
     label_.set_tooltip_text(tooltip);
@@ -49,7 +48,13 @@ auto waybar::modules::Load::update() -> void {
   ALabel::update();
 }
 
-std::tuple<double, double, double> waybar::modules::Load::getLoad() {
+std::tuple<double, double, double> waybar::modules::Load::getLoad(
+    std::chrono::milliseconds max_age) {
+  static util::SharedSample<std::tuple<double, double, double>> load{&Load::readLoad};
+  return *load.get(max_age);
+}
+
+std::tuple<double, double, double> waybar::modules::Load::readLoad() {
   double load[3];
   if (getloadavg(load, 3) != -1) {
     double load1 = std::ceil(load[0] * 100.0) / 100.0;
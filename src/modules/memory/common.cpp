@@ -1,33 +1,28 @@
 #include "modules/memory.hpp"
 
+#include "util/shared_sample.hpp"
+
 waybar::modules::Memory::Memory(const std::string& id, const Json::Value& config)
     : ALabel(config, "memory", id, "{}%", 30) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+  timer_ = util::ScheduledTask(interval_, [this] { emitUpdate(); }, interval_align_);
 }
 
 auto waybar::modules::Memory::update() -> void {
-  parseMeminfo();
+  // Read once for the memory modules of every bar
+  static util::SharedSample<Meminfo> sample{&Memory::parseMeminfo};
+  auto meminfo = sample.get(interval_ / 2);
 
-  unsigned long memtotal = meminfo_["MemTotal"];
-  unsigned long swaptotal = 0;
-  if (meminfo_.count("SwapTotal")) {
-    swaptotal = meminfo_["SwapTotal"];
-  }
+  unsigned long memtotal = meminfo->mem_total;
+  unsigned long swaptotal = meminfo->swap_total;
   unsigned long memfree;
-  unsigned long swapfree = 0;
-  if (meminfo_.count("SwapFree")) {
-    swapfree = meminfo_["SwapFree"];
-  }
-  if (meminfo_.count("MemAvailable")) {
+  unsigned long swapfree = meminfo->swap_free;
+  if (meminfo->has_mem_available) {
     // New kernels (3.4+) have an accurate available memory field.
-    memfree = meminfo_["MemAvailable"] + meminfo_["zfs_size"];
+    memfree = meminfo->mem_available + meminfo->zfs_size;
   } else {
     // Old kernel; give a best-effort approximation of available memory.
-    memfree = meminfo_["MemFree"] + meminfo_["Buffers"] + meminfo_["Cached"] +
-              meminfo_["SReclaimable"] - meminfo_["Shmem"] + meminfo_["zfs_size"];
+    memfree = meminfo->mem_free + meminfo->buffers + meminfo->cached + meminfo->sreclaimable -
+              meminfo->shmem + meminfo->zfs_size;
   }
 
   if (memtotal > 0 && memfree >= 0) {
@@ -44,20 +39,17 @@ auto waybar::modules::Memory::update() -> void {
     float available_ram_gigabytes = 0.01 * round(memfree / 10485.76);
     float available_swap_gigabytes = 0.01 * round(swapfree / 10485.76);
 
-    auto format = format_;
     auto state = getState(used_ram_percentage);
-    if (!state.empty() && config_["format-" + state].isString()) {
-      format = config_["format-" + state].asString();
-    }
+    const auto& format = stateFormat(state);
 
     if (format.empty()) {
       event_box_.hide();
     } else {
       event_box_.show();
       auto icons = std::vector<std::string>{state};
-      label_.set_markup(fmt::format(
-          fmt::runtime(format), used_ram_percentage,
-          fmt::arg("icon", getIcon(used_ram_percentage, icons)),
+      label_.set_markup(format.format(
+          used_ram_percentage,
+          fmt::arg("icon", format.uses("icon") ? getIcon(used_ram_percentage, icons) : ""),
           fmt::arg("total", total_ram_gigabytes), fmt::arg("swapTotal", total_swap_gigabytes),
           fmt::arg("percentage", used_ram_percentage),
           fmt::arg("swapState", swaptotal == 0 ? "Off" : "On"),
@@ -68,10 +60,10 @@ auto waybar::modules::Memory::update() -> void {
 
     if (tooltipEnabled()) {
       if (config_["tooltip-format"].isString()) {
-        auto tooltip_format = config_["tooltip-format"].asString();
-        label_.set_tooltip_text(fmt::format(
-            fmt::runtime(tooltip_format), used_ram_percentage,
-            fmt::arg("total", total_ram_gigabytes), fmt::arg("swapTotal", total_swap_gigabytes),
+        const auto& tooltip_format = compiledFormat(config_["tooltip-format"].asString());
+        label_.set_tooltip_text(tooltip_format.format(
+            used_ram_percentage, fmt::arg("total", total_ram_gigabytes),
+            fmt::arg("swapTotal", total_swap_gigabytes),
             fmt::arg("percentage", used_ram_percentage),
             fmt::arg("swapState", swaptotal == 0 ? "Off" : "On"),
             fmt::arg("swapPercentage", used_swap_percentage), fmt::arg("used", used_ram_gigabytes),
@@ -1,18 +1,20 @@
 #include "modules/memory.hpp"
-
-static unsigned zfsArcSize() {
-  std::ifstream zfs_arc_stats{"/proc/spl/kstat/zfs/arcstats"};
-
-  if (zfs_arc_stats.is_open()) {
-    std::string name;
-    std::string type;
-    unsigned long data{0};
-
-    std::string line;
-    while (std::getline(zfs_arc_stats, line)) {
-      std::stringstream(line) >> name >> type >> data;
-
-      if (name == "size") {
+#include "util/procfs.hpp"
+
+// Only called through the shared sample, which serializes the reads
+static unsigned long zfsArcSize() {
+  static waybar::util::procfs::File zfs_arc_stats{"/proc/spl/kstat/zfs/arcstats"};
+
+  if (auto content = zfs_arc_stats.read()) {
+    std::string_view line;
+    while (waybar::util::procfs::nextLine(*content, line)) {
+      // name type data
+      if (waybar::util::procfs::nextWord(line) != "size") {
+        continue;
+      }
+      waybar::util::procfs::nextWord(line);
+      uint64_t data;
+      if (waybar::util::procfs::nextNumber(line, data)) {
         return data / 1024;  // convert to kB
       }
     }
@@ -21,23 +23,36 @@ static unsigned zfsArcSize() {
   return 0;
 }
 
-void waybar::modules::Memory::parseMeminfo() {
-  const std::string data_dir_ = "/proc/meminfo";
-  std::ifstream info(data_dir_);
-  if (!info.is_open()) {
-    throw std::runtime_error("Can't open " + data_dir_);
+waybar::modules::Memory::Meminfo waybar::modules::Memory::parseMeminfo() {
+  static util::procfs::File info{"/proc/meminfo"};
+  auto content = info.read();
+  if (!content) {
+    throw std::runtime_error("Can't open " + info.path());
   }
-  std::string line;
-  while (getline(info, line)) {
-    auto posDelim = line.find(':');
-    if (posDelim == std::string::npos) {
-      continue;
+  Meminfo meminfo;
+  util::procfs::forEachKeyValue(*content, [&meminfo](std::string_view key, uint64_t value) {
+    if (key == "MemTotal") {
+      meminfo.mem_total = value;
+    } else if (key == "MemFree") {
+      meminfo.mem_free = value;
+    } else if (key == "MemAvailable") {
+      meminfo.mem_available = value;
+      meminfo.has_mem_available = true;
+    } else if (key == "Buffers") {
+      meminfo.buffers = value;
+    } else if (key == "Cached") {
+      meminfo.cached = value;
+    } else if (key == "SReclaimable") {
+      meminfo.sreclaimable = value;
+    } else if (key == "Shmem") {
+      meminfo.shmem = value;
+    } else if (key == "SwapTotal") {
+      meminfo.swap_total = value;
+    } else if (key == "SwapFree") {
+      meminfo.swap_free = value;
     }
+  });
 
-    std::string name = line.substr(0, posDelim);
-    int64_t value = std::stol(line.substr(posDelim + 1));
-    meminfo_[name] = value;
-  }
-
-  meminfo_["zfs_size"] = zfsArcSize();
+  meminfo.zfs_size = zfsArcSize();
+  return meminfo;
 }
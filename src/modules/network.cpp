@@ -6,15 +6,19 @@
 #include <spdlog/spdlog.h>
 #include <sys/eventfd.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <cstring>
 #include <fstream>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "util/format.hpp"
+#include "util/procfs.hpp"
 #ifdef WANT_RFKILL
 #include "util/rfkill.hpp"
 #endif
@@ -22,64 +26,104 @@
 namespace {
 using namespace waybar::util;
 constexpr const char *DEFAULT_FORMAT = "{ifname}";
+
+// String attribute without its NUL terminator, not copied
+std::string_view nlaStringView(struct nlattr *attr) {
+  auto str = static_cast<const char *>(nla_data(attr));
+  return {str, strnlen(str, nla_len(attr))};
+}
+
+// Formats `addr` into `text` and returns whether that changed it. Doesn't allocate when the
+// address is the one already shown.
+bool setAddress(std::string &text, int family, const void *addr) {
+  char buffer[INET6_ADDRSTRLEN];
+  const char *formatted = inet_ntop(family, addr, buffer, sizeof(buffer));
+  if (formatted == nullptr || text == formatted) {
+    return false;
+  }
+  text = formatted;
+  return true;
+}
 }  // namespace
 
-constexpr const char *NETDEV_FILE =
-    "/proc/net/dev";  // std::ifstream does not take std::string_view as param
+// Received and transmitted bytes of the current interface. Must be called with mutex_ held.
 std::optional<std::pair<unsigned long long, unsigned long long>>
 waybar::modules::Network::readBandwidthUsage() {
-  std::ifstream netdev(NETDEV_FILE);
-  if (!netdev) {
-    spdlog::warn("Failed to open netdev file {}", NETDEV_FILE);
+  if (ifid_ <= 0) {
     return {};
   }
-
-  std::string line;
-  // skip the headers (first two lines)
-  std::getline(netdev, line);
-  std::getline(netdev, line);
-
-  unsigned long long receivedBytes = 0ull;
-  unsigned long long transmittedBytes = 0ull;
-  while (std::getline(netdev, line)) {
-    std::istringstream iss(line);
-
-    std::string ifacename;
-    iss >> ifacename;      // ifacename contains "eth0:"
-    ifacename.pop_back();  // remove trailing ':'
-    if (ifacename != ifname_) {
-      continue;
-    }
-
-    // The rest of the line consists of whitespace separated counts divided
-    // into two groups (receive and transmit). Each group has the following
-    // columns: bytes, packets, errs, drop, fifo, frame, compressed, multicast
-    //
-    // We only care about the bytes count, so we'll just ignore the 7 other
-    // columns.
-    unsigned long long r = 0ull;
-    unsigned long long t = 0ull;
-    // Read received bytes
-    iss >> r;
-    // Skip all the other columns in the received group
-    for (int colsToSkip = 7; colsToSkip > 0; colsToSkip--) {
-      // skip whitespace between columns
-      while (iss.peek() == ' ') {
-        iss.ignore();
-      }
-      // skip the irrelevant column
-      while (iss.peek() != ' ') {
-        iss.ignore();
-      }
+  if (stats_sock_ == nullptr) {
+    auto content = netdev_.read();
+    if (!content) {
+      spdlog::warn("Failed to open netdev file {}", netdev_.path());
+      return {};
     }
-    // Read transmit bytes
-    iss >> t;
+    // An interface missing from the file counts as no traffic
+    return procfs::netDevBytes(*content, ifname_).value_or(std::make_pair(0ull, 0ull));
+  }
 
-    receivedBytes += r;
-    transmittedBytes += t;
+  // The link of this interface only, rather than the text of every interface
+  struct nl_msg *msg = nlmsg_alloc_simple(RTM_GETLINK, NLM_F_REQUEST);
+  if (msg == nullptr) {
+    return {};
   }
+  struct ifinfomsg ifi;
+  memset(&ifi, 0, sizeof(ifi));
+  ifi.ifi_family = AF_UNSPEC;
+  ifi.ifi_index = ifid_;
+  stats_reply_.reset();
+  int rc = nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO);
+  if (rc >= 0) {
+    rc = nl_send_auto(stats_sock_, msg);
+  }
+  nlmsg_free(msg);
+  if (rc >= 0) {
+    // The reply isn't multipart, this returns once it is handled
+    rc = nl_recvmsgs_default(stats_sock_);
+  }
+  if (rc < 0) {
+    // The interface may just have been removed
+    spdlog::debug("network: can't get statistics of if{}: {}", ifid_, nl_geterror(rc));
+    return {};
+  }
+  return stats_reply_;
+}
 
-  return {{receivedBytes, transmittedBytes}};
+// Must be called with mutex_ held
+void waybar::modules::Network::sampleBandwidth() {
+  auto now = std::chrono::steady_clock::now();
+  auto bandwidth = readBandwidthUsage();
+  if (!bandwidth || ifid_ != bandwidth_ifid_) {
+    // Rates start over from the counters of the new interface
+    bandwidth_ifid_ = bandwidth ? ifid_ : -1;
+    if (bandwidth) {
+      bandwidth_down_total_ = bandwidth->first;
+      bandwidth_up_total_ = bandwidth->second;
+    }
+    bandwidth_time_ = now;
+    bandwidth_down_rate_ = bandwidth_up_rate_ = 0;
+    bandwidth_rate_valid_ = false;
+    return;
+  }
+  double elapsed = std::chrono::duration<double>(now - bandwidth_time_).count();
+  if (elapsed <= 0) {
+    return;
+  }
+  // Counters going back (e.g. the driver was reloaded) count as no traffic
+  auto down = bandwidth->first >= bandwidth_down_total_
+                  ? (bandwidth->first - bandwidth_down_total_) / elapsed
+                  : 0.0;
+  auto up = bandwidth->second >= bandwidth_up_total_
+                ? (bandwidth->second - bandwidth_up_total_) / elapsed
+                : 0.0;
+  bandwidth_down_total_ = bandwidth->first;
+  bandwidth_up_total_ = bandwidth->second;
+  bandwidth_time_ = now;
+
+  auto keep = bandwidth_rate_valid_ ? bandwidth_smoothing_ : 0.0;
+  bandwidth_down_rate_ = keep * bandwidth_down_rate_ + (1 - keep) * down;
+  bandwidth_up_rate_ = keep * bandwidth_up_rate_ + (1 - keep) * up;
+  bandwidth_rate_valid_ = true;
 }
 
 waybar::modules::Network::Network(const std::string &id, const Json::Value &config)
@@ -90,19 +134,23 @@ waybar::modules::Network::Network(const std::string &id, const Json::Value &conf
   // the module start with no text, but the event_box_ is shown.
   label_.set_markup("<s></s>");
 
+  if (config_["interface"].isString()) {
+    interface_pattern_ = config_["interface"].asString();
+  }
+
   if (config_["family"] == "ipv6") {
     addr_pref_ = IPV6;
   } else if (config["family"] == "ipv4_6") {
     addr_pref_ = IPV4_6;
   }
 
-  auto bandwidth = readBandwidthUsage();
-  if (bandwidth.has_value()) {
-    bandwidth_down_total_ = (*bandwidth).first;
-    bandwidth_up_total_ = (*bandwidth).second;
-  } else {
-    bandwidth_down_total_ = 0;
-    bandwidth_up_total_ = 0;
+  if (config_["bandwidth-interval"].isNumeric()) {
+    auto seconds = std::max(config_["bandwidth-interval"].asDouble(), 0.1);
+    bandwidth_interval_ = std::chrono::milliseconds(static_cast<long>(seconds * 1000));
+    bandwidth_smoothing_ = 0.7;
+  }
+  if (config_["bandwidth-smoothing"].isNumeric()) {
+    bandwidth_smoothing_ = std::clamp(config_["bandwidth-smoothing"].asDouble(), 0.0, 0.99);
   }
 
   if (!config_["interface"].isString()) {
@@ -128,6 +176,9 @@ waybar::modules::Network::Network(const std::string &id, const Json::Value &conf
 }
 
 waybar::modules::Network::~Network() {
+  // Their callbacks use the sockets
+  bandwidth_timer_.stop();
+  timer_.stop();
   if (ev_fd_ > -1) {
     close(ev_fd_);
   }
@@ -143,6 +194,10 @@ waybar::modules::Network::~Network() {
     nl_close(sock_);
     nl_socket_free(sock_);
   }
+  if (stats_sock_ != nullptr) {
+    nl_close(stats_sock_);
+    nl_socket_free(stats_sock_);
+  }
 }
 
 void waybar::modules::Network::createEventSocket() {
@@ -201,27 +256,46 @@ void waybar::modules::Network::createInfoSocket() {
   if (nl80211_id_ < 0) {
     spdlog::warn("Can't resolve nl80211 interface");
   }
+
+  stats_sock_ = nl_socket_alloc();
+  // Requests are answered by a single message, without an ack to wait for
+  nl_socket_disable_auto_ack(stats_sock_);
+  if (nl_connect(stats_sock_, NETLINK_ROUTE) != 0 ||
+      nl_socket_modify_cb(stats_sock_, NL_CB_VALID, NL_CB_CUSTOM, handleStats, this) < 0) {
+    spdlog::warn("network: can't connect statistics socket, reading {}", netdev_.path());
+    nl_socket_free(stats_sock_);
+    stats_sock_ = nullptr;
+  }
 }
 
 void waybar::modules::Network::worker() {
   // update via here not working
-  thread_timer_ = [this] {
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      if (ifid_ > 0) {
-        getInfo();
+  timer_ = util::ScheduledTask(
+      interval_,
+      [this] {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ifid_ > 0) {
+          getInfo();
+        }
+        emitUpdate();
+      },
+      interval_align_);
+  if (bandwidth_interval_.count() > 0) {
+    bandwidth_timer_ = util::ScheduledTask(bandwidth_interval_, [this] {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sampleBandwidth();
       }
-      dp.emit();
-    }
-    thread_timer_.sleep_for(interval_);
-  };
+      emitUpdate();
+    });
+  }
 #ifdef WANT_RFKILL
   rfkill_.on_update.connect([this](auto &) {
     /* If we are here, it's likely that the network thread already holds the mutex and will be
      * holding it for a next few seconds.
      * Let's delegate the update to the timer thread instead of blocking the main thread.
      */
-    thread_timer_.wake_up();
+    timer_.wake_up();
   });
 #else
   spdlog::warn("Waybar has been built without rfkill support.");
@@ -275,21 +349,15 @@ const std::string waybar::modules::Network::getNetworkState() const {
 
 auto waybar::modules::Network::update() -> void {
   std::lock_guard<std::mutex> lock(mutex_);
+  // Events from now on need another update
+  update_pending_ = false;
   std::string tooltip_format;
 
-  auto bandwidth = readBandwidthUsage();
-  auto bandwidth_down = 0ull;
-  auto bandwidth_up = 0ull;
-  if (bandwidth.has_value()) {
-    auto down_octets = (*bandwidth).first;
-    auto up_octets = (*bandwidth).second;
-
-    bandwidth_down = down_octets - bandwidth_down_total_;
-    bandwidth_down_total_ = down_octets;
-
-    bandwidth_up = up_octets - bandwidth_up_total_;
-    bandwidth_up_total_ = up_octets;
+  if (!bandwidth_timer_.isRunning()) {
+    sampleBandwidth();
   }
+  auto bandwidth_down = bandwidth_down_rate_;
+  auto bandwidth_up = bandwidth_up_rate_;
 
   if (!alt_) {
     auto state = getNetworkState();
@@ -325,31 +393,63 @@ auto waybar::modules::Network::update() -> void {
     final_ipaddr_ += ipaddr6_;
   }
 
-  auto text = fmt::format(
-      fmt::runtime(format_), fmt::arg("essid", essid_), fmt::arg("bssid", bssid_),
-      fmt::arg("signaldBm", signal_strength_dbm_), fmt::arg("signalStrength", signal_strength_),
-      fmt::arg("signalStrengthApp", signal_strength_app_), fmt::arg("ifname", ifname_),
-      fmt::arg("netmask", netmask_), fmt::arg("netmask6", netmask6_),
-      fmt::arg("ipaddr", final_ipaddr_), fmt::arg("gwaddr", gwaddr_), fmt::arg("cidr", cidr_),
-      fmt::arg("cidr6", cidr6_), fmt::arg("frequency", fmt::format("{:.1f}", frequency_)),
-      fmt::arg("icon", getIcon(signal_strength_, state_)),
-      fmt::arg("bandwidthDownBits",
-               pow_format(bandwidth_down * 8ull / (interval_.count() / 1000.0), "b/s")),
-      fmt::arg("bandwidthUpBits",
-               pow_format(bandwidth_up * 8ull / (interval_.count() / 1000.0), "b/s")),
-      fmt::arg(
-          "bandwidthTotalBits",
-          pow_format((bandwidth_up + bandwidth_down) * 8ull / (interval_.count() / 1000.0), "b/s")),
-      fmt::arg("bandwidthDownOctets",
-               pow_format(bandwidth_down / (interval_.count() / 1000.0), "o/s")),
-      fmt::arg("bandwidthUpOctets", pow_format(bandwidth_up / (interval_.count() / 1000.0), "o/s")),
-      fmt::arg("bandwidthTotalOctets",
-               pow_format((bandwidth_up + bandwidth_down) / (interval_.count() / 1000.0), "o/s")),
-      fmt::arg("bandwidthDownBytes",
-               pow_format(bandwidth_down / (interval_.count() / 1000.0), "B/s")),
-      fmt::arg("bandwidthUpBytes", pow_format(bandwidth_up / (interval_.count() / 1000.0), "B/s")),
-      fmt::arg("bandwidthTotalBytes",
-               pow_format((bandwidth_up + bandwidth_down) / (interval_.count() / 1000.0), "B/s")));
+  // Only the fields the formats reference are computed and formatted
+  auto lookup = [&](std::string_view field, auto emit) {
+    if (field == "essid") {
+      emit(essid_);
+    } else if (field == "bssid") {
+      emit(bssid_);
+    } else if (field == "signaldBm") {
+      emit(signal_strength_dbm_);
+    } else if (field == "signalStrength") {
+      emit(signal_strength_);
+    } else if (field == "signalStrengthApp") {
+      emit(signal_strength_app_);
+    } else if (field == "ifname") {
+      emit(ifname_);
+    } else if (field == "netmask") {
+      emit(netmask_);
+    } else if (field == "netmask6") {
+      emit(netmask6_);
+    } else if (field == "ipaddr") {
+      emit(final_ipaddr_);
+    } else if (field == "gwaddr") {
+      emit(gwaddr_);
+    } else if (field == "cidr") {
+      emit(cidr_);
+    } else if (field == "cidr6") {
+      emit(cidr6_);
+    } else if (field == "frequency") {
+      emit(fmt::format("{:.1f}", frequency_));
+    } else if (field == "icon") {
+      emit(getIcon(signal_strength_, state_));
+    } else if (field.starts_with("bandwidth")) {
+      // bandwidth{Down,Up,Total}{Bits,Octets,Bytes}
+      auto unit = field.substr(9);
+      double rate;
+      if (unit.starts_with("Down")) {
+        rate = bandwidth_down;
+        unit.remove_prefix(4);
+      } else if (unit.starts_with("Up")) {
+        rate = bandwidth_up;
+        unit.remove_prefix(2);
+      } else if (unit.starts_with("Total")) {
+        rate = bandwidth_up + bandwidth_down;
+        unit.remove_prefix(5);
+      } else {
+        return;
+      }
+      if (unit == "Bits") {
+        emit(pow_format(rate * 8, "b/s"));
+      } else if (unit == "Octets") {
+        emit(pow_format(rate, "o/s"));
+      } else if (unit == "Bytes") {
+        emit(pow_format(rate, "B/s"));
+      }
+    }
+  };
+
+  auto text = compiledFormat(format_).formatLookup(lookup);
   if (text.compare(label_.get_label()) != 0) {
     label_.set_markup(text);
     if (text.empty()) {
@@ -363,27 +463,7 @@ auto waybar::modules::Network::update() -> void {
       tooltip_format = config_["tooltip-format"].asString();
     }
     if (!tooltip_format.empty()) {
-      auto tooltip_text = fmt::format(
-          fmt::runtime(tooltip_format), fmt::arg("essid", essid_), fmt::arg("bssid", bssid_),
-          fmt::arg("signaldBm", signal_strength_dbm_), fmt::arg("signalStrength", signal_strength_),
-          fmt::arg("signalStrengthApp", signal_strength_app_), fmt::arg("ifname", ifname_),
-          fmt::arg("netmask", netmask_), fmt::arg("netmask6", netmask6_),
-          fmt::arg("ipaddr", final_ipaddr_), fmt::arg("gwaddr", gwaddr_), fmt::arg("cidr", cidr_),
-          fmt::arg("cidr6", cidr6_), fmt::arg("frequency", fmt::format("{:.1f}", frequency_)),
-          fmt::arg("icon", getIcon(signal_strength_, state_)),
-          fmt::arg("bandwidthDownBits",
-                   pow_format(bandwidth_down * 8ull / interval_.count(), "b/s")),
-          fmt::arg("bandwidthUpBits", pow_format(bandwidth_up * 8ull / interval_.count(), "b/s")),
-          fmt::arg("bandwidthTotalBits",
-                   pow_format((bandwidth_up + bandwidth_down) * 8ull / interval_.count(), "b/s")),
-          fmt::arg("bandwidthDownOctets", pow_format(bandwidth_down / interval_.count(), "o/s")),
-          fmt::arg("bandwidthUpOctets", pow_format(bandwidth_up / interval_.count(), "o/s")),
-          fmt::arg("bandwidthTotalOctets",
-                   pow_format((bandwidth_up + bandwidth_down) / interval_.count(), "o/s")),
-          fmt::arg("bandwidthDownBytes", pow_format(bandwidth_down / interval_.count(), "B/s")),
-          fmt::arg("bandwidthUpBytes", pow_format(bandwidth_up / interval_.count(), "B/s")),
-          fmt::arg("bandwidthTotalBytes",
-                   pow_format((bandwidth_up + bandwidth_down) / interval_.count(), "B/s")));
+      auto tooltip_text = compiledFormat(tooltip_format).formatLookup(lookup);
       if (label_.get_tooltip_text() != tooltip_text) {
         label_.set_tooltip_markup(tooltip_text);
       }
@@ -397,7 +477,7 @@ auto waybar::modules::Network::update() -> void {
 }
 
 // https://gist.github.com/rressi/92af77630faf055934c723ce93ae2495
-static bool wildcardMatch(const std::string &pattern, const std::string &text) {
+static bool wildcardMatch(std::string_view pattern, std::string_view text) {
   auto P = int(pattern.size());
   auto T = int(text.size());
 
@@ -435,27 +515,18 @@ static bool wildcardMatch(const std::string &pattern, const std::string &text) {
   return p == P;
 }
 
-bool waybar::modules::Network::matchInterface(const std::string &ifname,
-                                              const std::vector<std::string> &altnames,
-                                              std::string &matched) const {
-  if (!config_["interface"].isString()) {
+bool waybar::modules::Network::matchInterface(std::string_view ifname) const {
+  if (!interface_pattern_) {
     return false;
   }
+  return *interface_pattern_ == ifname || wildcardMatch(*interface_pattern_, ifname);
+}
 
-  auto config_ifname = config_["interface"].asString();
-  if (config_ifname == ifname || wildcardMatch(config_ifname, ifname)) {
-    matched = ifname;
-    return true;
-  }
-
-  for (const auto &altname : altnames) {
-    if (config_ifname == altname || wildcardMatch(config_ifname, altname)) {
-      matched = altname;
-      return true;
-    }
+// Netlink events come in bursts, a single update is queued until it runs
+void waybar::modules::Network::requestUpdate() {
+  if (!update_pending_.exchange(true)) {
+    dp.emit();
   }
-
-  return false;
 }
 
 void waybar::modules::Network::clearIface() {
@@ -490,55 +561,42 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
     case RTM_NEWLINK: {
       struct ifinfomsg *ifi = static_cast<struct ifinfomsg *>(NLMSG_DATA(nh));
       struct nlattr *attrs[IFLA_MAX + 1];
-      std::string ifname;
-      std::vector<std::string> altnames;
+      std::string_view ifname;
       std::optional<bool> carrier;
 
+      // Links other than ours (containers, veth pairs...) are skipped before any parsing. Without
+      // one, only a configured "interface" picks them, routes pick it otherwise.
+      bool selecting = net->ifid_ == -1 && !is_del_event && net->interface_pattern_;
+      if (net->ifid_ != -1 ? ifi->ifi_index != net->ifid_ : !selecting) {
+        return NL_OK;
+      }
+
       if (nlmsg_parse(nh, sizeof(*ifi), attrs, IFLA_MAX, nullptr) < 0) {
         spdlog::error("network: failed to parse netlink attributes");
         return NL_SKIP;
       }
 
-      if (net->ifid_ != -1 && ifi->ifi_index != net->ifid_) {
-        return NL_OK;
-      }
-
       // Check if the interface goes "down" and if we want to detect the
       // external interface.
-      if (net->ifid_ != -1 && !(ifi->ifi_flags & IFF_UP) && !net->config_["interface"].isString()) {
+      if (net->ifid_ != -1 && !(ifi->ifi_flags & IFF_UP) && !net->interface_pattern_) {
         // The current interface is now down, all the routes associated with
         // it have been deleted, so start looking for a new default route.
         spdlog::debug("network: if{} down", net->ifid_);
         net->clearIface();
-        net->dp.emit();
+        net->requestUpdate();
         net->want_route_dump_ = true;
         net->askForStateDump();
         return NL_OK;
       }
 
       if (attrs[IFLA_IFNAME] != nullptr) {
-        const char *ifname_ptr = nla_get_string(attrs[IFLA_IFNAME]);
-        size_t ifname_len = nla_len(attrs[IFLA_IFNAME]) - 1;  // minus \0
-        ifname = std::string(ifname_ptr, ifname_len);
+        ifname = nlaStringView(attrs[IFLA_IFNAME]);
       }
 
       if (attrs[IFLA_CARRIER] != nullptr) {
         carrier = nla_get_u8(attrs[IFLA_CARRIER]) == 1;
       }
 
-      if (attrs[IFLA_PROP_LIST] != nullptr) {
-        struct nlattr *prop;
-        int rem;
-
-        nla_for_each_nested(prop, attrs[IFLA_PROP_LIST], rem) {
-          if (nla_type(prop) == IFLA_ALT_IFNAME) {
-            const char *altname_ptr = nla_get_string(prop);
-            size_t altname_len = nla_len(prop) - 1;  // minus \0
-            altnames.emplace_back(altname_ptr, altname_len);
-          }
-        }
-      }
-
       if (!is_del_event && ifi->ifi_index == net->ifid_) {
         // Update interface information
         if (net->ifname_.empty() && !ifname.empty()) {
@@ -548,7 +606,7 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
           if (net->carrier_ != *carrier) {
             if (*carrier) {
               // Ask for WiFi information
-              net->thread_timer_.wake_up();
+              net->timer_.wake_up();
             } else {
               // clear state related to WiFi connection
               net->essid_.clear();
@@ -561,10 +619,23 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
           }
           net->carrier_ = carrier.value();
         }
-      } else if (!is_del_event && net->ifid_ == -1) {
-        // Checking if it's an interface we care about.
-        std::string matched;
-        if (net->matchInterface(ifname, altnames, matched)) {
+      } else if (selecting) {
+        // Checking if it's an interface we care about, by its name or one of its altnames.
+        std::string_view matched;
+        if (net->matchInterface(ifname)) {
+          matched = ifname;
+        } else if (attrs[IFLA_PROP_LIST] != nullptr) {
+          struct nlattr *prop;
+          int rem;
+
+          nla_for_each_nested(prop, attrs[IFLA_PROP_LIST], rem) {
+            if (nla_type(prop) == IFLA_ALT_IFNAME && net->matchInterface(nlaStringView(prop))) {
+              matched = nlaStringView(prop);
+              break;
+            }
+          }
+        }
+        if (!matched.empty()) {
           if (ifname == matched) {
             spdlog::debug("network: selecting new interface {}/{}", ifname, ifi->ifi_index);
           } else {
@@ -585,7 +656,7 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
           if (carrier.has_value()) {
             net->carrier_ = carrier.value();
           }
-          net->thread_timer_.wake_up();
+          net->timer_.wake_up();
           /* An address for this new interface should be received via an
            * RTM_NEWADDR event either because we ask for a dump of both links
            * and addrs, or because this interface has just been created and
@@ -597,7 +668,7 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
         spdlog::debug("network: interface {}/{} deleted", net->ifname_, net->ifid_);
 
         net->clearIface();
-        net->dp.emit();
+        net->requestUpdate();
       }
       break;
     }
@@ -608,8 +679,10 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
       struct ifaddrmsg *ifa = static_cast<struct ifaddrmsg *>(NLMSG_DATA(nh));
       ssize_t attrlen = IFA_PAYLOAD(nh);
       struct rtattr *ifa_rta = IFA_RTA(ifa);
+      bool changed = false;
 
-      if ((int)ifa->ifa_index != net->ifid_) {
+      if ((int)ifa->ifa_index != net->ifid_ ||
+          (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)) {
         return NL_OK;
       }
 
@@ -623,19 +696,20 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
           case IFA_ADDRESS:
             if (net->is_p2p_) continue;
           case IFA_LOCAL:
-            char ipaddr[INET6_ADDRSTRLEN];
             if (!is_del_event) {
+              // Addresses are refreshed as their lifetime goes by, these are formatted again but
+              // only a different one triggers an update
               if ((net->addr_pref_ == ip_addr_pref::IPV4 ||
                    net->addr_pref_ == ip_addr_pref::IPV4_6) &&
                   net->cidr_ == 0 && ifa->ifa_family == AF_INET) {
-                net->ipaddr_ =
-                    inet_ntop(ifa->ifa_family, RTA_DATA(ifa_rta), ipaddr, sizeof(ipaddr));
+                changed |= setAddress(net->ipaddr_, ifa->ifa_family, RTA_DATA(ifa_rta));
+                changed |= net->cidr_ != ifa->ifa_prefixlen;
                 net->cidr_ = ifa->ifa_prefixlen;
               } else if ((net->addr_pref_ == ip_addr_pref::IPV6 ||
                           net->addr_pref_ == ip_addr_pref::IPV4_6) &&
                          net->cidr6_ == 0 && ifa->ifa_family == AF_INET6) {
-                net->ipaddr6_ =
-                    inet_ntop(ifa->ifa_family, RTA_DATA(ifa_rta), ipaddr, sizeof(ipaddr));
+                changed |= setAddress(net->ipaddr6_, ifa->ifa_family, RTA_DATA(ifa_rta));
+                changed |= net->cidr6_ != ifa->ifa_prefixlen;
                 net->cidr6_ = ifa->ifa_prefixlen;
               }
 
@@ -643,7 +717,7 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
                 case AF_INET: {
                   struct in_addr netmask;
                   netmask.s_addr = htonl(~0 << (32 - ifa->ifa_prefixlen));
-                  net->netmask_ = inet_ntop(ifa->ifa_family, &netmask, ipaddr, sizeof(ipaddr));
+                  changed |= setAddress(net->netmask_, ifa->ifa_family, &netmask);
                 }
                 case AF_INET6: {
                   struct in6_addr netmask6;
@@ -653,11 +727,15 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
                     if (v > 8) v = 8;
                     netmask6.s6_addr[i] = ~0 << v;
                   }
-                  net->netmask6_ = inet_ntop(ifa->ifa_family, &netmask6, ipaddr, sizeof(ipaddr));
+                  changed |= setAddress(net->netmask6_, ifa->ifa_family, &netmask6);
                 }
               }
-              spdlog::debug("network: {}, new addr {}/{}", net->ifname_, net->ipaddr_, net->cidr_);
+              if (changed) {
+                spdlog::debug("network: {}, new addr {}/{}", net->ifname_, net->ipaddr_,
+                              net->cidr_);
+              }
             } else {
+              char ipaddr[INET6_ADDRSTRLEN];
               net->ipaddr_.clear();
               net->ipaddr6_.clear();
               net->cidr_ = 0;
@@ -667,11 +745,14 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
               spdlog::debug("network: {} addr deleted {}/{}", net->ifname_,
                             inet_ntop(ifa->ifa_family, RTA_DATA(ifa_rta), ipaddr, sizeof(ipaddr)),
                             ifa->ifa_prefixlen);
+              changed = true;
             }
-            net->dp.emit();
             break;
         }
       }
+      if (changed) {
+        net->requestUpdate();
+      }
       break;
     }
 
@@ -685,7 +766,8 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
       int family = rtm->rtm_family;
       ssize_t attrlen = RTM_PAYLOAD(nh);
       struct rtattr *attr = RTM_RTA(rtm);
-      char gateway_addr[INET6_ADDRSTRLEN];
+      // Only formatted for the route that gets picked
+      const void *gateway = nullptr;
       bool has_gateway = false;
       bool has_destination = false;
       int temp_idx = -1;
@@ -694,7 +776,7 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
       /* Find the message(s) concerting the main routing table, each message
        * corresponds to a single routing table entry.
        */
-      if (rtm->rtm_table != RT_TABLE_MAIN) {
+      if (rtm->rtm_table != RT_TABLE_MAIN || (family != AF_INET && family != AF_INET6)) {
         return NL_OK;
       }
 
@@ -711,7 +793,7 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
              * If someone ever needs to figure out the gateway address as well,
              * it's here as the attribute payload.
              */
-            inet_ntop(family, RTA_DATA(attr), gateway_addr, sizeof(gateway_addr));
+            gateway = RTA_DATA(attr);
             has_gateway = true;
             break;
           case RTA_DST: {
@@ -756,8 +838,8 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
           net->clearIface();
           net->ifid_ = temp_idx;
           net->route_priority = priority;
-          net->gwaddr_ = gateway_addr;
-          spdlog::debug("network: new default route via {} on if{} metric {}", gateway_addr,
+          setAddress(net->gwaddr_, family, gateway);
+          spdlog::debug("network: new default route via {} on if{} metric {}", net->gwaddr_,
                         temp_idx, priority);
 
           /* Ask ifname associated with temp_idx as well as carrier status */
@@ -779,13 +861,13 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
            * addresses. */
           net->want_addr_dump_ = true;
           net->askForStateDump();
-          net->thread_timer_.wake_up();
+          net->timer_.wake_up();
         } else if (is_del_event && temp_idx == net->ifid_ && net->route_priority == priority) {
           spdlog::debug("network: default route deleted {}/if{} metric {}", net->ifname_, temp_idx,
                         priority);
 
           net->clearIface();
-          net->dp.emit();
+          net->requestUpdate();
           /* Ask for a dump of all routes in case another one is already
            * setup. If there's none, there'll be an event with new one
            * later. */
@@ -833,6 +915,33 @@ int waybar::modules::Network::handleEventsDone(struct nl_msg *msg, void *data) {
   return NL_OK;
 }
 
+int waybar::modules::Network::handleStats(struct nl_msg *msg, void *data) {
+  auto net = static_cast<waybar::modules::Network *>(data);
+  auto nh = nlmsg_hdr(msg);
+  struct nlattr *attrs[IFLA_MAX + 1];
+  if (nh->nlmsg_type != RTM_NEWLINK ||
+      nlmsg_parse(nh, sizeof(struct ifinfomsg), attrs, IFLA_MAX, nullptr) < 0) {
+    return NL_SKIP;
+  }
+  // The byte counters are among the first fields of both structures, which grow over time
+  constexpr auto stats64_len = offsetof(struct rtnl_link_stats64, tx_bytes) + sizeof(__u64);
+  constexpr auto stats_len = offsetof(struct rtnl_link_stats, tx_bytes) + sizeof(__u32);
+  if (attrs[IFLA_STATS64] != nullptr && nla_len(attrs[IFLA_STATS64]) >= (int)stats64_len) {
+    struct rtnl_link_stats64 stats;
+    memset(&stats, 0, sizeof(stats));
+    memcpy(&stats, nla_data(attrs[IFLA_STATS64]),
+           std::min<size_t>(nla_len(attrs[IFLA_STATS64]), sizeof(stats)));
+    net->stats_reply_ = std::make_pair(stats.rx_bytes, stats.tx_bytes);
+  } else if (attrs[IFLA_STATS] != nullptr && nla_len(attrs[IFLA_STATS]) >= (int)stats_len) {
+    struct rtnl_link_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    memcpy(&stats, nla_data(attrs[IFLA_STATS]),
+           std::min<size_t>(nla_len(attrs[IFLA_STATS]), sizeof(stats)));
+    net->stats_reply_ = std::make_pair(stats.rx_bytes, stats.tx_bytes);
+  }
+  return NL_OK;
+}
+
 int waybar::modules::Network::handleScan(struct nl_msg *msg, void *data) {
   auto net = static_cast<waybar::modules::Network *>(data);
   auto gnlh = static_cast<genlmsghdr *>(nlmsg_data(nlmsg_hdr(msg)));
@@ -10,7 +10,9 @@
 namespace waybar::modules::niri {
 
 Window::Window(const std::string &id, const Bar &bar, const Json::Value &config)
-    : AAppIconLabel(config, "window", id, "{title}", 0, true), bar_(bar) {
+    : AAppIconLabel(config, "window", id, "{title}", 0, true),
+      bar_(bar),
+      rewriteRules_(config["rewrite"]) {
   if (!gIPC) gIPC = std::make_unique<IPC>();
 
   gIPC->registerForIPC("WindowsChanged", this);
@@ -60,10 +62,9 @@ void Window::doUpdate() {
     const auto sanitizedAppId = waybar::util::sanitize_string(appId);
 
     label_.show();
-    label_.set_markup(waybar::util::rewriteString(
-        fmt::format(fmt::runtime(format_), fmt::arg("title", sanitizedTitle),
-                    fmt::arg("app_id", sanitizedAppId)),
-        config_["rewrite"]));
+    label_.set_markup(rewriteRules_.apply(fmt::format(fmt::runtime(format_),
+                                                      fmt::arg("title", sanitizedTitle),
+                                                      fmt::arg("app_id", sanitizedAppId))));
 
     updateAppIconName(appId, "");
 
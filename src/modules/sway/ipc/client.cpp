@@ -3,39 +3,83 @@
 #include <fcntl.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+#include <sstream>
 #include <stdexcept>
+#include <string_view>
+
+#include "util/json.hpp"
 
 namespace waybar::modules::sway {
 
-Ipc::Ipc() {
+namespace {
+
+constexpr uint32_t IPC_EVENT_FLAG = 1U << 31;
+
+constexpr std::array<std::pair<std::string_view, uint32_t>, 10> EVENT_TYPES = {{
+    {"workspace", IPC_EVENT_WORKSPACE},
+    {"output", IPC_EVENT_OUTPUT},
+    {"mode", IPC_EVENT_MODE},
+    {"window", IPC_EVENT_WINDOW},
+    {"barconfig_update", IPC_EVENT_BARCONFIG_UPDATE},
+    {"binding", IPC_EVENT_BINDING},
+    {"shutdown", IPC_EVENT_SHUTDOWN},
+    {"tick", IPC_EVENT_TICK},
+    {"bar_state_update", IPC_EVENT_BAR_STATE_UPDATE},
+    {"input", IPC_EVENT_INPUT},
+}};
+
+}  // namespace
+
+util::Debouncer makeRefreshDebouncer(const Json::Value& config, std::function<void()> refresh) {
+  // One frame by default, events of the same user action arrive well within it
+  auto delay = std::chrono::milliseconds(
+      config["event-debounce"].isUInt() ? config["event-debounce"].asUInt() : 16);
+  auto maxLatency = std::chrono::milliseconds(
+      config["event-max-latency"].isUInt() ? config["event-max-latency"].asUInt() : 100);
+  return util::Debouncer(delay, maxLatency, std::move(refresh));
+}
+
+Ipc::Ipc() { IpcHub::inst().addClient(this); }
+
+Ipc::~Ipc() { IpcHub::inst().removeClient(this); }
+
+void Ipc::sendCmd(uint32_t type, const std::string& payload) {
+  const auto res = IpcHub::inst().sendCmd(type, payload);
+  signal_cmd.emit(res);
+}
+
+void Ipc::subscribe(const std::string& payload) { IpcHub::inst().subscribe(this, payload); }
+
+IpcHub::IpcHub() {
   const std::string& socketPath = getSocketPath();
   fd_ = open(socketPath);
   fd_event_ = open(socketPath);
+  socketOwnerPid_ = getpid();
+  thread_ = std::thread([this] { eventListener(); });
 }
 
-Ipc::~Ipc() {
-  thread_.stop();
+IpcHub::~IpcHub() {
+  // A child process exiting after a failed exec() must not shut down the parent's sockets
+  if (getpid() != socketOwnerPid_) return;
 
-  if (fd_ > 0) {
-    // To fail the IPC header
-    if (write(fd_, "close-sway-ipc", 14) == -1) {
-      spdlog::error("Failed to close sway IPC");
-    }
-    close(fd_);
-    fd_ = -1;
-  }
-  if (fd_event_ > 0) {
-    if (write(fd_event_, "close-sway-ipc", 14) == -1) {
-      spdlog::error("Failed to close sway IPC event handler");
-    }
-    close(fd_event_);
-    fd_event_ = -1;
+  running_ = false;
+  // Wakes up the event thread
+  shutdown(fd_event_, SHUT_RDWR);
+  if (thread_.joinable()) {
+    thread_.join();
   }
+  close(fd_event_);
+  close(fd_);
 }
 
-void Ipc::setWorker(std::function<void()>&& func) { thread_ = func; }
+IpcHub& IpcHub::inst() {
+  static IpcHub hub;
+  return hub;
+}
 
-const std::string Ipc::getSocketPath() const {
+const std::string IpcHub::getSocketPath() const {
   const char* env = getenv("SWAYSOCK");
   if (env != nullptr) {
     return std::string(env);
@@ -63,7 +107,7 @@ const std::string Ipc::getSocketPath() const {
   return str;
 }
 
-int Ipc::open(const std::string& socketPath) const {
+int IpcHub::open(const std::string& socketPath) const {
   int32_t fd = socket(AF_UNIX, SOCK_STREAM, 0);
   if (fd == -1) {
     throw std::runtime_error("Unable to open Unix socket");
@@ -76,12 +120,13 @@ int Ipc::open(const std::string& socketPath) const {
   addr.sun_path[sizeof(addr.sun_path) - 1] = 0;
   int l = sizeof(struct sockaddr_un);
   if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), l) == -1) {
+    ::close(fd);
     throw std::runtime_error("Unable to connect to Sway");
   }
   return fd;
 }
 
-struct Ipc::ipc_response Ipc::recv(int fd) {
+struct Ipc::ipc_response IpcHub::recv(int fd) {
   std::string header;
   header.resize(ipc_header_size_);
   auto data32 = reinterpret_cast<uint32_t*>(header.data() + ipc_magic_.size());
@@ -89,7 +134,7 @@ struct Ipc::ipc_response Ipc::recv(int fd) {
 
   while (total < ipc_header_size_) {
     auto res = ::recv(fd, header.data() + total, ipc_header_size_ - total, 0);
-    if (fd_event_ == -1 || fd_ == -1) {
+    if (!running_) {
       // IPC is closed so just return an empty response
       return {0, 0, ""};
     }
@@ -114,12 +159,15 @@ struct Ipc::ipc_response Ipc::recv(int fd) {
       }
       throw std::runtime_error("Unable to receive IPC payload");
     }
+    if (res == 0) {
+      throw std::runtime_error("Unable to receive IPC payload");
+    }
     total += res;
   }
-  return {data32[0], data32[1], &payload.front()};
+  return {data32[0], data32[1], std::move(payload)};
 }
 
-struct Ipc::ipc_response Ipc::send(int fd, uint32_t type, const std::string& payload) {
+void IpcHub::write(int fd, uint32_t type, const std::string& payload) {
   std::string header;
   header.resize(ipc_header_size_);
   auto data32 = reinterpret_cast<uint32_t*>(header.data() + ipc_magic_.size());
@@ -133,25 +181,150 @@ struct Ipc::ipc_response Ipc::send(int fd, uint32_t type, const std::string& pay
   if (::send(fd, payload.c_str(), payload.size(), 0) == -1) {
     throw std::runtime_error("Unable to send IPC payload");
   }
-  return Ipc::recv(fd);
 }
 
-void Ipc::sendCmd(uint32_t type, const std::string& payload) {
+struct Ipc::ipc_response IpcHub::send(int fd, uint32_t type, const std::string& payload) {
+  write(fd, type, payload);
+  return recv(fd);
+}
+
+bool IpcHub::isCacheable(uint32_t type, const std::string& payload) const {
+  if (!payload.empty()) {
+    return false;
+  }
+  auto subscribed = subscribed_.load();
+  if (type == IPC_GET_WORKSPACES) {
+    return (subscribed & event_mask(IPC_EVENT_WORKSPACE)) != 0;
+  }
+  if (type == IPC_GET_TREE) {
+    return (subscribed & event_mask(IPC_EVENT_WORKSPACE)) != 0 &&
+           (subscribed & event_mask(IPC_EVENT_WINDOW)) != 0;
+  }
+  return false;
+}
+
+Ipc::ipc_response IpcHub::sendCmd(uint32_t type, const std::string& payload) {
+  // Concurrent requests wait for the one in flight, and then find its reply in the cache
   std::lock_guard<std::mutex> lock(mutex_);
-  const auto res = Ipc::send(fd_, type, payload);
-  signal_cmd.emit(res);
+  bool cacheable = isCacheable(type, payload);
+  // Taken before sending: a reply racing with an event is cached as already stale
+  auto generation = generation_.load();
+  if (cacheable) {
+    if (auto it = cache_.find(type); it != cache_.end() && it->second.generation == generation) {
+      return it->second.response;
+    }
+  }
+  auto res = send(fd_, type, payload);
+  if (cacheable) {
+    cache_[type] = {generation, res};
+  }
+  return res;
+}
+
+void IpcHub::addClient(Ipc* client) {
+  std::lock_guard<std::mutex> lock(clientsMutex_);
+  clients_.emplace_back(client, 0);
+}
+
+void IpcHub::removeClient(Ipc* client) {
+  std::lock_guard<std::mutex> lock(clientsMutex_);
+  std::erase_if(clients_, [client](const auto& entry) { return entry.first == client; });
+}
+
+void IpcHub::subscribe(Ipc* client, const std::string& payload) {
+  uint32_t events = 0;
+  Json::Value missing{Json::arrayValue};
+  {
+    std::lock_guard<std::mutex> lock(subscribeMutex_);
+    auto names = util::JsonParser().parse(payload);
+    for (const auto& name : names) {
+      auto type = std::ranges::find_if(
+          EVENT_TYPES, [&name](const auto& event) { return event.first == name.asString(); });
+      if (type == EVENT_TYPES.end()) {
+        throw std::runtime_error("Unknown ipc event " + name.asString());
+      }
+      events |= event_mask(type->second);
+      if ((subscribed_ & event_mask(type->second)) == 0) {
+        missing.append(name);
+      }
+    }
+
+    // Only the events nobody subscribed to yet are added to the shared connection
+    if (!missing.empty()) {
+      std::future<Ipc::ipc_response> reply;
+      {
+        std::lock_guard<std::mutex> lock(replyMutex_);
+        if (!running_) {
+          throw std::runtime_error("Unable to subscribe ipc event");
+        }
+        reply = subscribeReply_.emplace().get_future();
+      }
+      std::ostringstream oss;
+      oss << missing;
+      write(fd_event_, IPC_SUBSCRIBE, oss.str());
+      if (reply.get().payload != "{\"success\": true}") {
+        throw std::runtime_error("Unable to subscribe ipc event");
+      }
+      subscribed_ |= events;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(clientsMutex_);
+  for (auto& [registered, mask] : clients_) {
+    if (registered == client) {
+      mask |= events;
+    }
+  }
 }
 
-void Ipc::subscribe(const std::string& payload) {
-  auto res = Ipc::send(fd_event_, IPC_SUBSCRIBE, payload);
-  if (res.payload != "{\"success\": true}") {
-    throw std::runtime_error("Unable to subscribe ipc event");
+void IpcHub::dispatch(const Ipc::ipc_response& event) {
+  std::lock_guard<std::mutex> lock(clientsMutex_);
+  for (auto& [client, mask] : clients_) {
+    if ((mask & event_mask(event.type)) == 0) {
+      continue;
+    }
+    try {
+      client->signal_event.emit(event);
+    } catch (const std::exception& e) {
+      spdlog::error("Sway IPC: event handler failed: {}", e.what());
+    }
   }
 }
 
-void Ipc::handleEvent() {
-  const auto res = Ipc::recv(fd_event_);
-  signal_event.emit(res);
+void IpcHub::eventListener() {
+  while (running_) {
+    Ipc::ipc_response res;
+    try {
+      res = recv(fd_event_);
+    } catch (const std::exception& e) {
+      if (running_) {
+        spdlog::error("Sway IPC: {}", e.what());
+      }
+      break;
+    }
+    if (!running_) {
+      break;
+    }
+    if ((res.type & IPC_EVENT_FLAG) != 0) {
+      ++generation_;
+      dispatch(res);
+      continue;
+    }
+    // Anything else on this socket is the reply to a subscription
+    std::lock_guard<std::mutex> lock(replyMutex_);
+    if (subscribeReply_) {
+      subscribeReply_->set_value(std::move(res));
+      subscribeReply_.reset();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(replyMutex_);
+  running_ = false;
+  if (subscribeReply_) {
+    subscribeReply_->set_exception(
+        std::make_exception_ptr(std::runtime_error("Sway IPC connection closed")));
+    subscribeReply_.reset();
+  }
 }
 
 }  // namespace waybar::modules::sway
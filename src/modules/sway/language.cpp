@@ -30,18 +30,10 @@ Language::Language(const std::string& id, const Json::Value& config)
   if (config.isMember("tooltip-format")) {
     tooltip_format_ = config["tooltip-format"].asString();
   }
-  ipc_.subscribe(R"(["input"])");
   ipc_.signal_event.connect(sigc::mem_fun(*this, &Language::onEvent));
   ipc_.signal_cmd.connect(sigc::mem_fun(*this, &Language::onCmd));
+  ipc_.subscribe(R"(["input"])");
   ipc_.sendCmd(IPC_GET_INPUTS);
-  // Launch worker
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception& e) {
-      spdlog::error("Language: {}", e.what());
-    }
-  });
   dp.emit();
 }
 
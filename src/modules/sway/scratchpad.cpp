@@ -14,19 +14,11 @@ Scratchpad::Scratchpad(const std::string& id, const Json::Value& config)
       tooltip_enabled_(config_["tooltip"].isBool() ? config_["tooltip"].asBool() : true),
       tooltip_text_(""),
       count_(0) {
-  ipc_.subscribe(R"(["window"])");
   ipc_.signal_event.connect(sigc::mem_fun(*this, &Scratchpad::onEvent));
   ipc_.signal_cmd.connect(sigc::mem_fun(*this, &Scratchpad::onCmd));
+  ipc_.subscribe(R"(["window"])");
 
   getTree();
-
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception& e) {
-      spdlog::error("Scratchpad: {}", e.what());
-    }
-  });
 }
 auto Scratchpad::update() -> void {
   if (count_ || show_empty_) {
@@ -60,7 +52,8 @@ auto Scratchpad::getTree() -> void {
 auto Scratchpad::onCmd(const struct Ipc::ipc_response& res) -> void {
   try {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto tree = parser_.parse(res.payload);
+    static const util::JsonParser::Keys TREE_KEYS = {"app_id", "floating_nodes", "name", "nodes"};
+    auto tree = parser_.parse(res.payload, TREE_KEYS);
     count_ = tree["nodes"][0]["nodes"][0]["floating_nodes"].size();
     if (tooltip_enabled_) {
       tooltip_text_.clear();
@@ -17,29 +17,34 @@
 namespace waybar::modules::sway {
 
 Window::Window(const std::string& id, const Bar& bar, const Json::Value& config)
-    : AAppIconLabel(config, "window", id, "{}", 0, true), bar_(bar), windowId_(-1) {
-  ipc_.subscribe(R"(["window","workspace"])");
+    : AAppIconLabel(config, "window", id, "{}", 0, true),
+      bar_(bar),
+      windowId_(-1),
+      rewrite_rules_(config["rewrite"]),
+      refresh_(makeRefreshDebouncer(config, [this] { getTree(); })),
+      refresh_stats_since_(std::chrono::steady_clock::now()) {
   ipc_.signal_event.connect(sigc::mem_fun(*this, &Window::onEvent));
   ipc_.signal_cmd.connect(sigc::mem_fun(*this, &Window::onCmd));
+  ipc_.subscribe(R"(["window","workspace"])");
   // Get Initial focused window
   getTree();
-  // Launch worker
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception& e) {
-      spdlog::error("Window: {}", e.what());
-      spdlog::trace("Window::Window exception");
-    }
-  });
 }
 
-void Window::onEvent(const struct Ipc::ipc_response& res) { getTree(); }
+Window::~Window() {
+  // The refresh uses ipc_
+  refresh_.stop();
+}
+
+void Window::onEvent(const struct Ipc::ipc_response& res) { refresh_.trigger(); }
 
 void Window::onCmd(const struct Ipc::ipc_response& res) {
+  // Members of the tree read by getFocusedNode(), the others aren't built
+  static const util::JsonParser::Keys TREE_KEYS = {
+      "app_id", "class", "current_workspace", "floating_nodes", "focused", "id", "instance",
+      "layout", "marks", "name", "nodes", "output", "shell", "type", "window_properties"};
   try {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto payload = parser_.parse(res.payload);
+    auto payload = parser_.parse(res.payload, TREE_KEYS);
     auto output = payload["output"].isString() ? payload["output"].asString() : "";
     std::tie(app_nb_, floating_count_, windowId_, window_, app_id_, app_class_, shell_, layout_,
              marks_) = getFocusedNode(payload["nodes"], output);
@@ -52,6 +57,12 @@ void Window::onCmd(const struct Ipc::ipc_response& res) {
 }
 
 auto Window::update() -> void {
+  auto now = std::chrono::steady_clock::now();
+  if (now - refresh_stats_since_ >= std::chrono::minutes(1)) {
+    auto [events, refreshes] = refresh_.takeStats();
+    spdlog::debug("{}: {} events coalesced into {} tree refreshes", name_, events, refreshes);
+    refresh_stats_since_ = now;
+  }
   spdlog::trace("workspace layout {}, tiled count {}, floating count {}", layout_, app_nb_,
                 floating_count_);
 
@@ -94,10 +105,9 @@ auto Window::update() -> void {
     old_app_id_ = app_id_;
   }
 
-  label_.set_markup(waybar::util::rewriteString(
+  label_.set_markup(rewrite_rules_.apply(
       fmt::format(fmt::runtime(format_), fmt::arg("title", window_), fmt::arg("app_id", app_id_),
-                  fmt::arg("shell", shell_), fmt::arg("marks", marks_)),
-      config_["rewrite"]));
+                  fmt::arg("shell", shell_), fmt::arg("marks", marks_))));
   if (tooltipEnabled()) {
     label_.set_tooltip_text(window_);
   }
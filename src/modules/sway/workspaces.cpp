@@ -3,11 +3,20 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <string>
 
 namespace waybar::modules::sway {
 
+namespace {
+
+// Bits of Workspaces::buttonClasses()
+constexpr std::array<const char *, 6> BUTTON_CLASSES = {"focused",    "visible", "urgent",
+                                                        "persistent", "empty",   "current_output"};
+
+}  // namespace
+
 // Helper function to assign a number to a workspace, just like sway. In fact
 // this is taken quite verbatim from `sway/ipc-json.c`.
 int Workspaces::convertWorkspaceNameToNum(std::string name) {
@@ -44,7 +53,9 @@ int Workspaces::windowRewritePriorityFunction(std::string const &window_rule) {
 Workspaces::Workspaces(const std::string &id, const Bar &bar, const Json::Value &config)
     : AModule(config, "workspaces", id, false, !config["disable-scroll"].asBool()),
       bar_(bar),
-      box_(bar.orientation, 0) {
+      box_(bar.orientation, 0),
+      refresh_(makeRefreshDebouncer(config, [this] { refreshTree(); })),
+      refresh_stats_since_(std::chrono::steady_clock::now()) {
   if (config["format-icons"]["high-priority-named"].isArray()) {
     for (const auto &it : config["format-icons"]["high-priority-named"]) {
       high_priority_named_.push_back(it.asString());
@@ -69,27 +80,25 @@ Workspaces::Workspaces(const std::string &id, const Bar &bar, const Json::Value
     m_windowRewriteRules = waybar::util::RegexCollection(
         windowRewrite, std::move(windowRewriteDefault), windowRewritePriorityFunction);
   }
-  ipc_.subscribe(R"(["workspace"])");
-  ipc_.subscribe(R"(["window"])");
   ipc_.signal_event.connect(sigc::mem_fun(*this, &Workspaces::onEvent));
   ipc_.signal_cmd.connect(sigc::mem_fun(*this, &Workspaces::onCmd));
+  ipc_.subscribe(R"(["workspace","window"])");
   ipc_.sendCmd(IPC_GET_TREE);
   if (config["enable-bar-scroll"].asBool()) {
     auto &window = const_cast<Bar &>(bar_).window;
     window.add_events(Gdk::SCROLL_MASK | Gdk::SMOOTH_SCROLL_MASK);
     window.signal_scroll_event().connect(sigc::mem_fun(*this, &Workspaces::handleScroll));
   }
-  // Launch worker
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception &e) {
-      spdlog::error("Workspaces: {}", e.what());
-    }
-  });
 }
 
-void Workspaces::onEvent(const struct Ipc::ipc_response &res) {
+Workspaces::~Workspaces() {
+  // The refresh uses ipc_
+  refresh_.stop();
+}
+
+void Workspaces::onEvent(const struct Ipc::ipc_response &res) { refresh_.trigger(); }
+
+void Workspaces::refreshTree() {
   try {
     ipc_.sendCmd(IPC_GET_TREE);
   } catch (const std::exception &e) {
@@ -230,6 +239,7 @@ bool Workspaces::filterButtons() {
                            [it](const auto &node) { return node["name"].asString() == it->first; });
     if (ws == workspaces_.end() ||
         (!config_["all-outputs"].asBool() && (*ws)["output"].asString() != bar_.output->name)) {
+      button_states_.erase(it->first);
       it = buttons_.erase(it);
       needReorder = true;
     } else {
@@ -283,53 +293,50 @@ void Workspaces::updateWindows(const Json::Value &node, std::string &windows) {
 }
 
 auto Workspaces::update() -> void {
+  auto now = std::chrono::steady_clock::now();
+  if (now - refresh_stats_since_ >= std::chrono::minutes(1)) {
+    auto [events, refreshes] = refresh_.takeStats();
+    spdlog::debug("{}: {} events coalesced into {} tree refreshes", name_, events, refreshes);
+    refresh_stats_since_ = now;
+  }
   std::lock_guard<std::mutex> lock(mutex_);
   bool needReorder = filterButtons();
   for (auto it = workspaces_.begin(); it != workspaces_.end(); ++it) {
-    auto bit = buttons_.find((*it)["name"].asString());
+    auto name = (*it)["name"].asString();
+    auto bit = buttons_.find(name);
     if (bit == buttons_.end()) {
       needReorder = true;
     }
     auto &button = bit == buttons_.end() ? addButton(*it) : bit->second;
-    if (needReorder) {
-      box_.reorder_child(button, it - workspaces_.begin());
-    }
-    bool noNodes = (*it)["nodes"].empty() && (*it)["floating_nodes"].empty();
-    if (hasFlag((*it), "focused")) {
-      button.get_style_context()->add_class("focused");
-    } else {
-      button.get_style_context()->remove_class("focused");
-    }
-    if (hasFlag((*it), "visible") || ((*it)["output"].isString() && noNodes)) {
-      button.get_style_context()->add_class("visible");
-    } else {
-      button.get_style_context()->remove_class("visible");
+    auto &state = button_states_[name];
+    // Without buttons added or removed, the box still has the order of the last update
+    int position = it - workspaces_.begin();
+    if (needReorder || state.position != position) {
+      box_.reorder_child(button, position);
+      state.position = position;
     }
-    if (hasFlag((*it), "urgent")) {
-      button.get_style_context()->add_class("urgent");
-    } else {
-      button.get_style_context()->remove_class("urgent");
-    }
-    if ((*it)["target_output"].isString()) {
-      button.get_style_context()->add_class("persistent");
-    } else {
-      button.get_style_context()->remove_class("persistent");
-    }
-    if (noNodes) {
-      button.get_style_context()->add_class("empty");
-    } else {
-      button.get_style_context()->remove_class("empty");
+    // The label, classes and visibility only depend on the workspace's node
+    if (state.node == *it) {
+      continue;
     }
-    if ((*it)["output"].isString()) {
-      if (((*it)["output"].asString()) == bar_.output->name) {
-        button.get_style_context()->add_class("current_output");
-      } else {
-        button.get_style_context()->remove_class("current_output");
+    state.node = *it;
+
+    auto classes = buttonClasses(*it);
+    if (auto changed = classes ^ state.classes; changed != 0) {
+      auto style = button.get_style_context();
+      for (size_t i = 0; i < BUTTON_CLASSES.size(); ++i) {
+        if ((changed & (1 << i)) == 0) {
+          continue;
+        }
+        if ((classes & (1 << i)) != 0) {
+          style->add_class(BUTTON_CLASSES[i]);
+        } else {
+          style->remove_class(BUTTON_CLASSES[i]);
+        }
       }
-    } else {
-      button.get_style_context()->remove_class("current_output");
+      state.classes = classes;
     }
-    std::string output = (*it)["name"].asString();
+    std::string output = name;
     std::string windows = "";
     if (config_["window-format"].isString()) {
       updateWindows((*it), windows);
@@ -343,10 +350,13 @@ auto Workspaces::update() -> void {
                    windows.substr(0, windows.length() - m_formatWindowSeparator.length())),
           fmt::arg("output", (*it)["output"].asString()));
     }
-    if (!config_["disable-markup"].asBool()) {
-      static_cast<Gtk::Label *>(button.get_children()[0])->set_markup(output);
-    } else {
-      button.set_label(output);
+    if (!state.label || output != *state.label) {
+      if (!config_["disable-markup"].asBool()) {
+        static_cast<Gtk::Label *>(button.get_children()[0])->set_markup(output);
+      } else {
+        button.set_label(output);
+      }
+      state.label = std::move(output);
     }
     onButtonReady(*it, button);
   }
@@ -354,6 +364,23 @@ auto Workspaces::update() -> void {
   AModule::update();
 }
 
+uint8_t Workspaces::buttonClasses(const Json::Value &node) const {
+  bool noNodes = node["nodes"].empty() && node["floating_nodes"].empty();
+  bool flags[] = {
+      hasFlag(node, "focused"),
+      hasFlag(node, "visible") || (node["output"].isString() && noNodes),
+      hasFlag(node, "urgent"),
+      node["target_output"].isString(),
+      noNodes,
+      node["output"].isString() && node["output"].asString() == bar_.output->name,
+  };
+  uint8_t classes = 0;
+  for (size_t i = 0; i < BUTTON_CLASSES.size(); ++i) {
+    classes |= flags[i] ? 1 << i : 0;
+  }
+  return classes;
+}
+
 Gtk::Button &Workspaces::addButton(const Json::Value &node) {
   auto pair = buttons_.emplace(node["name"].asString(), node["name"].asString());
   auto &&button = pair.first->second;
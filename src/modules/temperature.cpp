@@ -55,15 +55,34 @@ waybar::modules::Temperature::Temperature(const std::string& id, const Json::Val
     throw std::runtime_error("Can't read from " + file_path_);
   }
   temp.close();
-#endif
 
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
+  // Shared with the other instances reading the same sensor, e.g. on other bars
+  util::AdaptiveInterval::Policy policy{
+      .interval = interval_,
+      .adaptive = !config_["adaptive-interval"].isBool() || config_["adaptive-interval"].asBool(),
+      // Below the displayed precision
+      .tolerance = 500,
+      .margin = 5000,
   };
+  if (config_["critical-threshold"].isInt()) {
+    policy.critical = config_["critical-threshold"].asInt64() * 1000;
+  }
+  sensor_ = util::SensorSubscription(file_path_, policy, interval_align_, [this](int64_t value) {
+    millidegrees_ = value;
+    emitUpdate();
+  });
+#else
+  timer_ = util::ScheduledTask(interval_, [this] { emitUpdate(); }, interval_align_);
+#endif
 }
 
 auto waybar::modules::Temperature::update() -> void {
+#if !defined(__FreeBSD__)
+  if (millidegrees_ == NO_READING) {
+    // Before the first reading
+    return;
+  }
+#endif
   auto temperature = getTemperature();
   uint16_t temperature_c = std::round(temperature);
   uint16_t temperature_f = std::round(temperature * 1.8 + 32);
@@ -129,20 +148,7 @@ float waybar::modules::Temperature::getTemperature() {
       "sysctl hw.acpi.thermal.tz{}.temperature and dev.cpu.{}.temperature failed", zone, zone));
 
 #else  // Linux
-  std::ifstream temp(file_path_);
-  if (!temp.is_open()) {
-    throw std::runtime_error("Can't open " + file_path_);
-  }
-  std::string line;
-  if (temp.good()) {
-    getline(temp, line);
-  } else {
-    temp.close();
-    throw std::runtime_error("Can't read from " + file_path_);
-  }
-  temp.close();
-  auto temperature_c = std::strtol(line.c_str(), nullptr, 10) / 1000.0;
-  return temperature_c;
+  return millidegrees_ / 1000.0;
 #endif
 }
 
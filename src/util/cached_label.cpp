@@ -0,0 +1,66 @@
+#include "util/cached_label.hpp"
+
+#include <functional>
+#include <string_view>
+#include <utility>
+
+namespace waybar::util {
+
+namespace {
+size_t hashOf(const Glib::ustring& value, bool markup) {
+  // Text and markup of the same string render differently
+  return std::hash<std::string_view>{}(value.raw()) ^ static_cast<size_t>(markup);
+}
+}  // namespace
+
+bool CachedLabel::changed(std::optional<size_t>& last, size_t hash) {
+  if (last == hash) {
+    ++skipped_;
+    return false;
+  }
+  last = hash;
+  ++applied_;
+  return true;
+}
+
+void CachedLabel::set_markup(const Glib::ustring& markup) {
+  if (changed(markup_hash_, hashOf(markup, true))) {
+    Gtk::Label::set_markup(markup);
+  }
+}
+
+void CachedLabel::set_text(const Glib::ustring& text) {
+  if (changed(markup_hash_, hashOf(text, false))) {
+    Gtk::Label::set_text(text);
+  }
+}
+
+void CachedLabel::set_label(const Glib::ustring& label) {
+  // Interpreted according to use-markup, don't assume either
+  markup_hash_.reset();
+  Gtk::Label::set_label(label);
+}
+
+void CachedLabel::set_tooltip_text(const Glib::ustring& text) {
+  if (changed(tooltip_hash_, hashOf(text, false))) {
+    Gtk::Label::set_tooltip_text(text);
+  }
+}
+
+void CachedLabel::set_tooltip_markup(const Glib::ustring& markup) {
+  if (changed(tooltip_hash_, hashOf(markup, true))) {
+    Gtk::Label::set_tooltip_markup(markup);
+  }
+}
+
+void CachedLabel::set_has_tooltip(bool has_tooltip) {
+  // set_tooltip_*() turns the tooltip back on, the next one must not be skipped
+  tooltip_hash_.reset();
+  Gtk::Label::set_has_tooltip(has_tooltip);
+}
+
+std::pair<uint64_t, uint64_t> CachedLabel::takeStats() {
+  return {std::exchange(applied_, 0), std::exchange(skipped_, 0)};
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,55 @@
+#include "util/debouncer.hpp"
+
+#include <algorithm>
+
+namespace waybar::util {
+
+Debouncer::Debouncer(std::chrono::milliseconds delay, std::chrono::milliseconds max_latency,
+                     std::function<void()> callback)
+    : delay_{delay},
+      max_latency_{std::max(max_latency, delay)},
+      callback_{std::move(callback)},
+      // Only runs when woken up, the run at registration finds nothing pending
+      task_{std::chrono::milliseconds::max(), [this] { run(); }} {}
+
+void Debouncer::trigger() {
+  auto now = Scheduler::Clock::now();
+  std::lock_guard lock(mutex_);
+  if (stopped_) {
+    return;
+  }
+  ++triggers_;
+  if (!pending_) {
+    pending_ = true;
+    first_trigger_ = now;
+  }
+  task_.wake_up_at(std::min(now + delay_, first_trigger_ + max_latency_));
+}
+
+void Debouncer::stop() {
+  {
+    std::lock_guard lock(mutex_);
+    stopped_ = true;
+  }
+  // Not under mutex_, a running callback may be waiting for it
+  task_.stop();
+}
+
+std::pair<uint64_t, uint64_t> Debouncer::takeStats() {
+  std::lock_guard lock(mutex_);
+  return {std::exchange(triggers_, 0), std::exchange(runs_, 0)};
+}
+
+void Debouncer::run() {
+  {
+    std::lock_guard lock(mutex_);
+    if (!pending_ || stopped_) {
+      return;
+    }
+    pending_ = false;
+    ++runs_;
+  }
+  callback_();
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,320 @@
+#include "util/exec_helper.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace waybar::util {
+
+namespace {
+
+enum RequestFlags : uint32_t {
+  DIRECT = 1 << 0,
+  DIE_WITH_PARENT = 1 << 1,
+};
+
+// Followed by the output name and the command, the child's stdout is passed as SCM_RIGHTS
+struct Request {
+  uint64_t id;
+  uint32_t flags;
+  uint32_t output_name_size;
+};
+
+struct Reply {
+  // Id of the request, 0 when a child exited
+  uint64_t id;
+  int32_t pid;
+  // errno when the spawn failed, waitpid() status when the child exited
+  int32_t status;
+};
+
+constexpr size_t MAX_REQUEST = 64 * 1024;
+
+ExecHelper* instance = nullptr;
+
+// Helper process only
+std::array<int, 2> sigchld_fds = {-1, -1};
+
+void notifySigchld(int /*signum*/) {
+  int saved = errno;
+  char c = 0;
+  (void)::write(sigchld_fds[1], &c, 1);
+  errno = saved;
+}
+
+void dropSignal(int /*signum*/) {}
+
+bool sendReply(int fd, const Reply& reply) {
+  return ::send(fd, &reply, sizeof(reply), MSG_NOSIGNAL) == sizeof(reply);
+}
+
+void handleRequest(int fd, std::string_view message, int stdout_fd) {
+  Request request{};
+  if (message.size() < sizeof(request)) {
+    return;
+  }
+  std::memcpy(&request, message.data(), sizeof(request));
+  message.remove_prefix(sizeof(request));
+  if (request.output_name_size > message.size()) {
+    sendReply(fd, {request.id, -1, EINVAL});
+    return;
+  }
+  SpawnOptions options{.stdout_fd = stdout_fd,
+                       .output_name = std::string(message.substr(0, request.output_name_size)),
+                       .die_with_parent = (request.flags & DIE_WITH_PARENT) != 0,
+                       .direct = (request.flags & DIRECT) != 0};
+  message.remove_prefix(request.output_name_size);
+  pid_t pid = util::spawn(std::string(message), options);
+  int error = pid == -1 ? errno : 0;
+  // Before replying, waybar expects its pipe to only be open in the child
+  if (stdout_fd != -1) {
+    ::close(stdout_fd);
+  }
+  sendReply(fd, {request.id, pid, error});
+}
+
+[[noreturn]] void helperMain(int fd) {
+#ifdef __linux__
+  // Tells it apart from waybar in process listings. `pkill waybar` still matches it, the signal
+  // handlers below are what keep it alive.
+  prctl(PR_SET_NAME, "waybar-exec");
+#endif
+  // The signals sent to waybar by name may reach the helper too. Handled rather than ignored, as
+  // ignored signals would stay ignored in the children.
+  struct sigaction action = {};
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  action.sa_handler = dropSignal;
+  for (int sig : {SIGINT, SIGUSR1, SIGUSR2}) {
+    sigaction(sig, &action, nullptr);
+  }
+  for (int sig = SIGRTMIN + 1; sig <= SIGRTMAX; ++sig) {
+    sigaction(sig, &action, nullptr);
+  }
+  if (::pipe2(sigchld_fds.data(), O_CLOEXEC | O_NONBLOCK) == -1) {
+    _exit(1);
+  }
+  action.sa_handler = notifySigchld;
+  action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  sigaction(SIGCHLD, &action, nullptr);
+
+  std::vector<char> buffer(MAX_REQUEST);
+  std::array<pollfd, 2> fds = {{{fd, POLLIN, 0}, {sigchld_fds[0], POLLIN, 0}}};
+  while (true) {
+    if (::poll(fds.data(), fds.size(), -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if ((fds[1].revents & POLLIN) != 0) {
+      std::array<char, 64> drain;
+      while (::read(sigchld_fds[0], drain.data(), drain.size()) > 0) {
+      }
+      int status;
+      pid_t pid;
+      while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        sendReply(fd, {0, pid, status});
+      }
+    }
+    if (fds[0].revents == 0) {
+      continue;
+    }
+    iovec iov = {buffer.data(), buffer.size()};
+    alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int))> control;
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    ssize_t size = ::recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    if (size == -1 && errno == EINTR) {
+      continue;
+    }
+    if (size <= 0) {
+      // Waybar exited, the children it waits for get SIGTERM with the helper
+      break;
+    }
+    int stdout_fd = -1;
+    for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        std::memcpy(&stdout_fd, CMSG_DATA(cmsg), sizeof(stdout_fd));
+      }
+    }
+    handleRequest(fd, std::string_view(buffer.data(), size), stdout_fd);
+  }
+  _exit(0);
+}
+
+}  // namespace
+
+void ExecHelper::start() {
+  if (instance != nullptr) {
+    return;
+  }
+  std::array<int, 2> fds;
+  if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds.data()) == -1) {
+    spdlog::warn("Can't start the exec helper: {}", strerror(errno));
+    return;
+  }
+  pid_t pid = ::fork();
+  if (pid == -1) {
+    spdlog::warn("Can't start the exec helper: {}", strerror(errno));
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return;
+  }
+  if (pid == 0) {
+    ::close(fds[0]);
+    helperMain(fds[1]);
+  }
+  ::close(fds[1]);
+  instance = new ExecHelper(fds[0], pid);
+}
+
+ExecHelper* ExecHelper::get() {
+  return instance != nullptr && instance->alive_ ? instance : nullptr;
+}
+
+ExecHelper::ExecHelper(int fd, pid_t pid)
+    : fd_{fd}, pid_{pid}, reader_{[this] { readReplies(); }} {}
+
+pid_t ExecHelper::spawn(const std::string& cmd, const SpawnOptions& options) {
+  Request request{.id = 0,
+                  .flags = (options.direct ? DIRECT : 0u) |
+                           (options.die_with_parent ? DIE_WITH_PARENT : 0u),
+                  .output_name_size = static_cast<uint32_t>(options.output_name.size())};
+  if (sizeof(request) + options.output_name.size() + cmd.size() > MAX_REQUEST) {
+    errno = E2BIG;
+    return -1;
+  }
+
+  std::unique_lock lock(mutex_);
+  if (!alive_) {
+    errno = EPIPE;
+    return -1;
+  }
+  request.id = next_id_++;
+  // References to unordered_map elements stay valid
+  auto& spawned = requests_.emplace(request.id, Spawned{options.pidfd}).first->second;
+  // The reader thread needs the lock to make room in the socket if the helper's replies fill it
+  lock.unlock();
+
+  std::array<iovec, 3> iov = {{{&request, sizeof(request)},
+                               {const_cast<char*>(options.output_name.data()),
+                                options.output_name.size()},
+                               {const_cast<char*>(cmd.data()), cmd.size()}}};
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int))> control = {};
+  msghdr msg = {};
+  msg.msg_iov = iov.data();
+  msg.msg_iovlen = iov.size();
+  if (options.stdout_fd != -1) {
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    auto* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &options.stdout_fd, sizeof(int));
+  }
+  ssize_t sent;
+  do {
+    sent = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+  } while (sent == -1 && errno == EINTR);
+  int error = errno;
+
+  lock.lock();
+  if (sent == -1) {
+    requests_.erase(request.id);
+    errno = error == ECONNRESET ? EPIPE : error;
+    return -1;
+  }
+  cv_.wait(lock, [&] { return spawned.pid.has_value() || !alive_; });
+  auto result = spawned;
+  requests_.erase(request.id);
+  if (!result.pid) {
+    errno = EPIPE;
+    return -1;
+  }
+  if (*result.pid == -1) {
+    errno = result.error;
+    return -1;
+  }
+  return *result.pid;
+}
+
+std::optional<int> ExecHelper::wait(pid_t pid) {
+  std::unique_lock lock(mutex_);
+  if (!running_.contains(pid) && !statuses_.contains(pid)) {
+    return std::nullopt;
+  }
+  cv_.wait(lock, [&] { return !running_.contains(pid); });
+  auto it = statuses_.find(pid);
+  if (it == statuses_.end()) {
+    // Not spawned to be waited for, or lost with the helper
+    errno = ECHILD;
+    return -1;
+  }
+  int status = it->second;
+  statuses_.erase(it);
+  return status;
+}
+
+bool ExecHelper::running(pid_t pid) {
+  std::lock_guard lock(mutex_);
+  return running_.contains(pid);
+}
+
+void ExecHelper::readReplies() {
+  while (true) {
+    Reply reply;
+    ssize_t size = ::recv(fd_, &reply, sizeof(reply), 0);
+    if (size == -1 && errno == EINTR) {
+      continue;
+    }
+    if (size != sizeof(reply)) {
+      break;
+    }
+    std::lock_guard lock(mutex_);
+    if (reply.id == 0) {
+      running_.erase(reply.pid);
+      if (waitable_.erase(reply.pid) != 0) {
+        statuses_[reply.pid] = reply.status;
+      }
+    } else if (auto it = requests_.find(reply.id); it != requests_.end()) {
+      // Always received before the exit status of the same child
+      it->second.pid = reply.pid;
+      it->second.error = reply.status;
+      if (reply.pid > 0) {
+        running_.insert(reply.pid);
+        if (it->second.waitable) {
+          waitable_.insert(reply.pid);
+        }
+      }
+    }
+    cv_.notify_all();
+  }
+
+  spdlog::error("Exec helper exited, spawning commands from waybar");
+  ::waitpid(pid_, nullptr, 0);
+  std::lock_guard lock(mutex_);
+  alive_ = false;
+  running_.clear();
+  waitable_.clear();
+  cv_.notify_all();
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,147 @@
+#include "util/format_template.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+namespace waybar::util {
+
+namespace {
+
+bool isIdentifierChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+// Every identifier following an opening brace, nested ones included
+std::vector<std::string> referencedNames(std::string_view format) {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < format.size(); ++i) {
+    if (format[i] != '{') {
+      continue;
+    }
+    if (i + 1 < format.size() && format[i + 1] == '{') {
+      ++i;
+      continue;
+    }
+    auto end = i + 1;
+    while (end < format.size() && isIdentifierChar(format[end])) {
+      ++end;
+    }
+    if (end > i + 1 && !std::isdigit(static_cast<unsigned char>(format[i + 1]))) {
+      names.emplace_back(format.substr(i + 1, end - i - 1));
+    }
+  }
+  std::sort(names.begin(), names.end());
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+  return names;
+}
+
+// Whether a field is automatically or manually indexed, nested ones included
+bool referencesPositional(std::string_view format) {
+  for (size_t i = 0; i + 1 < format.size(); ++i) {
+    if (format[i] != '{') {
+      continue;
+    }
+    auto next = format[i + 1];
+    if (next == '{') {
+      ++i;
+    } else if (next == '}' || next == ':' || std::isdigit(static_cast<unsigned char>(next))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+FormatTemplate::FormatTemplate(std::string format)
+    : format_{std::move(format)},
+      names_{referencedNames(format_)},
+      positional_{referencesPositional(format_)} {
+  std::string literal;
+  int next_index = 0;
+  bool automatic = false;
+  bool manual = false;
+  size_t i = 0;
+  while (i < format_.size()) {
+    auto c = format_[i];
+    if (c == '}') {
+      if (i + 1 < format_.size() && format_[i + 1] == '}') {
+        literal += '}';
+        i += 2;
+        continue;
+      }
+      passthrough_ = true;
+      return;
+    }
+    if (c != '{') {
+      literal += c;
+      ++i;
+      continue;
+    }
+    if (i + 1 < format_.size() && format_[i + 1] == '{') {
+      literal += '{';
+      i += 2;
+      continue;
+    }
+    auto close = format_.find('}', i);
+    auto nested = format_.find('{', i + 1);
+    if (close == std::string::npos || nested < close) {
+      passthrough_ = true;
+      return;
+    }
+    std::string_view field{format_.data() + i + 1, close - i - 1};
+    auto colon = field.find(':');
+    auto id = field.substr(0, colon);
+
+    Field parsed;
+    parsed.literal = std::move(literal);
+    literal.clear();
+    if (id.empty()) {
+      automatic = true;
+      parsed.index = next_index++;
+    } else if (std::all_of(id.begin(), id.end(),
+                           [](unsigned char d) { return std::isdigit(d); })) {
+      manual = true;
+      parsed.index = std::stoi(std::string(id));
+    } else {
+      parsed.name = id;
+    }
+    if (automatic && manual) {
+      passthrough_ = true;
+      return;
+    }
+    parsed.spec =
+        colon == std::string_view::npos ? "{}" : fmt::format("{{{}}}", field.substr(colon));
+    fields_.push_back(std::move(parsed));
+    i = close + 1;
+  }
+  trailing_ = std::move(literal);
+}
+
+bool FormatTemplate::uses(std::string_view name) const {
+  return std::binary_search(names_.begin(), names_.end(), name);
+}
+
+bool FormatTemplate::usesPrefix(std::string_view prefix) const {
+  auto it = std::lower_bound(names_.begin(), names_.end(), prefix);
+  return it != names_.end() && it->starts_with(prefix);
+}
+
+std::string FormatTemplate::vformat(fmt::format_args args) const {
+  if (passthrough_) {
+    return fmt::vformat(format_, args);
+  }
+  fmt::memory_buffer buffer;
+  auto out = std::back_inserter(buffer);
+  for (const auto& field : fields_) {
+    buffer.append(field.literal.data(), field.literal.data() + field.literal.size());
+    auto arg = field.name.empty() ? args.get(field.index) : args.get(fmt::string_view(field.name));
+    if (!arg) {
+      throw fmt::format_error("argument not found");
+    }
+    fmt::vformat_to(out, field.spec, fmt::format_args(&arg, 1));
+  }
+  buffer.append(trailing_.data(), trailing_.data() + trailing_.size());
+  return fmt::to_string(buffer);
+}
+
+}  // namespace waybar::util
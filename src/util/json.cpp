@@ -0,0 +1,407 @@
+#include "util/json.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace waybar::util {
+
+namespace {
+
+// Some compositors send "\x" escape sequences, which JSON doesn't allow: replaces them with "\u00".
+// Only escapes are rewritten (an escaped backslash followed by an x is left alone), and the
+// payload is only copied if it has any.
+std::optional<std::string> replaceHexadecimalEscape(std::string_view json) {
+  std::optional<std::string> fixed;
+  size_t copied = 0;
+  for (size_t i = json.find('\\'); i < json.size(); i = json.find('\\', i)) {
+    if (i + 1 < json.size() && json[i + 1] == 'x') {
+      if (!fixed) {
+        fixed.emplace();
+        fixed->reserve(json.size() + 16);
+      }
+      fixed->append(json.substr(copied, i - copied));
+      fixed->append("\\u00");
+      copied = i + 2;
+    }
+    i += 2;
+  }
+  if (fixed) {
+    fixed->append(json.substr(copied));
+  }
+  return fixed;
+}
+
+void appendUtf8(std::string& out, uint32_t codepoint) {
+  if (codepoint < 0x80) {
+    out += static_cast<char>(codepoint);
+  } else if (codepoint < 0x800) {
+    out += static_cast<char>(0xC0 | (codepoint >> 6));
+    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+  } else if (codepoint < 0x10000) {
+    out += static_cast<char>(0xE0 | (codepoint >> 12));
+    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (codepoint >> 18));
+    out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+  }
+}
+
+// Recursive descent parser building only the members in `keys`
+class SelectiveReader {
+ public:
+  SelectiveReader(std::string_view json, const JsonParser::Keys& keys)
+      : pos_{json.data()}, end_{json.data() + json.size()}, keys_{keys} {}
+
+  Json::Value document() {
+    auto root = value(0);
+    skipBlanks();
+    if (pos_ != end_) {
+      fail("trailing characters");
+    }
+    return root;
+  }
+
+ private:
+  // Same as jsoncpp's default stackLimit
+  static constexpr int MAX_DEPTH = 1000;
+
+  [[noreturn]] void fail(const char* what) const {
+    throw std::runtime_error(std::string("Error parsing JSON: ") + what);
+  }
+
+  void skipBlanks() {
+    while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r' || *pos_ == '\t')) {
+      ++pos_;
+    }
+  }
+
+  char peek() {
+    skipBlanks();
+    if (pos_ == end_) {
+      fail("unexpected end of input");
+    }
+    return *pos_;
+  }
+
+  void expect(char c) {
+    if (peek() != c) {
+      fail("unexpected character");
+    }
+    ++pos_;
+  }
+
+  void literal(std::string_view word) {
+    if (static_cast<size_t>(end_ - pos_) < word.size() ||
+        std::string_view(pos_, word.size()) != word) {
+      fail("invalid literal");
+    }
+    pos_ += word.size();
+  }
+
+  Json::Value value(int depth) {
+    if (depth > MAX_DEPTH) {
+      fail("too deeply nested");
+    }
+    switch (peek()) {
+      case '{':
+        return object(depth);
+      case '[':
+        return array(depth);
+      case '"':
+        return string();
+      case 't':
+        literal("true");
+        return true;
+      case 'f':
+        literal("false");
+        return false;
+      case 'n':
+        literal("null");
+        return {};
+      default:
+        return number();
+    }
+  }
+
+  Json::Value object(int depth) {
+    Json::Value object{Json::objectValue};
+    expect('{');
+    if (peek() == '}') {
+      ++pos_;
+      return object;
+    }
+    std::string escaped;
+    while (true) {
+      auto key = this->key(escaped);
+      expect(':');
+      if (keys_.contains(key)) {
+        object[std::string(key)] = value(depth + 1);
+      } else {
+        skip(depth + 1);
+      }
+      if (peek() == ',') {
+        ++pos_;
+        continue;
+      }
+      expect('}');
+      return object;
+    }
+  }
+
+  Json::Value array(int depth) {
+    Json::Value array{Json::arrayValue};
+    expect('[');
+    if (peek() == ']') {
+      ++pos_;
+      return array;
+    }
+    while (true) {
+      array.append(value(depth + 1));
+      if (peek() == ',') {
+        ++pos_;
+        continue;
+      }
+      expect(']');
+      return array;
+    }
+  }
+
+  // Points in the input unless the key has escape sequences
+  std::string_view key(std::string& escaped) {
+    expect('"');
+    auto begin = pos_;
+    while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\') {
+      ++pos_;
+    }
+    if (pos_ == end_) {
+      fail("unterminated string");
+    }
+    if (*pos_ == '"') {
+      return {begin, static_cast<size_t>(pos_++ - begin)};
+    }
+    pos_ = begin - 1;
+    escaped = string().asString();
+    return escaped;
+  }
+
+  Json::Value string() {
+    expect('"');
+    std::string out;
+    while (true) {
+      auto begin = pos_;
+      while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\') {
+        ++pos_;
+      }
+      out.append(begin, pos_);
+      if (pos_ == end_) {
+        fail("unterminated string");
+      }
+      if (*pos_++ == '"') {
+        return out;
+      }
+      if (pos_ == end_) {
+        fail("unterminated string");
+      }
+      switch (*pos_++) {
+        case '"':
+          out += '"';
+          break;
+        case '\\':
+          out += '\\';
+          break;
+        case '/':
+          out += '/';
+          break;
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        case 'x':
+          appendUtf8(out, hex(2));
+          break;
+        case 'u': {
+          auto codepoint = hex(4);
+          if (codepoint >= 0xDC00 && codepoint < 0xE000) {
+            fail("invalid unicode surrogate pair");
+          }
+          if (codepoint >= 0xD800 && codepoint < 0xDC00) {
+            // Half of a pair, the other half must follow
+            if (end_ - pos_ < 6 || pos_[0] != '\\' || pos_[1] != 'u') {
+              fail("invalid unicode surrogate pair");
+            }
+            pos_ += 2;
+            auto low = hex(4);
+            if (low < 0xDC00 || low >= 0xE000) {
+              fail("invalid unicode surrogate pair");
+            }
+            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+          }
+          appendUtf8(out, codepoint);
+          break;
+        }
+        default:
+          fail("invalid escape sequence");
+      }
+    }
+  }
+
+  uint32_t hex(int digits) {
+    if (end_ - pos_ < digits) {
+      fail("invalid escape sequence");
+    }
+    uint32_t value = 0;
+    auto [ptr, ec] = std::from_chars(pos_, pos_ + digits, value, 16);
+    if (ec != std::errc() || ptr != pos_ + digits) {
+      fail("invalid escape sequence");
+    }
+    pos_ = ptr;
+    return value;
+  }
+
+  Json::Value number() {
+    auto begin = pos_;
+    bool integer = true;
+    if (pos_ != end_ && *pos_ == '-') {
+      ++pos_;
+    }
+    while (pos_ != end_ && ((*pos_ >= '0' && *pos_ <= '9') || *pos_ == '.' || *pos_ == 'e' ||
+                            *pos_ == 'E' || *pos_ == '+' || *pos_ == '-')) {
+      integer = integer && *pos_ >= '0' && *pos_ <= '9';
+      ++pos_;
+    }
+    if (integer) {
+      // Same types as jsoncpp: signed unless too large for it
+      Json::Int64 value;
+      if (auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc() && ptr == pos_) {
+        return value;
+      }
+      Json::UInt64 unsignedValue;
+      if (auto [ptr, ec] = std::from_chars(begin, pos_, unsignedValue);
+          ec == std::errc() && ptr == pos_) {
+        return unsignedValue;
+      }
+    }
+    double value;
+    auto [ptr, ec] = std::from_chars(begin, pos_, value);
+    if (begin == pos_ || ec != std::errc() || ptr != pos_) {
+      fail("invalid number");
+    }
+    return value;
+  }
+
+  // Validates a value without building it
+  void skip(int depth) {
+    if (depth > MAX_DEPTH) {
+      fail("too deeply nested");
+    }
+    switch (peek()) {
+      case '{': {
+        expect('{');
+        if (peek() == '}') {
+          ++pos_;
+          return;
+        }
+        while (true) {
+          skipString();
+          expect(':');
+          skip(depth + 1);
+          if (peek() == ',') {
+            ++pos_;
+            continue;
+          }
+          expect('}');
+          return;
+        }
+      }
+      case '[': {
+        expect('[');
+        if (peek() == ']') {
+          ++pos_;
+          return;
+        }
+        while (true) {
+          skip(depth + 1);
+          if (peek() == ',') {
+            ++pos_;
+            continue;
+          }
+          expect(']');
+          return;
+        }
+      }
+      case '"':
+        skipString();
+        return;
+      case 't':
+        literal("true");
+        return;
+      case 'f':
+        literal("false");
+        return;
+      case 'n':
+        literal("null");
+        return;
+      default:
+        number();
+    }
+  }
+
+  void skipString() {
+    expect('"');
+    while (pos_ < end_ && *pos_ != '"') {
+      if (*pos_ == '\\' && end_ - pos_ < 2) {
+        break;
+      }
+      pos_ += *pos_ == '\\' ? 2 : 1;
+    }
+    if (pos_ >= end_) {
+      fail("unterminated string");
+    }
+    ++pos_;
+  }
+
+  const char* pos_;
+  const char* end_;
+  const JsonParser::Keys& keys_;
+};
+
+}  // namespace
+
+Json::Value JsonParser::parse(std::string_view json) const {
+  Json::Value root;
+  auto fixed = replaceHexadecimalEscape(json);
+  if (fixed) {
+    json = *fixed;
+  }
+
+  std::unique_ptr<Json::CharReader> reader(m_readerBuilder.newCharReader());
+  std::string errs;
+  if (!reader->parse(json.data(), json.data() + json.size(), &root, &errs)) {
+    throw std::runtime_error("Error parsing JSON: " + errs);
+  }
+  return root;
+}
+
+Json::Value JsonParser::parse(std::string_view json, const Keys& keys) const {
+  return SelectiveReader(json, keys).document();
+}
+
+}  // namespace waybar::util
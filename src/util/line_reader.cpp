@@ -0,0 +1,183 @@
+#include "util/line_reader.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace waybar::util {
+
+struct LineReader::Stream {
+  Stream(int fd, LineCallback on_line, EndCallback on_end)
+      : fd{fd}, on_line{std::move(on_line)}, on_end{std::move(on_end)} {}
+  Stream(const Stream&) = delete;
+  Stream& operator=(const Stream&) = delete;
+  ~Stream() { ::close(fd); }
+
+  const int fd;
+  LineCallback on_line;
+  EndCallback on_end;
+  // Start of a line that isn't complete yet
+  std::string buffer;
+  bool removed = false;
+};
+
+LineReader& LineReader::inst() {
+  static auto* inst = new LineReader();
+  return *inst;
+}
+
+LineReader::LineReader() {
+  if (::pipe2(wake_fds_.data(), O_CLOEXEC | O_NONBLOCK) == -1) {
+    throw std::runtime_error(std::string("Can't create the line reader pipe: ") + strerror(errno));
+  }
+  thread_ = std::thread([this] { readLoop(); });
+}
+
+LineReader::Id LineReader::add(int fd, LineCallback on_line, EndCallback on_end) {
+  int flags = ::fcntl(fd, F_GETFL);
+  if (flags != -1) {
+    ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  }
+  std::lock_guard lock(mutex_);
+  auto id = next_id_++;
+  streams_.emplace(id, std::make_shared<Stream>(fd, std::move(on_line), std::move(on_end)));
+  wake();
+  return id;
+}
+
+void LineReader::remove(Id id) {
+  // Closes the fd once the reader thread doesn't use it anymore
+  std::shared_ptr<Stream> removed;
+  std::unique_lock lock(mutex_);
+  if (std::this_thread::get_id() != thread_.get_id()) {
+    done_cv_.wait(lock, [&] { return running_ != id; });
+  }
+  auto it = streams_.find(id);
+  if (it == streams_.end()) {
+    return;
+  }
+  removed = std::move(it->second);
+  removed->removed = true;
+  streams_.erase(it);
+  wake();
+}
+
+// Must be called with mutex_ held
+void LineReader::wake() {
+  char c = 0;
+  (void)::write(wake_fds_[1], &c, 1);
+}
+
+void LineReader::readLoop() {
+  std::vector<pollfd> fds;
+  std::vector<Id> ids;  // Stream of each fd
+  while (true) {
+    {
+      std::lock_guard lock(mutex_);
+      fds.assign(1, {wake_fds_[0], POLLIN, 0});
+      ids.assign(1, 0);
+      for (const auto& [id, stream] : streams_) {
+        fds.push_back({stream->fd, POLLIN, 0});
+        ids.push_back(id);
+      }
+    }
+
+    if (::poll(fds.data(), fds.size(), -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      spdlog::error("Line reader: poll failed: {}", strerror(errno));
+      return;
+    }
+    if ((fds[0].revents & POLLIN) != 0) {
+      std::array<char, 64> drain;
+      while (::read(wake_fds_[0], drain.data(), drain.size()) > 0) {
+      }
+    }
+    for (size_t i = 1; i < fds.size(); ++i) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      std::shared_ptr<Stream> stream;
+      {
+        std::lock_guard lock(mutex_);
+        // Removed since, its fd may already be reused
+        auto it = streams_.find(ids[i]);
+        if (it == streams_.end()) {
+          continue;
+        }
+        stream = it->second;
+        running_ = ids[i];
+      }
+      read(ids[i], *stream);
+      // So that the fd is closed once remove() returns
+      stream.reset();
+      {
+        std::lock_guard lock(mutex_);
+        running_ = 0;
+      }
+      done_cv_.notify_all();
+    }
+  }
+}
+
+void LineReader::read(Id id, Stream& stream) {
+  // One read per poll(), so that a chatty command doesn't hold up the others
+  std::array<char, 4096> chunk;
+  ssize_t size = ::read(stream.fd, chunk.data(), chunk.size());
+  int error = errno;
+  if (size == -1 && (error == EAGAIN || error == EWOULDBLOCK || error == EINTR)) {
+    return;
+  }
+  bool ended = size <= 0;
+  if (size > 0) {
+    stream.buffer.append(chunk.data(), size);
+  }
+
+  // The callbacks may remove the stream
+  size_t start = 0;
+  while (!stream.removed) {
+    auto end = stream.buffer.find('\n', start);
+    if (end == std::string::npos) {
+      // Like getline(), the last line doesn't need a newline
+      if (!ended || start >= stream.buffer.size()) {
+        break;
+      }
+      end = stream.buffer.size();
+    }
+    try {
+      stream.on_line(std::string_view(stream.buffer).substr(start, end - start));
+    } catch (const std::exception& e) {
+      spdlog::error("Line reader callback failed: {}", e.what());
+    }
+    start = end + 1;
+  }
+  stream.buffer.erase(0, std::min(start, stream.buffer.size()));
+
+  if (!ended || stream.removed) {
+    return;
+  }
+  if (size == -1) {
+    spdlog::warn("Line reader: read failed: {}", strerror(error));
+  }
+  try {
+    stream.on_end();
+  } catch (const std::exception& e) {
+    spdlog::error("Line reader callback failed: {}", e.what());
+  }
+  std::lock_guard lock(mutex_);
+  if (!stream.removed) {
+    stream.removed = true;
+    streams_.erase(id);
+  }
+}
+
+}  // namespace waybar::util
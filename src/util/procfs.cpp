@@ -0,0 +1,86 @@
+#include "util/procfs.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+namespace waybar::util::procfs {
+
+File::File(std::string path) : path_{std::move(path)} {}
+
+File::~File() {
+  if (fd_ != -1) {
+    ::close(fd_);
+  }
+}
+
+std::optional<std::string_view> File::read() {
+  if (fd_ == -1) {
+    fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ == -1) {
+      return std::nullopt;
+    }
+  }
+  // Most of these files don't report a size, read until EOF
+  size_t len = 0;
+  while (true) {
+    if (len == buffer_.size()) {
+      buffer_.resize(buffer_.empty() ? 4096 : buffer_.size() * 2);
+    }
+    auto n = ::pread(fd_, buffer_.data() + len, buffer_.size() - len, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // The file may be gone (e.g. unplugged device), reopen it on the next read
+      ::close(fd_);
+      fd_ = -1;
+      return std::nullopt;
+    }
+    if (n == 0) {
+      break;
+    }
+    len += n;
+  }
+  return std::string_view{buffer_.data(), len};
+}
+
+std::optional<std::pair<uint64_t, uint64_t>> netDevBytes(std::string_view content,
+                                                         std::string_view ifname) {
+  std::string_view line;
+  while (nextLine(content, line)) {
+    // "  eth0: 1234 ..." the counters may directly follow the colon
+    auto delim = line.find(':');
+    if (delim == std::string_view::npos) {
+      // Header lines
+      continue;
+    }
+    auto name = line.substr(0, delim);
+    skipBlanks(name);
+    if (name != ifname) {
+      continue;
+    }
+    // Each direction has 8 columns: bytes packets errs drop fifo frame compressed multicast,
+    // transmitted bytes are the first column of the second group
+    auto counters = line.substr(delim + 1);
+    uint64_t received;
+    uint64_t transmitted;
+    uint64_t skipped;
+    if (!nextNumber(counters, received)) {
+      return std::nullopt;
+    }
+    for (int column = 1; column < 8; ++column) {
+      if (!nextNumber(counters, skipped)) {
+        return std::nullopt;
+      }
+    }
+    if (!nextNumber(counters, transmitted)) {
+      return std::nullopt;
+    }
+    return std::make_pair(received, transmitted);
+  }
+  return std::nullopt;
+}
+
+}  // namespace waybar::util::procfs
@@ -4,38 +4,141 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cctype>
 #include <utility>
 
 namespace waybar::util {
 
 int default_priority_function(std::string& key) { return 0; }
 
+std::optional<LiteralPattern> LiteralPattern::parse(std::string_view pattern) {
+  constexpr std::string_view special = "\\^$.|?*+()[]{}";
+  LiteralPattern literal;
+  literal.parts_.emplace_back();
+  if (pattern.starts_with('^')) {
+    literal.anchored_start_ = true;
+    pattern.remove_prefix(1);
+  }
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    auto c = pattern[i];
+    if (static_cast<unsigned char>(c) >= 0x80) {
+      // Case folding beyond ASCII is left to the regex
+      return std::nullopt;
+    }
+    if (c == '\\') {
+      // Only escaped punctuation is literal, "\d", "\b"... are classes and assertions
+      if (i + 1 == pattern.size() || special.find(pattern[i + 1]) == std::string_view::npos) {
+        return std::nullopt;
+      }
+      literal.parts_.back() += pattern[++i];
+    } else if (c == '.' && i + 1 < pattern.size() && pattern[i + 1] == '*') {
+      ++i;
+      // A lazy ".*?" matches the same strings
+      if (i + 1 < pattern.size() && pattern[i + 1] == '?') {
+        ++i;
+      }
+      literal.parts_.emplace_back();
+    } else if (c == '$' && i + 1 == pattern.size()) {
+      literal.anchored_end_ = true;
+    } else if (special.find(c) != std::string_view::npos) {
+      return std::nullopt;
+    } else {
+      literal.parts_.back() += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+  }
+  return literal;
+}
+
+bool LiteralPattern::matches(std::string_view value) const {
+  size_t pos = 0;
+  for (size_t i = 0; i < parts_.size(); ++i) {
+    const auto& part = parts_[i];
+    bool first = i == 0;
+    if (i + 1 == parts_.size() && anchored_end_) {
+      if (value.size() < pos + part.size() || !value.ends_with(part)) {
+        return false;
+      }
+      return !(first && anchored_start_) || value.size() == part.size();
+    }
+    if (first && anchored_start_) {
+      if (!value.starts_with(part)) {
+        return false;
+      }
+      pos = part.size();
+      continue;
+    }
+    auto found = value.find(part, pos);
+    if (found == std::string_view::npos) {
+      return false;
+    }
+    pos = found + part.size();
+  }
+  return true;
+}
+
+bool LiteralPattern::applicable(std::string_view value) {
+  return value.find_first_of("\r\n") == std::string_view::npos;
+}
+
+std::string LiteralPattern::lower(std::string_view value) {
+  std::string lowered(value);
+  for (auto& c : lowered) {
+    if (c >= 'A' && c <= 'Z') {
+      c = static_cast<char>(c - 'A' + 'a');
+    }
+  }
+  return lowered;
+}
+
 RegexCollection::RegexCollection(const Json::Value& map, std::string default_repr,
-                                 const std::function<int(std::string&)>& priority_function)
-    : default_repr(std::move(default_repr)) {
+                                 const std::function<int(std::string&)>& priority_function,
+                                 size_t cache_size)
+    : regex_cache(cache_size), default_repr(std::move(default_repr)) {
   if (!map.isObject()) {
     spdlog::warn("Mapping is not an object");
     return;
   }
 
+  size_t literals = 0;
   for (auto it = map.begin(); it != map.end(); ++it) {
     if (it.key().isString() && it->isString()) {
       std::string key = it.key().asString();
       int priority = priority_function(key);
       try {
         const std::regex rule{key, std::regex_constants::icase};
-        rules.emplace_back(rule, it->asString(), priority);
+        auto literal = LiteralPattern::parse(key);
+        literals += literal ? 1 : 0;
+        rules.emplace_back(rule, it->asString(), priority, std::move(literal));
       } catch (const std::regex_error& e) {
         spdlog::error("Invalid rule '{}': {}", key, e.what());
       }
     }
   }
 
-  std::sort(rules.begin(), rules.end(), [](Rule& a, Rule& b) { return a.priority > b.priority; });
+  // Stable, so that rules of the same priority keep the order of the config
+  std::stable_sort(rules.begin(), rules.end(),
+                   [](const Rule& a, const Rule& b) { return a.priority > b.priority; });
+  spdlog::debug("{} of {} rewrite rules matched without regex", literals, rules.size());
 }
 
 std::string RegexCollection::find_match(std::string& value, bool& matched_any) {
+  // Lowercased once for all the literal rules
+  std::optional<std::string> lowered;
+  bool literal_applicable = LiteralPattern::applicable(value);
   for (auto& rule : rules) {
+    if (rule.literal && literal_applicable) {
+      if (!lowered) {
+        lowered = LiteralPattern::lower(value);
+      }
+      if (!rule.literal->matches(*lowered)) {
+        continue;
+      }
+      // Without references to the match, the regex isn't needed to format it either
+      if (rule.repr.find('$') == std::string::npos) {
+        matched_any = true;
+        return rule.repr;
+      }
+    }
     std::smatch match;
     if (std::regex_search(value, match, rule.rule)) {
       matched_any = true;
@@ -47,22 +150,18 @@ std::string RegexCollection::find_match(std::string& value, bool& matched_any) {
 }
 
 std::string& RegexCollection::get(std::string& value, bool& matched_any) {
-  if (regex_cache.contains(value)) {
-    return regex_cache[value];
+  if (auto* cached = regex_cache.find(value)) {
+    matched_any = cached->matched_any;
+    return cached->repr;
   }
 
-  // std::string repr =
-  // waybar::util::find_match(value, window_rewrite_rules_, matched_any);
-
   std::string repr = find_match(value, matched_any);
 
   if (!matched_any) {
     repr = default_repr;
   }
 
-  regex_cache.emplace(value, repr);
-
-  return regex_cache[value];  // Necessary in order to return a reference to the heap
+  return regex_cache.insert(value, {std::move(repr), matched_any}).repr;
 }
 
 std::string& RegexCollection::get(std::string& value) {
@@ -2,31 +2,138 @@
 
 #include <spdlog/spdlog.h>
 
+#include <cctype>
 #include <regex>
+#include <string_view>
 
 namespace waybar::util {
-std::string rewriteString(const std::string& value, const Json::Value& rules) {
-  if (!rules.isObject()) {
-    return value;
+
+namespace {
+
+std::string lower(std::string_view value) {
+  std::string lowered(value);
+  for (auto& c : lowered) {
+    if (c >= 'A' && c <= 'Z') {
+      c = static_cast<char>(c - 'A' + 'a');
+    }
   }
+  return lowered;
+}
 
-  std::string res = value;
+// The longest ASCII text outside of groups and classes that the pattern can't match without,
+// lowercased. Empty when there's none or the pattern has alternatives.
+std::string requiredLiteral(std::string_view pattern) {
+  constexpr std::string_view special = "\\^$.|?*+()[]{}";
+  if (pattern.find('|') != std::string_view::npos) {
+    return {};
+  }
+  std::string longest;
+  std::string current;
+  auto flush = [&] {
+    if (current.size() > longest.size()) {
+      longest = current;
+    }
+    current.clear();
+  };
+  int depth = 0;
+  bool inClass = false;
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    auto c = pattern[i];
+    if (inClass) {
+      if (c == '\\') {
+        ++i;
+      } else if (c == ']') {
+        inClass = false;
+      }
+      continue;
+    }
+    bool escaped = c == '\\' && i + 1 < pattern.size() &&
+                   special.find(pattern[i + 1]) != std::string_view::npos;
+    if (c == '\\' && !escaped && i + 1 < pattern.size() &&
+        std::string_view("dDsSwWbB").find(pattern[i + 1]) == std::string_view::npos) {
+      // \xHH, \uHHHH, \cX, \0, backreferences... may stand for any text
+      return {};
+    }
+    if (escaped) {
+      c = pattern[++i];
+    } else if (c == '\\' || special.find(c) != std::string_view::npos ||
+               static_cast<unsigned char>(c) >= 0x80) {
+      // Classes, assertions, anchors, quantifiers... and case folding beyond ASCII
+      flush();
+      depth += c == '(' ? 1 : c == ')' ? -1 : 0;
+      inClass = c == '[';
+      i += c == '\\' ? 1 : 0;
+      continue;
+    }
+    if (depth > 0) {
+      continue;
+    }
+    auto next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+    if (next == '?' || next == '*' || next == '{') {
+      // Optional
+      flush();
+      continue;
+    }
+    current += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (next == '+') {
+      flush();
+    }
+  }
+  flush();
+  return longest;
+}
 
+}  // namespace
+
+std::string rewriteString(const std::string& value, const Json::Value& rules) {
+  // Compiles the rules on every call, modules rewriting on every update hold a RewriteRules
+  return RewriteRules(rules, 1).apply(value);
+}
+
+RewriteRules::RewriteRules(const Json::Value& rules, size_t cache_size) : cache_(cache_size) {
+  if (!rules.isObject()) {
+    return;
+  }
   for (auto it = rules.begin(); it != rules.end(); ++it) {
     if (it.key().isString() && it->isString()) {
       try {
-        // malformated regexes will cause an exception.
-        // in this case, log error and try the next rule.
-        const std::regex rule{it.key().asString(), std::regex_constants::icase};
-        if (std::regex_match(value, rule)) {
-          res = std::regex_replace(res, rule, it->asString());
-        }
+        rules_.push_back({std::regex{it.key().asString(), std::regex_constants::icase},
+                          it->asString(), requiredLiteral(it.key().asString())});
       } catch (const std::regex_error& e) {
+        // Skipped, the other rules still apply
         spdlog::error("Invalid rule {}: {}", it.key().asString(), e.what());
       }
     }
   }
+}
+
+std::string RewriteRules::apply(const std::string& value) {
+  if (rules_.empty()) {
+    return value;
+  }
+  if (auto* cached = cache_.find(value)) {
+    return *cached;
+  }
+  return cache_.insert(value, rewrite(value));
+}
 
+std::string RewriteRules::rewrite(const std::string& value) const {
+  std::string res = value;
+  auto lowered = lower(value);
+  for (const auto& rule : rules_) {
+    if (lowered.find(rule.required) == std::string::npos) {
+      continue;
+    }
+    try {
+      if (std::regex_match(value, rule.regex)) {
+        res = std::regex_replace(res, rule.regex, rule.replacement);
+      }
+    } catch (const std::regex_error& e) {
+      // e.g. exceeding the complexity limit on a long value
+      spdlog::error("Rewrite rule failed: {}", e.what());
+    }
+  }
   return res;
 }
+
 }  // namespace waybar::util
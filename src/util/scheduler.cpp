@@ -0,0 +1,235 @@
+#include "util/scheduler.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+#include "util/prepare_for_sleep.h"
+
+namespace waybar::util {
+
+Scheduler& Scheduler::inst() {
+  static auto* inst = [] {
+    // Callbacks only do light work (reading a few procfs/sysfs files, emitting a dispatcher),
+    // a couple of workers is enough to keep a slow one from delaying the others.
+    auto* scheduler = new Scheduler(std::clamp(std::thread::hardware_concurrency() / 2, 2U, 4U));
+    prepare_for_sleep().connect([scheduler](bool sleep) {
+      if (not sleep) scheduler->wakeUpAll();
+    });
+    return scheduler;
+  }();
+  return *inst;
+}
+
+Scheduler::Scheduler(size_t workers) {
+  timer_ = std::thread([this] { timerLoop(); });
+  for (size_t i = 0; i < workers; ++i) {
+    workers_.emplace_back([this] { workerLoop(); });
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard lock(mutex_);
+    do_run_ = false;
+  }
+  timer_cv_.notify_all();
+  worker_cv_.notify_all();
+  if (timer_.joinable()) {
+    timer_.join();
+  }
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+Scheduler::TaskId Scheduler::add(std::chrono::milliseconds interval, Callback cb, bool aligned) {
+  std::lock_guard lock(mutex_);
+  auto id = next_id_++;
+  auto& task = tasks_[id];
+  task.interval = interval;
+  task.callback = std::move(cb);
+  task.aligned = aligned;
+  schedule(id, task, Clock::now());
+  return id;
+}
+
+void Scheduler::remove(TaskId id) {
+  std::unique_lock lock(mutex_);
+  auto it = tasks_.find(id);
+  if (it == tasks_.end()) {
+    return;
+  }
+  if (!it->second.running) {
+    tasks_.erase(it);
+    return;
+  }
+  it->second.removed = true;
+  // Removing a task from its own callback: the worker erases it once the callback returns
+  if (it->second.runner == std::this_thread::get_id()) {
+    return;
+  }
+  done_cv_.wait(lock, [this, id] { return !tasks_.contains(id); });
+}
+
+void Scheduler::wakeUp(TaskId id) {
+  std::lock_guard lock(mutex_);
+  auto it = tasks_.find(id);
+  if (it == tasks_.end() || it->second.removed) {
+    return;
+  }
+  if (it->second.running) {
+    it->second.wake_pending = true;
+    it->second.wake_deadline = Clock::time_point::min();
+  } else {
+    schedule(id, it->second, Clock::now());
+  }
+}
+
+void Scheduler::wakeUpAt(TaskId id, Clock::time_point deadline) {
+  std::lock_guard lock(mutex_);
+  auto it = tasks_.find(id);
+  if (it == tasks_.end() || it->second.removed) {
+    return;
+  }
+  auto& task = it->second;
+  if (task.running) {
+    task.wake_deadline = task.wake_pending ? std::min(task.wake_deadline, deadline) : deadline;
+    task.wake_pending = true;
+  } else {
+    schedule(id, task, deadline);
+  }
+}
+
+void Scheduler::wakeUpAll() {
+  std::lock_guard lock(mutex_);
+  auto now = Clock::now();
+  for (auto& [id, task] : tasks_) {
+    if (task.running) {
+      task.wake_pending = true;
+      task.wake_deadline = Clock::time_point::min();
+    } else if (!task.removed) {
+      schedule(id, task, now);
+    }
+  }
+}
+
+// Must be called with mutex_ held
+void Scheduler::schedule(TaskId id, Task& task, Clock::time_point deadline) {
+  task.deadline = deadline;
+  if (deadline == Clock::time_point::max()) {
+    // "interval": "once", only a wakeUp() will run it again
+    return;
+  }
+  // Stale heap entries are not removed here, the timer thread skips them when their deadline
+  // doesn't match the task anymore
+  heap_.emplace(deadline, id);
+  timer_cv_.notify_one();
+}
+
+Scheduler::Clock::time_point Scheduler::nextDeadline(const Task& task) const {
+  auto now = Clock::now();
+  // Compare in milliseconds, converting milliseconds::max() to the clock's unit would overflow
+  if (task.interval >=
+      std::chrono::duration_cast<std::chrono::milliseconds>(Clock::time_point::max() - now)) {
+    return Clock::time_point::max();
+  }
+  if (!task.aligned) {
+    return now + task.interval;
+  }
+  // Round up to the next multiple of the interval on the wall clock: a 10s and a 30s task both
+  // fire at :00 and :30, leaving the CPU idle in between
+  auto since_tick = std::chrono::system_clock::now().time_since_epoch() % task.interval;
+  return now + (task.interval - since_tick);
+}
+
+// Must be called with mutex_ held
+void Scheduler::reportStats(Clock::time_point now) {
+  constexpr auto period = std::chrono::seconds(60);
+  auto elapsed = now - stats_since_;
+  if (elapsed < period) {
+    return;
+  }
+  auto seconds = std::chrono::duration<double>(elapsed).count();
+  spdlog::debug("scheduler: {:.2f} wakeups/s, {:.2f} task runs/s over the last {:.0f}s",
+                timer_wakeups_ / seconds, task_runs_ / seconds, seconds);
+  stats_since_ = now;
+  timer_wakeups_ = 0;
+  task_runs_ = 0;
+}
+
+void Scheduler::timerLoop() {
+  std::unique_lock lock(mutex_);
+  while (do_run_) {
+    if (heap_.empty()) {
+      timer_cv_.wait(lock);
+      continue;
+    }
+    auto [deadline, id] = heap_.top();
+    auto it = tasks_.find(id);
+    if (it == tasks_.end() || it->second.running || it->second.deadline != deadline) {
+      heap_.pop();
+      continue;
+    }
+    auto now = Clock::now();
+    if (deadline > now) {
+      timer_cv_.wait_until(lock, deadline);
+      ++timer_wakeups_;
+      continue;
+    }
+    heap_.pop();
+    it->second.running = true;
+    ++task_runs_;
+    ready_.push_back(id);
+    worker_cv_.notify_one();
+    reportStats(now);
+  }
+}
+
+void Scheduler::workerLoop() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    worker_cv_.wait(lock, [this] { return !do_run_ || !ready_.empty(); });
+    if (!do_run_) {
+      return;
+    }
+    auto id = ready_.front();
+    ready_.pop_front();
+    auto it = tasks_.find(id);
+    if (it == tasks_.end()) {
+      continue;
+    }
+    if (it->second.removed) {
+      tasks_.erase(it);
+      done_cv_.notify_all();
+      continue;
+    }
+    it->second.runner = std::this_thread::get_id();
+    // The task can't be erased while it is marked as running, so the callback stays valid
+    auto& callback = it->second.callback;
+    lock.unlock();
+    try {
+      callback();
+    } catch (const std::exception& e) {
+      spdlog::error("scheduler: task {} failed: {}", id, e.what());
+    }
+    lock.lock();
+
+    it = tasks_.find(id);
+    auto& task = it->second;
+    task.running = false;
+    task.runner = std::thread::id();
+    if (task.removed) {
+      tasks_.erase(it);
+      done_cv_.notify_all();
+    } else if (std::exchange(task.wake_pending, false)) {
+      schedule(id, task, std::max(task.wake_deadline, Clock::now()));
+    } else {
+      schedule(id, task, nextDeadline(task));
+    }
+  }
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,273 @@
+#include "util/sensor.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string_view>
+
+#include "util/procfs.hpp"
+#include "util/scheduler.hpp"
+
+namespace waybar::util {
+
+std::chrono::milliseconds AdaptiveInterval::next(int64_t value) {
+  auto interval = policy_.interval;
+  // "interval": "once" can't back off any further
+  if (!policy_.adaptive || interval > std::chrono::milliseconds::max() / MAX_BACKOFF) {
+    return interval;
+  }
+  if (policy_.critical && value >= *policy_.critical - policy_.margin) {
+    // Close to critical: don't miss the moment it is reached
+    settled_.reset();
+    stable_reads_ = 0;
+    return std::min(interval, std::max(interval / MAX_BACKOFF, MIN_INTERVAL));
+  }
+  // Compared to where the value settled, so a slow drift isn't taken as stable
+  if (settled_ && std::abs(value - *settled_) <= policy_.tolerance) {
+    ++stable_reads_;
+  } else {
+    settled_ = value;
+    stable_reads_ = 0;
+  }
+  return interval * std::min(1 << std::min(stable_reads_ / STABLE_READS, 8), MAX_BACKOFF);
+}
+
+struct SensorService::Sensor {
+  explicit Sensor(std::string path) : file{std::move(path)} {}
+
+  struct Subscriber {
+    Callback callback;
+    AdaptiveInterval interval;
+    bool aligned;
+    bool notified = false;
+  };
+
+  procfs::File file;
+  std::optional<int64_t> value;
+  bool failing = false;
+  std::map<Id, Subscriber> subscribers;
+  std::vector<int> alarm_fds;
+  // Last, so it is stopped before the rest is destroyed
+  ScheduledTask task;
+};
+
+SensorService& SensorService::inst() {
+  static auto* inst = new SensorService();
+  return *inst;
+}
+
+SensorService::SensorService() = default;
+
+SensorService::Id SensorService::subscribe(const std::string& path,
+                                           AdaptiveInterval::Policy policy, bool aligned,
+                                           Callback callback) {
+  std::lock_guard lock(mutex_);
+  auto id = next_id_++;
+  auto& sensor = sensors_[path];
+  bool created = !sensor;
+  if (created) {
+    sensor = std::make_unique<Sensor>(path);
+    watchAlarms(*sensor);
+  }
+  sensor->subscribers.emplace(id, Sensor::Subscriber{std::move(callback), AdaptiveInterval(policy),
+                                                     aligned});
+  paths_.emplace(id, path);
+  if (created) {
+    // Runs right away, then read() schedules the next run. It waits for the lock until the task
+    // is assigned.
+    sensor->task =
+        ScheduledTask(std::chrono::milliseconds::max(), [this, raw = sensor.get()] { read(*raw); });
+  } else {
+    // The new subscriber gets the current value from an immediate read
+    sensor->task.wake_up();
+  }
+  return id;
+}
+
+void SensorService::unsubscribe(Id id) {
+  std::unique_ptr<Sensor> removed;
+  {
+    std::lock_guard lock(mutex_);
+    auto path = paths_.find(id);
+    if (path == paths_.end()) {
+      return;
+    }
+    auto it = sensors_.find(path->second);
+    paths_.erase(path);
+    it->second->subscribers.erase(id);
+    if (!it->second->subscribers.empty()) {
+      return;
+    }
+    removed = std::move(it->second);
+    sensors_.erase(it);
+    if (!removed->alarm_fds.empty()) {
+      retired_fds_.insert(retired_fds_.end(), removed->alarm_fds.begin(),
+                          removed->alarm_fds.end());
+      removed->alarm_fds.clear();
+      char c = 0;
+      (void)::write(wake_fds_[1], &c, 1);
+    }
+  }
+  // Stopping the task waits for a read in progress, which takes the lock
+  removed.reset();
+}
+
+void SensorService::read(Sensor& sensor) {
+  std::lock_guard lock(mutex_);
+  if (sensor.subscribers.empty()) {
+    return;
+  }
+  std::optional<int64_t> value;
+  if (auto content = sensor.file.read()) {
+    int64_t parsed;
+    auto begin = content->data();
+    auto end = begin + content->size();
+    if (auto [ptr, ec] = std::from_chars(begin, end, parsed); ec == std::errc() && ptr != begin) {
+      value = parsed;
+    }
+  }
+
+  auto delay = std::chrono::milliseconds::max();
+  bool aligned = false;
+  if (!value) {
+    if (!sensor.failing) {
+      spdlog::warn("Can't read sensor {}", sensor.file.path());
+    }
+    sensor.failing = true;
+  }
+  bool changed = value && value != sensor.value;
+  for (auto& [id, subscriber] : sensor.subscribers) {
+    aligned = aligned || subscriber.aligned;
+    if (!value) {
+      // Retried at the base interval
+      delay = std::min(delay, subscriber.interval.base());
+      continue;
+    }
+    delay = std::min(delay, subscriber.interval.next(*value));
+    if (changed || !subscriber.notified) {
+      subscriber.notified = true;
+      try {
+        subscriber.callback(*value);
+      } catch (const std::exception& e) {
+        spdlog::error("Sensor {} subscriber failed: {}", sensor.file.path(), e.what());
+      }
+    }
+  }
+  if (value) {
+    sensor.failing = false;
+    sensor.value = value;
+  }
+
+  auto now = Scheduler::Clock::now();
+  if (delay >= std::chrono::duration_cast<std::chrono::milliseconds>(
+                   Scheduler::Clock::time_point::max() - now)) {
+    // "interval": "once", only read again for alarms and new subscribers
+    return;
+  }
+  auto deadline = now + delay;
+  if (aligned) {
+    // Wall clock multiples of the delay, like aligned scheduler tasks
+    auto since_tick = std::chrono::system_clock::now().time_since_epoch() % delay;
+    deadline = now + (delay - since_tick);
+  }
+  sensor.task.wake_up_at(deadline);
+}
+
+// Must be called with mutex_ held
+void SensorService::watchAlarms(Sensor& sensor) {
+  constexpr std::string_view input = "_input";
+  const auto& path = sensor.file.path();
+  if (!path.ends_with(input)) {
+    return;
+  }
+  auto prefix = path.substr(0, path.size() - input.size());
+  for (const char* suffix :
+       {"_alarm", "_min_alarm", "_max_alarm", "_crit_alarm", "_emergency_alarm"}) {
+    int fd = ::open((prefix + suffix).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      continue;
+    }
+    // Reading the attribute arms poll() for its next change
+    std::array<char, 16> buffer;
+    if (::pread(fd, buffer.data(), buffer.size(), 0) < 0) {
+      ::close(fd);
+      continue;
+    }
+    sensor.alarm_fds.push_back(fd);
+  }
+  if (sensor.alarm_fds.empty()) {
+    return;
+  }
+  if (!alarm_thread_.joinable()) {
+    if (::pipe2(wake_fds_.data(), O_CLOEXEC | O_NONBLOCK) == -1) {
+      spdlog::warn("Can't watch sensor alarms: {}", strerror(errno));
+      for (int fd : sensor.alarm_fds) {
+        ::close(fd);
+      }
+      sensor.alarm_fds.clear();
+      return;
+    }
+    alarm_thread_ = std::thread([this] { alarmLoop(); });
+  } else {
+    char c = 0;
+    (void)::write(wake_fds_[1], &c, 1);
+  }
+}
+
+void SensorService::alarmLoop() {
+  std::vector<pollfd> fds;
+  std::vector<std::string> owners;  // Sensor of each fd
+  while (true) {
+    {
+      std::lock_guard lock(mutex_);
+      for (int fd : retired_fds_) {
+        ::close(fd);
+      }
+      retired_fds_.clear();
+      fds.assign(1, {wake_fds_[0], POLLIN, 0});
+      owners.assign(1, {});
+      for (const auto& [path, sensor] : sensors_) {
+        for (int fd : sensor->alarm_fds) {
+          fds.push_back({fd, POLLPRI, 0});
+          owners.push_back(path);
+        }
+      }
+    }
+
+    if (::poll(fds.data(), fds.size(), -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      spdlog::error("Sensor alarms: poll failed: {}", strerror(errno));
+      return;
+    }
+    if ((fds[0].revents & POLLIN) != 0) {
+      std::array<char, 64> drain;
+      while (::read(wake_fds_[0], drain.data(), drain.size()) > 0) {
+      }
+    }
+    std::lock_guard lock(mutex_);
+    for (size_t i = 1; i < fds.size(); ++i) {
+      if ((fds[i].revents & (POLLPRI | POLLERR)) == 0) {
+        continue;
+      }
+      // Re-arms poll(), the retired fds are still open until the next iteration
+      std::array<char, 16> buffer;
+      (void)::pread(fds[i].fd, buffer.data(), buffer.size(), 0);
+      if (auto it = sensors_.find(owners[i]); it != sensors_.end()) {
+        it->second->task.wake_up();
+      }
+    }
+  }
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,373 @@
+#include "util/spawn.hpp"
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#ifdef __FreeBSD__
+#include <sys/procctl.h>
+#endif
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "util/exec_helper.hpp"
+
+extern char** environ;
+
+namespace waybar::util {
+
+namespace {
+
+// Builtins without an executable of the same name, they need the shell
+constexpr std::string_view SHELL_ONLY[] = {
+    ".", "alias", "bg", "break", "cd", "command", "continue", "eval", "exec", "exit", "export",
+    "fg", "getopts", "hash", "jobs", "local", "read", "readonly", "return", "set", "shift",
+    "source", "times", "trap", "type", "ulimit", "umask", "unset"};
+
+#ifdef CLONE_PIDFD
+// P_PIDFD, which glibc only declares as an enumerator
+constexpr auto WAIT_PIDFD = static_cast<idtype_t>(3);
+#endif
+
+// Everything passed to the child, prepared beforehand: it can't allocate
+struct ChildArgs {
+  const char* path;
+  char* const* argv;
+  char* const* envp;
+  int stdout_fd;
+  bool die_with_parent;
+  pid_t parent;
+  // Set by the child when exec fails, seen by the parent as the memory is shared
+  int error;
+};
+
+// Only async-signal-safe calls from here on. Not instrumented: the child runs on a stack that
+// AddressSanitizer doesn't know about, and would leave it poisoned in the shared memory.
+[[noreturn]] __attribute__((no_sanitize_address)) void execChild(ChildArgs& args) {
+  // The parent's handlers would run on its memory, restore the default ones before unblocking
+  for (int sig = 1; sig < NSIG; ++sig) {
+    struct sigaction action;
+    if (sigaction(sig, nullptr, &action) == 0 && action.sa_handler != SIG_DFL &&
+        action.sa_handler != SIG_IGN) {
+      action.sa_handler = SIG_DFL;
+      action.sa_flags = 0;
+      sigemptyset(&action.sa_mask);
+      sigaction(sig, &action, nullptr);
+    }
+  }
+  if (args.die_with_parent) {
+    int deathsig = SIGTERM;
+#ifdef __linux__
+    prctl(PR_SET_PDEATHSIG, deathsig);
+#endif
+#ifdef __FreeBSD__
+    procctl(P_PID, 0, PROC_PDEATHSIG_CTL, reinterpret_cast<void*>(&deathsig));
+#endif
+    // Waybar may already be gone
+    if (getppid() != args.parent) {
+      _exit(1);
+    }
+  }
+  setpgid(0, 0);
+  if (args.stdout_fd != -1 && dup2(args.stdout_fd, STDOUT_FILENO) == -1) {
+    args.error = errno;
+    _exit(127);
+  }
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigprocmask(SIG_SETMASK, &mask, nullptr);
+  execve(args.path, args.argv, args.envp);
+  args.error = errno;
+  _exit(127);
+}
+
+#ifdef __linux__
+__attribute__((no_sanitize_address)) int childMain(void* args) {
+  execChild(*static_cast<ChildArgs*>(args));
+}
+
+// Only used until the child execs
+constexpr size_t CHILD_STACK_SIZE = 64 * 1024;
+#endif
+
+// Resolved in the parent, so that the child only has to execve()
+std::optional<std::string> findExecutable(const std::string& name) {
+  if (name.find('/') != std::string::npos) {
+    return name;
+  }
+  const char* path = std::getenv("PATH");
+  std::string_view dirs = path != nullptr ? path : "/usr/local/bin:/usr/bin:/bin";
+  while (true) {
+    auto end = dirs.find(':');
+    auto dir = dirs.substr(0, end);
+    auto candidate = std::string(dir.empty() ? "." : dir) + "/" + name;
+    if (access(candidate.c_str(), X_OK) == 0) {
+      return candidate;
+    }
+    if (end == std::string_view::npos) {
+      return std::nullopt;
+    }
+    dirs.remove_prefix(end + 1);
+  }
+}
+
+std::mutex pidfds_mutex;
+std::unordered_map<pid_t, int> pidfds;
+
+// The pidfd of a child spawned with `pidfd`, -1 if it has none, no longer kept once taken
+int takePidfd(pid_t pid) {
+  std::lock_guard lock(pidfds_mutex);
+  auto it = pidfds.find(pid);
+  if (it == pidfds.end()) {
+    return -1;
+  }
+  int pidfd = it->second;
+  pidfds.erase(it);
+  return pidfd;
+}
+
+#ifdef CLONE_PIDFD
+// Exit status reported by waitid(), encoded like waitpid() does
+int statusOf(const siginfo_t& info) {
+  switch (info.si_code) {
+    case CLD_EXITED:
+      return W_EXITCODE(info.si_status, 0);
+    case CLD_DUMPED:
+      return W_EXITCODE(0, info.si_status) | WCOREFLAG;
+    default:
+      return W_EXITCODE(0, info.si_status);
+  }
+}
+#endif
+
+}  // namespace
+
+std::optional<std::vector<std::string>> splitSimpleCommand(std::string_view cmd) {
+  constexpr std::string_view blanks = " \t";
+  if (cmd.find_first_of("\"'\\$`;|&<>()*?[]{}~#!\n") != std::string_view::npos) {
+    return std::nullopt;
+  }
+  std::vector<std::string> argv;
+  while (true) {
+    auto start = cmd.find_first_not_of(blanks);
+    if (start == std::string_view::npos) {
+      break;
+    }
+    cmd.remove_prefix(start);
+    auto word = cmd.substr(0, cmd.find_first_of(blanks));
+    argv.emplace_back(word);
+    cmd.remove_prefix(word.size());
+  }
+  if (argv.empty() || argv.front().find('=') != std::string::npos) {
+    return std::nullopt;
+  }
+  for (auto builtin : SHELL_ONLY) {
+    if (argv.front() == builtin) {
+      return std::nullopt;
+    }
+  }
+  return argv;
+}
+
+pid_t spawn(const std::string& cmd, const SpawnOptions& options) {
+  if (auto* helper = ExecHelper::get()) {
+    auto pid = helper->spawn(cmd, options);
+    // Spawned from here when the helper just exited
+    if (pid != -1 || errno != EPIPE) {
+      return pid;
+    }
+  }
+  std::optional<std::vector<std::string>> words;
+  std::optional<std::string> executable;
+  if (options.direct) {
+    words = splitSimpleCommand(cmd);
+  }
+  if (words) {
+    executable = findExecutable(words->front());
+    if (!executable) {
+      // Left to the shell, which reports it
+      words.reset();
+    }
+  }
+  std::vector<char*> argv;
+  if (words) {
+    for (auto& word : *words) {
+      argv.push_back(word.data());
+    }
+  } else {
+    argv = {const_cast<char*>("sh"), const_cast<char*>("-c"), const_cast<char*>(cmd.c_str())};
+  }
+  argv.push_back(nullptr);
+
+  std::string output_var;
+  std::vector<char*> envp;
+  if (!options.output_name.empty()) {
+    constexpr std::string_view name = "WAYBAR_OUTPUT_NAME=";
+    output_var = std::string(name) + options.output_name;
+    envp.push_back(output_var.data());
+    for (char** var = environ; *var != nullptr; ++var) {
+      if (std::strncmp(*var, name.data(), name.size()) != 0) {
+        envp.push_back(*var);
+      }
+    }
+    envp.push_back(nullptr);
+  }
+
+  ChildArgs args{.path = executable ? executable->c_str() : "/bin/sh",
+                 .argv = argv.data(),
+                 .envp = envp.empty() ? environ : envp.data(),
+                 .stdout_fd = options.stdout_fd,
+                 .die_with_parent = options.die_with_parent,
+                 .parent = getpid(),
+                 .error = 0};
+
+  // No handler may run in the child before it resets them
+  sigset_t all;
+  sigset_t previous;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &previous);
+
+  pid_t pid;
+  int pidfd = -1;
+#ifdef __linux__
+  void* stack = mmap(nullptr, CHILD_STACK_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (stack == MAP_FAILED) {
+    pid = -1;
+  } else {
+    // Returns once the child has exec'd or exited
+    auto* top = static_cast<char*>(stack) + CHILD_STACK_SIZE;
+    int flags = CLONE_VM | CLONE_VFORK | SIGCHLD;
+#ifdef CLONE_PIDFD
+    pid = clone(childMain, top, flags | (options.pidfd ? CLONE_PIDFD : 0), &args, &pidfd);
+    if (pid == -1 && errno == EINVAL && options.pidfd) {
+      // Kernels before 5.2
+      pidfd = -1;
+      pid = clone(childMain, top, flags, &args);
+    }
+#else
+    pid = clone(childMain, top, flags, &args);
+#endif
+    int error = errno;
+    munmap(stack, CHILD_STACK_SIZE);
+    errno = error;
+  }
+#else
+  pid = fork();
+  if (pid == 0) {
+    execChild(args);
+  }
+#endif
+  int error = errno;
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+  if (pid == -1) {
+    errno = error;
+    return -1;
+  }
+  if (args.error != 0) {
+    // Exec failed, the child already exited
+    if (pidfd != -1) {
+      close(pidfd);
+    }
+    waitpid(pid, nullptr, 0);
+    errno = args.error;
+    return -1;
+  }
+  if (pidfd != -1) {
+    std::lock_guard lock(pidfds_mutex);
+    pidfds[pid] = pidfd;
+  }
+  return pid;
+}
+
+int waitChild(pid_t pid) {
+  if (auto* helper = ExecHelper::get()) {
+    if (auto status = helper->wait(pid)) {
+      return *status;
+    }
+  }
+  int pidfd = takePidfd(pid);
+#ifdef CLONE_PIDFD
+  if (pidfd != -1) {
+    siginfo_t info;
+    int rc;
+    do {
+      rc = waitid(WAIT_PIDFD, pidfd, &info, WEXITED);
+    } while (rc == -1 && errno == EINTR);
+    close(pidfd);
+    if (rc == 0) {
+      return statusOf(info);
+    }
+    // P_PIDFD is only supported since Linux 5.4, the child is still there to be waited for
+  }
+#else
+  if (pidfd != -1) {
+    close(pidfd);
+  }
+#endif
+  int status = -1;
+  while (waitpid(pid, &status, 0) == -1) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return status;
+}
+
+std::optional<int> tryWaitChild(pid_t pid) {
+  if (auto* helper = ExecHelper::get()) {
+    if (helper->running(pid)) {
+      return std::nullopt;
+    }
+    // Exited, doesn't block
+    if (auto status = helper->wait(pid)) {
+      return *status;
+    }
+  }
+#ifdef CLONE_PIDFD
+  int pidfd = -1;
+  {
+    std::lock_guard lock(pidfds_mutex);
+    if (auto it = pidfds.find(pid); it != pidfds.end()) {
+      pidfd = it->second;
+    }
+  }
+  if (pidfd != -1) {
+    siginfo_t info = {};
+    int rc;
+    do {
+      rc = waitid(WAIT_PIDFD, pidfd, &info, WEXITED | WNOHANG);
+    } while (rc == -1 && errno == EINTR);
+    if (rc == 0 && info.si_pid == 0) {
+      return std::nullopt;
+    }
+    if (rc == 0) {
+      close(takePidfd(pid));
+      return statusOf(info);
+    }
+  }
+#endif
+  int status = -1;
+  pid_t rc;
+  do {
+    rc = waitpid(pid, &status, WNOHANG);
+  } while (rc == -1 && errno == EINTR);
+  if (rc == 0) {
+    return std::nullopt;
+  }
+  if (int pidfd = takePidfd(pid); pidfd != -1) {
+    close(pidfd);
+  }
+  return rc == -1 ? -1 : status;
+}
+
+}  // namespace waybar::util
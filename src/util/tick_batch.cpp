@@ -0,0 +1,54 @@
+#include "util/tick_batch.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace waybar::util {
+
+TickBatch& TickBatch::inst() {
+  static TickBatch batch;
+  return batch;
+}
+
+TickBatch::TickBatch() { dp_.connect(sigc::mem_fun(*this, &TickBatch::run)); }
+
+void TickBatch::post(const void* owner, std::function<void()> fn) {
+  {
+    std::lock_guard lock(mutex_);
+    if (std::ranges::any_of(pending_, [owner](const auto& item) { return item.first == owner; })) {
+      return;
+    }
+    pending_.emplace_back(owner, std::move(fn));
+    if (pending_.size() > 1) {
+      // The dispatcher has already been emitted for this batch
+      return;
+    }
+    ++emissions_;
+  }
+  dp_.emit();
+}
+
+void TickBatch::cancel(const void* owner) {
+  std::lock_guard lock(mutex_);
+  std::erase_if(pending_, [owner](const auto& item) { return item.first == owner; });
+}
+
+void TickBatch::run() {
+  decltype(pending_) batch;
+  {
+    std::lock_guard lock(mutex_);
+    batch.swap(pending_);
+    updates_ += batch.size();
+    if (emissions_ >= 100) {
+      spdlog::debug("tick batch: {} module updates in {} main loop wakeups", updates_, emissions_);
+      emissions_ = 0;
+      updates_ = 0;
+    }
+  }
+  for (auto& [owner, fn] : batch) {
+    fn();
+  }
+}
+
+}  // namespace waybar::util
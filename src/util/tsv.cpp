@@ -0,0 +1,68 @@
+#include "util/tsv.hpp"
+
+#include <charconv>
+#include <cmath>
+
+namespace waybar::util::tsv {
+
+size_t split(std::string_view line, std::span<std::string_view> fields) {
+  size_t count = 0;
+  while (true) {
+    auto end = line.find('\t');
+    if (count < fields.size()) {
+      fields[count] = line.substr(0, end);
+    }
+    ++count;
+    if (end == std::string_view::npos) {
+      break;
+    }
+    line.remove_prefix(end + 1);
+  }
+  for (size_t i = count; i < fields.size(); ++i) {
+    fields[i] = {};
+  }
+  return count;
+}
+
+void unescape(std::string_view field, std::string& out) {
+  auto escape = field.find('\\');
+  // Most fields have nothing to resolve
+  out.assign(field.substr(0, escape));
+  while (escape != std::string_view::npos) {
+    field.remove_prefix(escape);
+    if (field.size() < 2) {
+      out += field;
+      return;
+    }
+    switch (field[1]) {
+      case 't':
+        out += '\t';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case '\\':
+        out += '\\';
+        break;
+      default:
+        out += field.substr(0, 2);
+    }
+    field.remove_prefix(2);
+    escape = field.find('\\');
+    out += field.substr(0, escape);
+  }
+}
+
+int toInt(std::string_view field, int fallback) {
+  double value = 0;
+  auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+  if (ec != std::errc() || end != field.data() + field.size() || !std::isfinite(value)) {
+    return fallback;
+  }
+  return static_cast<int>(std::lround(value));
+}
+
+}  // namespace waybar::util::tsv
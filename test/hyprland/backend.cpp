@@ -57,3 +57,25 @@ TEST_CASE_METHOD(IPCTestFixture, "getSocket1Reply throws on no socket", "[getSoc
 
   CHECK_THROWS(getSocket1Reply(request));
 }
+
+TEST_CASE_METHOD(IPCTestFixture, "splitBatchReply splits batched replies",
+                 "[getSocket1JsonReplies]") {
+  // Hyprland doesn't put a delimiter after the last reply
+  auto parts = splitBatchReply("[{\"id\": 1}]\n\n\n{\n  \"id\": 2\n}\n\n\n[]", 3);
+  REQUIRE(parts.size() == 3);
+  CHECK(parts[0] == "[{\"id\": 1}]");
+  CHECK(parts[1] == "{\n  \"id\": 2\n}");
+  CHECK(parts[2] == "[]");
+
+  // A trailing delimiter is tolerated
+  parts = splitBatchReply("{}\n\n\n[]\n\n\n", 2);
+  REQUIRE(parts.size() == 2);
+  CHECK(parts[1] == "[]");
+
+  // More or fewer replies than queries
+  CHECK(splitBatchReply("{}\n\n\n[]\n\n\n[]", 2).empty());
+  CHECK(splitBatchReply("{}", 2).empty());
+
+  // Hyprland versions without [[BATCH]] support answer with a single error
+  CHECK(splitBatchReply("unknown request", 2).empty());
+}
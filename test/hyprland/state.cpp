@@ -0,0 +1,146 @@
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "modules/hyprland/state.hpp"
+#include "util/json.hpp"
+
+namespace hyprland = waybar::modules::hyprland;
+
+namespace {
+
+void load(hyprland::State& state) {
+  waybar::util::JsonParser parser;
+  state.reset(parser.parse(R"([
+      {"id": 0, "name": "DP-1", "focused": true,
+       "activeWorkspace": {"id": 1, "name": "1"}, "specialWorkspace": {"id": 0, "name": ""}},
+      {"id": 1, "name": "DP-2", "focused": false,
+       "activeWorkspace": {"id": 2, "name": "2"}, "specialWorkspace": {"id": 0, "name": ""}}
+    ])"),
+              parser.parse(R"([
+      {"id": 1, "name": "1", "monitor": "DP-1", "windows": 1, "hasfullscreen": false,
+       "lastwindow": "0xa1", "lastwindowtitle": "vim"},
+      {"id": 2, "name": "2", "monitor": "DP-2", "windows": 0, "hasfullscreen": false,
+       "lastwindow": "0x0", "lastwindowtitle": ""}
+    ])"),
+              parser.parse(R"([
+      {"address": "0xa1", "mapped": true, "workspace": {"id": 1, "name": "1"},
+       "class": "kitty", "title": "vim", "initialClass": "kitty", "initialTitle": "kitty",
+       "floating": false, "fullscreen": 0},
+      {"address": "0xb2", "mapped": false, "workspace": {"id": 1, "name": "1"},
+       "class": "hidden", "title": "", "initialClass": "", "initialTitle": "",
+       "floating": false, "fullscreen": 0}
+    ])"),
+              parser.parse(R"({"address": "0xa1"})"));
+}
+
+}  // namespace
+
+TEST_CASE("State loads the query replies", "[State]") {
+  hyprland::State state;
+  load(state);
+
+  REQUIRE(state.clients().size() == 1);
+  REQUIRE(state.clients(1).size() == 1);
+  REQUIRE(state.clients(2).empty());
+  REQUIRE(state.client("a1").has_value());
+  // Not modelled, only mapped windows are kept
+  REQUIRE_FALSE(state.client("a1")->isMember("mapped"));
+  REQUIRE_FALSE(state.client("a1")->isMember("hidden"));
+  REQUIRE(state.client("0xa1")->operator[]("title").asString() == "vim");
+  REQUIRE_FALSE(state.client("b2").has_value());
+  REQUIRE(state.workspaces().size() == 2);
+  REQUIRE(state.activeWorkspace()["id"].asInt() == 1);
+  REQUIRE(state.activeWorkspace()["windows"].asInt() == 1);
+  REQUIRE(state.activeWorkspace("DP-2")["id"].asInt() == 2);
+  REQUIRE((*state.workspace("2"))["monitor"].asString() == "DP-2");
+  REQUIRE_FALSE(state.workspace("3").has_value());
+}
+
+TEST_CASE("State applies window events", "[State]") {
+  hyprland::State state;
+  load(state);
+
+  SECTION("openwindow and closewindow") {
+    REQUIRE(state.apply("openwindow", "c3,1,firefox,Title, with commas"));
+    auto client = state.client("c3");
+    REQUIRE(client.has_value());
+    REQUIRE((*client)["address"].asString() == "0xc3");
+    REQUIRE((*client)["title"].asString() == "Title, with commas");
+    REQUIRE((*client)["workspace"]["name"].asString() == "1");
+    REQUIRE(state.activeWorkspace()["windows"].asInt() == 2);
+
+    REQUIRE(state.apply("closewindow", "c3"));
+    REQUIRE_FALSE(state.client("c3").has_value());
+    REQUIRE(state.activeWorkspace()["windows"].asInt() == 1);
+  }
+
+  SECTION("movewindowv2") {
+    REQUIRE(state.apply("movewindowv2", "a1,2,2"));
+    REQUIRE((*state.client("a1"))["workspace"]["id"].asInt() == 2);
+    REQUIRE(state.activeWorkspace("DP-1")["windows"].asInt() == 0);
+    REQUIRE(state.activeWorkspace("DP-2")["windows"].asInt() == 1);
+  }
+
+  SECTION("windowtitlev2 also updates the last window title") {
+    REQUIRE(state.apply("windowtitlev2", "a1,man ls"));
+    REQUIRE((*state.client("a1"))["title"].asString() == "man ls");
+    REQUIRE(state.activeWorkspace()["lastwindowtitle"].asString() == "man ls");
+  }
+
+  SECTION("fullscreen applies to the active window") {
+    REQUIRE(state.apply("fullscreen", "1"));
+    REQUIRE(state.activeWorkspace()["hasfullscreen"].asBool());
+    REQUIRE(state.apply("fullscreen", "0"));
+    REQUIRE_FALSE(state.activeWorkspace()["hasfullscreen"].asBool());
+  }
+
+  SECTION("unknown events are ignored") { REQUIRE_FALSE(state.apply("submap", "resize")); }
+}
+
+TEST_CASE("State applies workspace and monitor events", "[State]") {
+  hyprland::State state;
+  load(state);
+
+  SECTION("createworkspacev2 then workspacev2") {
+    REQUIRE(state.apply("createworkspacev2", "3,web"));
+    REQUIRE(state.apply("workspacev2", "3,web"));
+    auto active = state.activeWorkspace();
+    REQUIRE(active["name"].asString() == "web");
+    REQUIRE(active["monitor"].asString() == "DP-1");
+  }
+
+  SECTION("renameworkspace keeps name lookups working") {
+    REQUIRE(state.apply("renameworkspace", "1,code"));
+    REQUIRE(state.apply("openwindow", "c3,code,kitty,shell"));
+    REQUIRE((*state.client("c3"))["workspace"]["id"].asInt() == 1);
+    REQUIRE((*state.workspace("code"))["windows"].asInt() == 2);
+    REQUIRE_FALSE(state.workspace("1").has_value());
+  }
+
+  SECTION("moveworkspacev2 and destroyworkspacev2") {
+    REQUIRE(state.apply("moveworkspacev2", "2,2,DP-1"));
+    REQUIRE(state.workspaces().size() == 2);
+    REQUIRE(state.apply("destroyworkspacev2", "2,2"));
+    REQUIRE(state.workspaces().size() == 1);
+  }
+
+  SECTION("focusedmonv2 changes the focused monitor") {
+    REQUIRE(state.apply("focusedmonv2", "DP-2,2"));
+    REQUIRE(state.activeWorkspace()["id"].asInt() == 2);
+    for (const auto& monitor : state.monitors()) {
+      REQUIRE(monitor["focused"].asBool() == (monitor["name"].asString() == "DP-2"));
+    }
+  }
+
+  SECTION("activespecial") {
+    REQUIRE(state.apply("createworkspacev2", "-98,special:scratch"));
+    REQUIRE(state.apply("activespecial", "special:scratch,DP-1"));
+    auto monitor = state.monitor("DP-1");
+    REQUIRE(monitor.has_value());
+    REQUIRE((*monitor)["specialWorkspace"]["name"].asString() == "special:scratch");
+    REQUIRE_FALSE(state.monitor("HDMI-1").has_value());
+  }
+}
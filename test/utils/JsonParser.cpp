@@ -42,4 +42,60 @@ TEST_CASE("Json with chinese characters", "[json]") {
     Json::Value jsonValue = parser.parse(stringToTest);
     REQUIRE(jsonValue["test"].asString() == "你好");
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Json with escaped backslashes", "[json]") {
+  SECTION("Only \\x escape sequences are replaced") {
+    std::string stringToTest = R"({"test": "C:\\x\xab"})";
+    waybar::util::JsonParser parser;
+    Json::Value jsonValue = parser.parse(stringToTest);
+    REQUIRE(jsonValue["test"].asString() == "C:\\x\u00ab");
+  }
+}
+
+TEST_CASE("Selective json", "[json]") {
+  std::string stringToTest = R"({
+    "id": 1, "name": "root", "rect": {"x": 0, "y": 0},
+    "nodes": [
+      {"id": -2, "name": "a \"quoted\" \u00e9\ud83d\ude0a\xab", "focused": true,
+       "marks": [], "skipped": [1, {"nested": ["}", "]"]}, null, 1.5e3]},
+      {"id": 18446744073709551615, "name": "b", "focused": false, "ratio": 0.25}
+    ]
+  })";
+  waybar::util::JsonParser parser;
+  const waybar::util::JsonParser::Keys keys = {"id", "name", "nodes", "focused", "ratio"};
+
+  SECTION("Keeps the listed members only") {
+    Json::Value jsonValue = parser.parse(stringToTest, keys);
+    REQUIRE_FALSE(jsonValue.isMember("rect"));
+    REQUIRE_FALSE(jsonValue["nodes"][0].isMember("marks"));
+    REQUIRE_FALSE(jsonValue["nodes"][0].isMember("skipped"));
+    REQUIRE(jsonValue["nodes"].size() == 2);
+  }
+
+  SECTION("Kept members have the same values as a full parse") {
+    Json::Value selective = parser.parse(stringToTest, keys);
+    Json::Value full = parser.parse(stringToTest);
+    REQUIRE(selective["id"] == full["id"]);
+    REQUIRE(selective["name"] == full["name"]);
+    for (Json::ArrayIndex i = 0; i < full["nodes"].size(); ++i) {
+      for (const auto& key : {"id", "name", "focused", "ratio"}) {
+        REQUIRE(selective["nodes"][i][key] == full["nodes"][i][key]);
+      }
+    }
+    REQUIRE(selective["nodes"][0]["name"].asString() == "a \"quoted\" é😊\u00ab");
+  }
+
+  SECTION("Reports invalid json") {
+    REQUIRE_THROWS(parser.parse(R"({"id": 1)", keys));
+    REQUIRE_THROWS(parser.parse(R"({"other": [1, 2}})", keys));
+    REQUIRE_THROWS(parser.parse(R"({"id": 1} trailing)", keys));
+    // Strings cut short after a backslash, in a skipped and in a parsed member
+    REQUIRE_THROWS(parser.parse(R"({"x": "ab\)", keys));
+    REQUIRE_THROWS(parser.parse(R"({"name": "ab\)", keys));
+    // Lone and mismatched surrogates
+    REQUIRE_THROWS(parser.parse(R"({"name": "\ud83d"})", keys));
+    REQUIRE_THROWS(parser.parse(R"({"name": "\ud83d\u0041"})", keys));
+    REQUIRE_THROWS(parser.parse(R"({"name": "\ude0a"})", keys));
+  }
+}
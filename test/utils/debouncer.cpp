@@ -0,0 +1,44 @@
+#include "util/debouncer.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Debouncer coalesces a burst into one run", "[debouncer][thread][util]") {
+  std::atomic<int> count = 0;
+  waybar::util::Debouncer debouncer(20ms, 1s, [&] { ++count; });
+
+  for (int i = 0; i < 10; ++i) {
+    debouncer.trigger();
+    std::this_thread::sleep_for(1ms);
+  }
+  // Nothing pending at registration
+  REQUIRE(count == 0);
+  std::this_thread::sleep_for(100ms);
+  REQUIRE(count == 1);
+
+  auto [triggers, runs] = debouncer.takeStats();
+  REQUIRE(triggers == 10);
+  REQUIRE(runs == 1);
+  REQUIRE(debouncer.takeStats() == std::make_pair<uint64_t, uint64_t>(0, 0));
+}
+
+TEST_CASE("Debouncer runs at the latest after the max latency", "[debouncer][thread][util]") {
+  std::atomic<int> count = 0;
+  waybar::util::Debouncer debouncer(20ms, 50ms, [&] { ++count; });
+
+  // Triggers keep coming faster than the delay for 200ms
+  auto end = std::chrono::steady_clock::now() + 200ms;
+  while (std::chrono::steady_clock::now() < end) {
+    debouncer.trigger();
+    std::this_thread::sleep_for(5ms);
+  }
+  REQUIRE(count >= 2);
+}
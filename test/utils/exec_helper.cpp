@@ -0,0 +1,91 @@
+#include "util/exec_helper.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace waybar::util;
+
+namespace {
+
+std::pair<std::string, int> run(const std::string& cmd, SpawnOptions options) {
+  int fd[2];
+  if (pipe2(fd, O_CLOEXEC) != 0) {
+    return {"", -1};
+  }
+  options.stdout_fd = fd[1];
+  options.pidfd = true;
+  auto pid = spawn(cmd, options);
+  close(fd[1]);
+  std::string output;
+  char buffer[256];
+  ssize_t n;
+  while ((n = read(fd[0], buffer, sizeof(buffer))) > 0) {
+    output.append(buffer, n);
+  }
+  close(fd[0]);
+  return {output, pid > 0 ? waitChild(pid) : -1};
+}
+
+}  // namespace
+
+TEST_CASE("Spawn commands from the exec helper", "[spawn][util]") {
+  ExecHelper::start();
+  REQUIRE(ExecHelper::get() != nullptr);
+
+  SECTION("Children belong to the helper") {
+    auto [output, status] = run("echo $PPID; exit 4", {});
+    REQUIRE(!output.empty());
+    REQUIRE(std::stoi(output) != getpid());
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 4);
+    // Reaped by the helper
+    REQUIRE(waitpid(-1, nullptr, WNOHANG) <= 0);
+  }
+
+  SECTION("Options are passed along") {
+    REQUIRE(run("printenv WAYBAR_OUTPUT_NAME", {.output_name = "DP-1"}).first == "DP-1\n");
+    auto [output, status] = run("uname -s", {.direct = true});
+    REQUIRE(!output.empty());
+    REQUIRE(WEXITSTATUS(status) == 0);
+    REQUIRE(WEXITSTATUS(run("waybar-no-such-command", {.direct = true}).second) == 127);
+  }
+
+  SECTION("Children that aren't waited for") {
+    auto pid = spawn("exit 0", {});
+    REQUIRE(pid > 0);
+    // Returns once the child exited, without a status to report
+    REQUIRE(waitChild(pid) == -1);
+  }
+
+  SECTION("Concurrent requests") {
+    std::atomic<int> failures = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([t, &failures] {
+        for (int i = 0; i < 10; ++i) {
+          int code = t * 10 + i;
+          auto arg = std::to_string(code);
+          auto [output, status] = run("echo " + arg + "; exit " + arg, {});
+          if (output != arg + "\n" || WEXITSTATUS(status) != code) {
+            ++failures;
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    REQUIRE(failures == 0);
+  }
+}
@@ -0,0 +1,90 @@
+#include "util/format_template.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <array>
+#include <string_view>
+
+using waybar::util::FormatTemplate;
+
+TEST_CASE("FormatTemplate records the referenced fields", "[format][util]") {
+  FormatTemplate format{"{icon} {usage0}% {used:0.1f}{{literal}} {:>{width}}"};
+  REQUIRE(format.uses("icon"));
+  REQUIRE(format.uses("used"));
+  REQUIRE(format.uses("width"));
+  REQUIRE_FALSE(format.uses("literal"));
+  REQUIRE_FALSE(format.uses("usage"));
+  REQUIRE(format.usesPrefix("usage"));
+  REQUIRE_FALSE(format.usesPrefix("total"));
+}
+
+TEST_CASE("FormatTemplate formats like fmt", "[format][util]") {
+  const std::vector<std::string> formats = {
+      "",
+      "plain",
+      "{}%",
+      "{0}% {0:>4}",
+      "{icon} {percentage}%",
+      "{used:0.1f}G/{total:0.1f}G {{braces}}",
+      "{percentage:>3}% {}",
+      "{:>{width}}",
+  };
+  for (const auto &format : formats) {
+    auto expected = fmt::format(fmt::runtime(format), 42, fmt::arg("icon", "*"),
+                                fmt::arg("percentage", 42), fmt::arg("used", 1.234),
+                                fmt::arg("total", 15.6), fmt::arg("width", 5));
+    FormatTemplate compiled{format};
+    REQUIRE(compiled.format(42, fmt::arg("icon", "*"), fmt::arg("percentage", 42),
+                            fmt::arg("used", 1.234), fmt::arg("total", 15.6),
+                            fmt::arg("width", 5)) == expected);
+  }
+}
+
+TEST_CASE("FormatTemplate reports fmt errors", "[format][util]") {
+  REQUIRE_THROWS_AS(FormatTemplate{"{missing}"}.format(fmt::arg("icon", "*")), fmt::format_error);
+  REQUIRE_THROWS_AS(FormatTemplate{"{unclosed"}.format(fmt::arg("icon", "*")), fmt::format_error);
+  REQUIRE_THROWS_AS(FormatTemplate{"{} {0}"}.format(1), fmt::format_error);
+}
+
+TEST_CASE("FormatTemplate resolves fields on demand", "[format][util]") {
+  std::vector<std::string> looked_up;
+  auto lookup = [&](std::string_view name, auto emit) {
+    looked_up.emplace_back(name);
+    if (name == "usage") {
+      emit(42);
+    } else if (name == "icon") {
+      emit("*");
+    } else if (name.starts_with("usage")) {
+      emit(std::string(name.substr(5)));
+    }
+  };
+  static constexpr std::array<std::string_view, 2> positional = {"usage", "icon"};
+
+  FormatTemplate format{"{}% {usage:>3}% [{usage3}]"};
+  REQUIRE(format.formatLookup(lookup, positional) == "42%  42% [3]");
+  REQUIRE(looked_up == std::vector<std::string>{"usage", "usage", "usage3"});
+
+  // Positional fields map to the names in order
+  REQUIRE(FormatTemplate{"{1} {0}%"}.formatLookup(lookup, positional) == "* 42%");
+  static constexpr std::array<std::string_view, 2> value_width = {"value", "width"};
+  REQUIRE(FormatTemplate{"{:>{}}"}.formatLookup(
+              [](std::string_view name, auto emit) { name == "value" ? emit(7) : emit(3); },
+              value_width) == "  7");
+  REQUIRE_THROWS_AS(FormatTemplate{"{2}"}.formatLookup(lookup, positional), fmt::format_error);
+  REQUIRE_THROWS_AS(FormatTemplate{"{}"}.formatLookup(lookup), fmt::format_error);
+
+  // Nested fields go through fmt with the referenced names only
+  looked_up.clear();
+  REQUIRE(FormatTemplate{"{usage:>{usage1}}"}.formatLookup(
+              [&](std::string_view name, auto emit) {
+                looked_up.emplace_back(name);
+                name == "usage" ? emit(42) : emit(4);
+              }) == "  42");
+  REQUIRE(looked_up == std::vector<std::string>{"usage", "usage1"});
+
+  REQUIRE_THROWS_AS(FormatTemplate{"{missing}"}.formatLookup(lookup), fmt::format_error);
+}
@@ -0,0 +1,127 @@
+#include "util/line_reader.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using waybar::util::LineStream;
+
+namespace {
+
+template <typename Pred>
+bool waitFor(Pred pred, std::chrono::milliseconds timeout = 2s) {
+  auto end = std::chrono::steady_clock::now() + timeout;
+  while (!pred()) {
+    if (std::chrono::steady_clock::now() > end) return false;
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+void write(int fd, std::string_view data) { REQUIRE(::write(fd, data.data(), data.size()) > 0); }
+
+struct Lines {
+  std::vector<std::string> get() {
+    std::lock_guard lock(mutex);
+    return lines;
+  }
+
+  std::mutex mutex;
+  std::vector<std::string> lines;
+  std::atomic<bool> ended = false;
+};
+
+LineStream watch(int fd, Lines& lines) {
+  return LineStream(
+      fd,
+      [&lines](std::string_view line) {
+        std::lock_guard lock(lines.mutex);
+        lines.lines.emplace_back(line);
+      },
+      [&lines] { lines.ended = true; });
+}
+
+}  // namespace
+
+TEST_CASE("LineReader splits the output into lines", "[line_reader][thread][util]") {
+  using Strings = std::vector<std::string>;
+  std::array<int, 2> fds;
+  REQUIRE(pipe2(fds.data(), O_CLOEXEC) == 0);
+  Lines lines;
+  auto stream = watch(fds[0], lines);
+
+  write(fds[1], "first\nsec");
+  REQUIRE(waitFor([&] { return lines.get().size() == 1; }));
+  write(fds[1], "ond\n\nthird");
+  REQUIRE(waitFor([&] { return lines.get().size() == 3; }));
+  REQUIRE(lines.get() == Strings{"first", "second", ""});
+
+  // Like getline(), the last line is complete at the end of the output
+  ::close(fds[1]);
+  REQUIRE(waitFor([&] { return lines.ended.load(); }));
+  REQUIRE(lines.get() == Strings{"first", "second", "", "third"});
+}
+
+TEST_CASE("LineReader reads every stream from one thread", "[line_reader][thread][util]") {
+  constexpr int count = 32;
+  std::vector<std::array<int, 2>> pipes(count);
+  std::vector<Lines> lines(count);
+  std::vector<LineStream> streams;
+  for (int i = 0; i < count; ++i) {
+    REQUIRE(pipe2(pipes[i].data(), O_CLOEXEC) == 0);
+    streams.push_back(watch(pipes[i][0], lines[i]));
+  }
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < count; ++i) {
+      write(pipes[i][1], std::to_string(i) + "\n");
+    }
+  }
+  for (int i = 0; i < count; ++i) {
+    REQUIRE(waitFor([&] { return lines[i].get().size() == 3; }));
+    REQUIRE(lines[i].get().back() == std::to_string(i));
+  }
+
+  // Removed streams are closed, the pipes lose their reader once the reader thread's poll()
+  // returns
+  streams.clear();
+  for (auto& fds : pipes) {
+    REQUIRE(waitFor([&] {
+      pollfd pfd = {fds[1], POLLOUT, 0};
+      return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLERR) != 0;
+    }));
+    ::close(fds[1]);
+  }
+}
+
+TEST_CASE("LineReader streams can be removed from their callbacks", "[line_reader][thread][util]") {
+  std::array<int, 2> fds;
+  REQUIRE(pipe2(fds.data(), O_CLOEXEC) == 0);
+  std::atomic<int> calls = 0;
+  LineStream stream;
+  stream = LineStream(
+      fds[0],
+      [&](std::string_view /*line*/) {
+        stream.reset();
+        ++calls;
+      },
+      [] {});
+  write(fds[1], "a\nb\nc\n");
+  REQUIRE(waitFor([&] { return calls > 0; }));
+  std::this_thread::sleep_for(20ms);
+  REQUIRE(calls == 1);
+  ::close(fds[1]);
+}
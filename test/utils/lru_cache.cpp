@@ -0,0 +1,44 @@
+#include "util/lru_cache.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <string>
+
+using waybar::util::LruCache;
+
+TEST_CASE("LruCache evicts the least recently used value", "[lru][util]") {
+  LruCache<int> cache{2};
+  cache.insert("a", 1);
+  cache.insert("b", 2);
+  // Makes b the least recently used
+  REQUIRE(cache.find("a") != nullptr);
+  cache.insert("c", 3);
+
+  REQUIRE(cache.size() == 2);
+  REQUIRE(cache.find("b") == nullptr);
+  REQUIRE(*cache.find("a") == 1);
+  REQUIRE(*cache.find("c") == 3);
+
+  // Replacing a value doesn't evict anything
+  cache.insert("a", 4);
+  REQUIRE(cache.size() == 2);
+  REQUIRE(*cache.find("a") == 4);
+  REQUIRE(*cache.find("c") == 3);
+}
+
+TEST_CASE("LruCache copies start empty", "[lru][util]") {
+  LruCache<std::string> cache{4};
+  cache.insert("key", "value");
+  LruCache<std::string> copy = cache;
+  REQUIRE(copy.size() == 0);
+  REQUIRE(copy.capacity() == 4);
+  REQUIRE(copy.find("key") == nullptr);
+
+  // Moves keep the entries
+  LruCache<std::string> moved = std::move(cache);
+  REQUIRE(*moved.find("key") == "value");
+}
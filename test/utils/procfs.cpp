@@ -0,0 +1,118 @@
+#include "util/procfs.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace waybar::util;
+
+TEST_CASE("Parse /proc/stat cpu lines", "[procfs][util]") {
+  const std::string stat =
+      "cpu  100 0 50 800 50 0 0 0 0 0\n"
+      "cpu0 50 0 25 400 25 0 0 0 0 0\n"
+      "cpu2 50 0 25 400 25 0 0 0 0 0\n"
+      "cpu100 1 1 1 1 1 0 0 0 0 0\n"
+      "intr 12345 0 0\n"
+      "cpu9 1 1 1 1 1\n";
+  std::vector<std::tuple<long, uint64_t, uint64_t>> times;
+  procfs::forEachCpuTime(stat, [&](long cpu, uint64_t idle, uint64_t total) {
+    times.emplace_back(cpu, idle, total);
+  });
+
+  // Parsing stops at the first non cpu line
+  REQUIRE(times.size() == 4);
+  REQUIRE(times[0] == std::make_tuple(-1L, 850UL, 1000UL));
+  REQUIRE(times[1] == std::make_tuple(0L, 425UL, 500UL));
+  REQUIRE(times[2] == std::make_tuple(2L, 425UL, 500UL));
+  REQUIRE(times[3] == std::make_tuple(100L, 2UL, 5UL));
+}
+
+TEST_CASE("Parse /proc/meminfo", "[procfs][util]") {
+  const std::string meminfo =
+      "MemTotal:       32651212 kB\n"
+      "MemFree:         1234567 kB\n"
+      "MemAvailable:   20000000 kB\n"
+      "HugePages_Total:       0\n"
+      "Garbage line\n";
+  std::map<std::string, uint64_t> values;
+  procfs::forEachKeyValue(meminfo, [&](std::string_view key, uint64_t value) {
+    values.emplace(std::string(key), value);
+  });
+
+  REQUIRE(values.size() == 4);
+  REQUIRE(values["MemTotal"] == 32651212);
+  REQUIRE(values["MemAvailable"] == 20000000);
+  REQUIRE(values["HugePages_Total"] == 0);
+}
+
+TEST_CASE("Parse /proc/net/dev", "[procfs][util]") {
+  const std::string netdev =
+      "Inter-|   Receive                                                |  Transmit\n"
+      " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs "
+      "drop fifo colls carrier compressed\n"
+      "    lo:  123456     100    0    0    0     0          0         0   123456     100    0 "
+      "   0    0     0       0          0\n"
+      "enp0s31f6:9876543210 5000 0 0 0 0 0 12 1234567890 4000 0 0 0 0 0 0\n";
+
+  auto lo = procfs::netDevBytes(netdev, "lo");
+  REQUIRE(lo.has_value());
+  REQUIRE(lo->first == 123456);
+  REQUIRE(lo->second == 123456);
+
+  // Large counters run into the colon
+  auto eth = procfs::netDevBytes(netdev, "enp0s31f6");
+  REQUIRE(eth.has_value());
+  REQUIRE(eth->first == 9876543210ULL);
+  REQUIRE(eth->second == 1234567890ULL);
+
+  REQUIRE_FALSE(procfs::netDevBytes(netdev, "wlan0").has_value());
+}
+
+TEST_CASE("Parse uevent properties", "[procfs][util]") {
+  std::map<std::string, std::string> props;
+  auto collect = [&](std::string_view key, std::string_view value) {
+    props.emplace(key, value);
+  };
+
+  procfs::forEachUeventProperty(
+      "DEVTYPE=power_supply\n"
+      "POWER_SUPPLY_NAME=BAT0\n"
+      "POWER_SUPPLY_STATUS=Not charging\n"
+      "POWER_SUPPLY_ENERGY_NOW=41230000\n"
+      "POWER_SUPPLY_MODEL_NAME=\n",
+      collect);
+  REQUIRE(props.size() == 5);
+  REQUIRE(props["POWER_SUPPLY_STATUS"] == "Not charging");
+  REQUIRE(props["POWER_SUPPLY_ENERGY_NOW"] == "41230000");
+  REQUIRE(props["POWER_SUPPLY_MODEL_NAME"].empty());
+
+  // Netlink messages start with a header without '=' and separate the fields with NULs
+  props.clear();
+  constexpr char message[] =
+      "change@/devices/LNXSYSTM:00/PNP0C0A:00/power_supply/BAT0\0ACTION=change\0"
+      "SUBSYSTEM=power_supply\0POWER_SUPPLY_CAPACITY=87";
+  procfs::forEachUeventProperty({message, sizeof(message) - 1}, collect, '\0');
+  REQUIRE(props.size() == 3);
+  REQUIRE(props["ACTION"] == "change");
+  REQUIRE(props["SUBSYSTEM"] == "power_supply");
+  REQUIRE(props["POWER_SUPPLY_CAPACITY"] == "87");
+}
+
+TEST_CASE("Re-read a file through a persistent descriptor", "[procfs][util]") {
+  procfs::File file{"/proc/self/stat"};
+  auto first = file.read();
+  REQUIRE(first.has_value());
+  REQUIRE(!first->empty());
+  auto second = file.read();
+  REQUIRE(second.has_value());
+  REQUIRE(second->starts_with(std::to_string(getpid())));
+
+  procfs::File missing{"/nonexistent/waybar"};
+  REQUIRE_FALSE(missing.read().has_value());
+}
@@ -0,0 +1,125 @@
+// Compares the procfs readers against the ifstream based parsers they replaced.
+// Run with `meson test --benchmark procfs`.
+#include <fmt/core.h>
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "util/procfs.hpp"
+
+using namespace waybar::util;
+
+namespace {
+
+// Reference implementations, as they were in the modules
+
+std::vector<std::tuple<size_t, size_t>> legacyCpuTimes() {
+  std::ifstream info("/proc/stat");
+  std::vector<std::tuple<size_t, size_t>> cpuinfo;
+  std::string line;
+  while (getline(info, line)) {
+    if (line.substr(0, 3).compare("cpu") != 0) {
+      break;
+    }
+    std::stringstream sline(line.substr(5));
+    std::vector<size_t> times;
+    for (size_t time = 0; sline >> time; times.push_back(time));
+    size_t idle_time = 0;
+    size_t total_time = 0;
+    if (times.size() >= 5) {
+      idle_time = times[3] + times[4];
+      total_time = std::accumulate(times.begin(), times.end(), 0);
+    }
+    cpuinfo.emplace_back(idle_time, total_time);
+  }
+  return cpuinfo;
+}
+
+std::map<std::string, uint64_t> legacyMeminfo() {
+  std::ifstream info("/proc/meminfo");
+  std::map<std::string, uint64_t> meminfo;
+  std::string line;
+  while (getline(info, line)) {
+    auto posDelim = line.find(':');
+    if (posDelim == std::string::npos) {
+      continue;
+    }
+    meminfo[line.substr(0, posDelim)] = std::stol(line.substr(posDelim + 1));
+  }
+  return meminfo;
+}
+
+unsigned long long legacyNetDev(const std::string& ifname) {
+  std::ifstream netdev("/proc/net/dev");
+  std::string line;
+  std::getline(netdev, line);
+  std::getline(netdev, line);
+  while (std::getline(netdev, line)) {
+    std::istringstream iss(line);
+    std::string ifacename;
+    iss >> ifacename;
+    ifacename.pop_back();
+    if (ifacename != ifname) {
+      continue;
+    }
+    unsigned long long r = 0ull;
+    iss >> r;
+    return r;
+  }
+  return 0;
+}
+
+template <typename Fn>
+void run(const char* name, Fn&& fn) {
+  constexpr int iterations = 20000;
+  uint64_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    sink += fn();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  fmt::print("{:<24} {:>8} ns/iter (checksum {})\n", name,
+             std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations,
+             sink % 10);
+}
+
+}  // namespace
+
+int main() {
+  procfs::File stat{"/proc/stat"};
+  procfs::File meminfo{"/proc/meminfo"};
+  procfs::File netdev{"/proc/net/dev"};
+
+  run("stat (ifstream)", [] { return legacyCpuTimes().size(); });
+  run("stat (procfs)", [&] {
+    size_t count = 0;
+    if (auto content = stat.read()) {
+      procfs::forEachCpuTime(*content, [&](long, uint64_t, uint64_t) { ++count; });
+    }
+    return count;
+  });
+
+  run("meminfo (ifstream)", [] { return legacyMeminfo()["MemTotal"]; });
+  run("meminfo (procfs)", [&] {
+    uint64_t total = 0;
+    if (auto content = meminfo.read()) {
+      procfs::forEachKeyValue(*content, [&](std::string_view key, uint64_t value) {
+        if (key == "MemTotal") total = value;
+      });
+    }
+    return total;
+  });
+
+  run("net/dev (ifstream)", [] { return legacyNetDev("lo") > 0; });
+  run("net/dev (procfs)", [&] {
+    auto content = netdev.read();
+    return content && procfs::netDevBytes(*content, "lo").value_or(std::make_pair(0, 0)).first > 0;
+  });
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "util/regex_collection.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <regex>
+
+using waybar::util::LiteralPattern;
+using waybar::util::RegexCollection;
+
+TEST_CASE("LiteralPattern only accepts literal text and wildcards", "[regex][util]") {
+  REQUIRE(LiteralPattern::parse("class<firefox>"));
+  REQUIRE(LiteralPattern::parse("^title<.*youtube.*>$"));
+  REQUIRE(LiteralPattern::parse("org\\.mozilla\\.firefox"));
+  REQUIRE_FALSE(LiteralPattern::parse("class<(firefox|chromium)>"));
+  REQUIRE_FALSE(LiteralPattern::parse("title<\\d+>"));
+  REQUIRE_FALSE(LiteralPattern::parse("class<kitty>+"));
+  REQUIRE_FALSE(LiteralPattern::parse("a$b"));
+  REQUIRE_FALSE(LiteralPattern::parse("caf\xc3\xa9"));
+}
+
+TEST_CASE("LiteralPattern matches like regex_search", "[regex][util]") {
+  const std::vector<std::string> patterns = {
+      "",          "firefox", "FireFox",   "^class<firefox>", "title<.*youtube.*>$",
+      "^$",        "$",       "^a.*b.*c$", "a.*?b",           "org\\.mozilla",
+      ".*",        "^.*",     "x.*x",      "^ab.*ab$",        "class<kitty> title<.*>",
+  };
+  const std::vector<std::string> values = {
+      "",
+      "class<firefox> title<YouTube - Mozilla Firefox>",
+      "class<org.mozilla.firefox> title<>",
+      "class<kitty> title<~/src>",
+      "abc",
+      "aXbYc",
+      "ab",
+      "aba",
+      "abab",
+      "x",
+      "xx",
+      "a-b",
+  };
+  for (const auto& pattern : patterns) {
+    auto literal = LiteralPattern::parse(pattern);
+    REQUIRE(literal);
+    std::regex regex{pattern, std::regex_constants::icase};
+    for (const auto& value : values) {
+      INFO(pattern << " / " << value);
+      REQUIRE(literal->matches(LiteralPattern::lower(value)) == std::regex_search(value, regex));
+    }
+  }
+}
+
+TEST_CASE("RegexCollection returns the first matching rule by priority", "[regex][util]") {
+  Json::Value map;
+  map["class<firefox>"] = "firefox";
+  map["title<.*youtube.*>"] = "youtube";
+  map["class<(kitty|foot)>"] = "terminal";
+  map["class<kitty> title<(.*)>"] = "in $1";
+  auto priority = [](std::string& key) { return key.find("title") != std::string::npos ? 1 : 0; };
+  RegexCollection rules{map, "default", priority};
+
+  bool matched = false;
+  std::string value = "class<firefox> title<YouTube>";
+  REQUIRE(rules.get(value, matched) == "youtube");
+  REQUIRE(matched);
+  value = "class<firefox> title<Inbox>";
+  REQUIRE(rules.get(value) == "firefox");
+  value = "class<foot> title<~>";
+  REQUIRE(rules.get(value) == "terminal");
+  value = "class<kitty> title<~/src>";
+  REQUIRE(rules.get(value) == "in ~/src");
+
+  matched = false;
+  value = "class<mpv> title<video>";
+  REQUIRE(rules.get(value, matched) == "default");
+  REQUIRE_FALSE(matched);
+
+  // Cached results report whether they matched as well
+  matched = false;
+  value = "class<firefox> title<YouTube>";
+  REQUIRE(rules.get(value, matched) == "youtube");
+  REQUIRE(matched);
+}
+
+TEST_CASE("RegexCollection keeps the most recently used results", "[regex][util]") {
+  Json::Value map;
+  map["^title<(.*)>$"] = "$1";
+  RegexCollection rules{map, "", waybar::util::default_priority_function, 2};
+
+  std::string a = "title<a>";
+  std::string b = "title<b>";
+  std::string c = "title<c>";
+  REQUIRE(rules.get(a) == "a");
+  REQUIRE(rules.get(b) == "b");
+  REQUIRE(rules.get(a) == "a");
+  REQUIRE(rules.cache_size() == 2);
+  // Evicts b, the least recently used
+  REQUIRE(rules.get(c) == "c");
+  REQUIRE(rules.cache_size() == 2);
+  for (int i = 0; i < 1000; ++i) {
+    std::string value = "title<" + std::to_string(i) + ">";
+    REQUIRE(rules.get(value) == std::to_string(i));
+  }
+  REQUIRE(rules.cache_size() == 2);
+  REQUIRE(rules.get(a) == "a");
+
+  RegexCollection copy = rules;
+  REQUIRE(copy.cache_size() == 0);
+  REQUIRE(copy.get(b) == "b");
+  REQUIRE(copy.cache_size() == 1);
+}
@@ -0,0 +1,70 @@
+// Compares the per-title cost of the "rewrite" rules as modules used to apply them, compiling every
+// rule on every call, with a RewriteRules compiled once, on a config of 50 rules.
+// Run with `meson test --benchmark rewrite`.
+#include <fmt/core.h>
+
+#include <chrono>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "util/rewrite_string.hpp"
+
+using namespace waybar::util;
+
+namespace {
+
+// Reference implementation, as rewriteString was
+std::string legacyRewriteString(const std::string& value, const Json::Value& rules) {
+  std::string res = value;
+  for (auto it = rules.begin(); it != rules.end(); ++it) {
+    const std::regex rule{it.key().asString(), std::regex_constants::icase};
+    if (std::regex_match(value, rule)) {
+      res = std::regex_replace(res, rule, it->asString());
+    }
+  }
+  return res;
+}
+
+template <typename Fn>
+void run(const char* name, Fn&& fn) {
+  constexpr int iterations = 2000;
+  size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    sink += fn(i);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  fmt::print("{:<28} {:>8} ns/title (checksum {})\n", name,
+             std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations,
+             sink % 10);
+}
+
+}  // namespace
+
+int main() {
+  Json::Value rules;
+  for (int i = 0; i < 48; ++i) {
+    rules[fmt::format("(.*) - Application {}", i)] = fmt::format("[{}] $1", i);
+  }
+  rules["(.*) - Mozilla Firefox"] = "🌎 $1";
+  rules["(.*) - zsh"] = "> [$1]";
+
+  // A browser going through tabs: a few titles coming back, and new ones
+  std::vector<std::string> titles;
+  for (int i = 0; i < 64; ++i) {
+    titles.push_back(fmt::format("Tab {} - Mozilla Firefox", i));
+  }
+
+  run("regex per call (legacy)",
+      [&](int i) { return legacyRewriteString(titles[i % 8], rules).size(); });
+  run("rewriteString", [&](int i) { return rewriteString(titles[i % 8], rules).size(); });
+
+  RewriteRules compiled{rules};
+  run("RewriteRules (new titles)", [&](int i) {
+    // Always a miss
+    return compiled.apply(fmt::format("Tab {} - Mozilla Firefox", 1000 + i)).size();
+  });
+  run("RewriteRules (recent titles)", [&](int i) { return compiled.apply(titles[i % 8]).size(); });
+  return 0;
+}
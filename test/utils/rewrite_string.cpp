@@ -0,0 +1,100 @@
+#include "util/rewrite_string.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <regex>
+
+using waybar::util::RewriteRules;
+
+namespace {
+
+// Compiles and applies every rule, as rewriteString used to
+std::string reference(const std::string& value, const Json::Value& rules) {
+  std::string res = value;
+  for (auto it = rules.begin(); it != rules.end(); ++it) {
+    try {
+      const std::regex rule{it.key().asString(), std::regex_constants::icase};
+      if (std::regex_match(value, rule)) {
+        res = std::regex_replace(res, rule, it->asString());
+      }
+    } catch (const std::regex_error&) {
+    }
+  }
+  return res;
+}
+
+}  // namespace
+
+TEST_CASE("RewriteRules rewrites like rewriteString", "[rewrite][util]") {
+  Json::Value rules;
+  rules["(.*) - Mozilla Firefox"] = "🌎 $1";
+  rules["(.*) - zsh"] = "> [$1]";
+  rules[".*youtube.*"] = "$& (video)";
+  rules["(unterminated"] = "skipped";
+  RewriteRules compiled{rules};
+
+  const std::vector<std::string> values = {
+      "",
+      "Inbox - Mozilla Firefox",
+      "YouTube - Mozilla Firefox",
+      "~/src - zsh",
+      "no rule matches this",
+  };
+  for (const auto& value : values) {
+    INFO(value);
+    REQUIRE(compiled.apply(value) == reference(value, rules));
+    // From the cache
+    REQUIRE(compiled.apply(value) == reference(value, rules));
+    REQUIRE(waybar::util::rewriteString(value, rules) == reference(value, rules));
+  }
+  REQUIRE(compiled.apply("Inbox - Mozilla Firefox") == "🌎 Inbox");
+}
+
+TEST_CASE("RewriteRules without rules returns the value", "[rewrite][util]") {
+  RewriteRules none;
+  REQUIRE(none.empty());
+  REQUIRE(none.apply("title") == "title");
+  RewriteRules notAnObject{Json::Value("rule")};
+  REQUIRE(notAnObject.empty());
+  REQUIRE(notAnObject.apply("title") == "title");
+}
+
+TEST_CASE("RewriteRules skips the regex of rules missing their literal text", "[rewrite][util]") {
+  Json::Value rules;
+  rules["(.*) - MOZILLA Firefox"] = "$1";
+  rules["a+b?c\\.d(e|f)"] = "first";
+  rules["[xyz]+-(alpha|beta)-\\d{2}"] = "second";
+  rules["^(?:Foo)?bar.*$"] = "third";
+  RewriteRules compiled{rules};
+
+  const std::vector<std::string> values = {
+      "Inbox - Mozilla Firefox", "aac.de", "ac.df", "c.de", "zz-beta-42", "x-gamma-42",
+      "foobar baz",              "bar",    "fo bar"};
+  for (const auto& value : values) {
+    INFO(value);
+    REQUIRE(compiled.apply(value) == reference(value, rules));
+  }
+  REQUIRE(compiled.apply("Inbox - Mozilla Firefox") == "Inbox");
+}
+
+TEST_CASE("RewriteRules keeps the rules with escapes standing for other text", "[rewrite][util]") {
+  Json::Value rules;
+  rules["foo\\x20bar"] = "hex";
+  rules["\\x41bc"] = "upper";
+  rules["\\u0062ox.*"] = "unicode";
+  rules["(a)\\1b"] = "backreference";
+  rules["tab\\tx"] = "tab";
+  RewriteRules compiled{rules};
+
+  REQUIRE(compiled.apply("foo bar") == "hex");
+  const std::vector<std::string> values = {"foo bar", "Abc", "box office", "aab", "tab\tx",
+                                           "41bc",    "20bar"};
+  for (const auto& value : values) {
+    INFO(value);
+    REQUIRE(compiled.apply(value) == reference(value, rules));
+  }
+}
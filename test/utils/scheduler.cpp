@@ -0,0 +1,130 @@
+#include "util/scheduler.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace {
+// Standalone instance, so tests don't share state with Scheduler::inst()
+class TestScheduler : public waybar::util::Scheduler {
+ public:
+  TestScheduler() : Scheduler(2) {}
+};
+
+template <typename Pred>
+bool waitFor(Pred pred, std::chrono::milliseconds timeout = 1s) {
+  auto end = std::chrono::steady_clock::now() + timeout;
+  while (!pred()) {
+    if (std::chrono::steady_clock::now() > end) return false;
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+}  // namespace
+
+TEST_CASE("Scheduler runs tasks on their interval", "[scheduler][thread][util]") {
+  TestScheduler scheduler;
+  std::atomic<int> count = 0;
+
+  auto id = scheduler.add(10ms, [&] { ++count; });
+  // First run happens right away, then every interval
+  REQUIRE(waitFor([&] { return count >= 3; }));
+  scheduler.remove(id);
+
+  auto after_remove = count.load();
+  std::this_thread::sleep_for(50ms);
+  REQUIRE(count == after_remove);
+}
+
+TEST_CASE("Scheduler wakeUp runs a task early", "[scheduler][thread][util]") {
+  TestScheduler scheduler;
+  std::atomic<int> count = 0;
+
+  auto id = scheduler.add(std::chrono::milliseconds::max(), [&] { ++count; });
+  REQUIRE(waitFor([&] { return count == 1; }));
+  std::this_thread::sleep_for(20ms);
+  REQUIRE(count == 1);
+
+  scheduler.wakeUp(id);
+  REQUIRE(waitFor([&] { return count == 2; }));
+  scheduler.remove(id);
+}
+
+TEST_CASE("Scheduler wakeUpAt moves the next run", "[scheduler][thread][util]") {
+  TestScheduler scheduler;
+  std::atomic<int> count = 0;
+
+  auto id = scheduler.add(std::chrono::milliseconds::max(), [&] { ++count; });
+  REQUIRE(waitFor([&] { return count == 1; }));
+
+  scheduler.wakeUpAt(id, std::chrono::steady_clock::now() + 1h);
+  // A later call replaces the deadline
+  scheduler.wakeUpAt(id, std::chrono::steady_clock::now() + 30ms);
+  std::this_thread::sleep_for(10ms);
+  REQUIRE(count == 1);
+  REQUIRE(waitFor([&] { return count == 2; }));
+  scheduler.remove(id);
+}
+
+TEST_CASE("Scheduler never runs a task concurrently with itself", "[scheduler][thread][util]") {
+  TestScheduler scheduler;
+  std::atomic<int> running = 0;
+  std::atomic<int> max_running = 0;
+  std::atomic<int> count = 0;
+
+  auto id = scheduler.add(1ms, [&] {
+    auto now = ++running;
+    max_running = std::max(max_running.load(), now);
+    std::this_thread::sleep_for(5ms);
+    --running;
+    ++count;
+  });
+  for (int i = 0; i < 10; ++i) {
+    scheduler.wakeUp(id);
+    std::this_thread::sleep_for(1ms);
+  }
+  REQUIRE(waitFor([&] { return count >= 5; }));
+  scheduler.remove(id);
+  REQUIRE(max_running == 1);
+}
+
+TEST_CASE("Scheduler remove waits for a running callback", "[scheduler][thread][util]") {
+  TestScheduler scheduler;
+  std::atomic<bool> started = false;
+  std::atomic<bool> finished = false;
+
+  auto id = scheduler.add(1s, [&] {
+    started = true;
+    std::this_thread::sleep_for(50ms);
+    finished = true;
+  });
+  REQUIRE(waitFor([&] { return started.load(); }));
+  scheduler.remove(id);
+  REQUIRE(finished);
+}
+
+TEST_CASE("Scheduler aligns tasks on wall clock ticks", "[scheduler][thread][util]") {
+  TestScheduler scheduler;
+  std::atomic<int> count = 0;
+  std::atomic<int> misaligned = 0;
+
+  auto id = scheduler.add(
+      50ms,
+      [&] {
+        // The first run is immediate, the following ones land on multiples of the interval
+        if (count++ > 0 && std::chrono::system_clock::now().time_since_epoch() % 50ms > 20ms) {
+          ++misaligned;
+        }
+      },
+      true);
+  REQUIRE(waitFor([&] { return count >= 4; }));
+  scheduler.remove(id);
+  REQUIRE(misaligned == 0);
+}
@@ -0,0 +1,131 @@
+#include "util/sensor.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "util/scope_guard.hpp"
+
+using namespace std::chrono_literals;
+using waybar::util::AdaptiveInterval;
+using waybar::util::SensorSubscription;
+
+namespace {
+
+template <typename Pred>
+bool waitFor(Pred pred, std::chrono::milliseconds timeout = 2s) {
+  auto end = std::chrono::steady_clock::now() + timeout;
+  while (!pred()) {
+    if (std::chrono::steady_clock::now() > end) return false;
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+// A new directory only this test uses
+std::filesystem::path makeTempDir() {
+  auto pattern = (std::filesystem::temp_directory_path() / "waybar_sensor_XXXXXX").string();
+  if (mkdtemp(pattern.data()) == nullptr) {
+    throw std::filesystem::filesystem_error("mkdtemp", pattern,
+                                            std::error_code(errno, std::generic_category()));
+  }
+  return pattern;
+}
+
+void write(const std::filesystem::path& path, const std::string& content) {
+  std::ofstream file(path, std::ios::trunc);
+  file << content;
+}
+
+}  // namespace
+
+TEST_CASE("AdaptiveInterval backs off while the value is stable", "[sensor][util]") {
+  AdaptiveInterval interval({.interval = 10s, .critical = 90000, .tolerance = 500, .margin = 5000});
+  REQUIRE(interval.next(50000) == 10s);
+  for (int i = 0; i < AdaptiveInterval::STABLE_READS - 1; ++i) {
+    REQUIRE(interval.next(50200) == 10s);
+  }
+  REQUIRE(interval.next(49800) == 20s);
+  for (int i = 0; i < 10 * AdaptiveInterval::STABLE_READS; ++i) {
+    interval.next(50000);
+  }
+  REQUIRE(interval.next(50000) == 10s * AdaptiveInterval::MAX_BACKOFF);
+
+  // A change resets it
+  REQUIRE(interval.next(52000) == 10s);
+}
+
+TEST_CASE("AdaptiveInterval doesn't take a slow drift as stable", "[sensor][util]") {
+  AdaptiveInterval interval({.interval = 10s, .tolerance = 500});
+  for (int i = 0; i < 20; ++i) {
+    interval.next(50000 + i * 300);
+  }
+  REQUIRE(interval.next(56000) <= 20s);
+}
+
+TEST_CASE("AdaptiveInterval speeds up near the critical value", "[sensor][util]") {
+  AdaptiveInterval interval({.interval = 10s, .critical = 90000, .tolerance = 500, .margin = 5000});
+  REQUIRE(interval.next(86000) == 2500ms);
+  REQUIRE(interval.next(95000) == 2500ms);
+
+  // Not below MIN_INTERVAL, nor above the base interval
+  AdaptiveInterval fast({.interval = 2s, .critical = 90000, .margin = 5000});
+  REQUIRE(fast.next(90000) == AdaptiveInterval::MIN_INTERVAL);
+  AdaptiveInterval faster({.interval = 500ms, .critical = 90000, .margin = 5000});
+  REQUIRE(faster.next(90000) == 500ms);
+}
+
+TEST_CASE("AdaptiveInterval can be disabled", "[sensor][util]") {
+  AdaptiveInterval interval({.interval = 10s, .critical = 90000, .adaptive = false});
+  for (int i = 0; i < 20; ++i) {
+    REQUIRE(interval.next(95000) == 10s);
+  }
+}
+
+TEST_CASE("SensorService shares a sensor between subscribers", "[sensor][thread][util]") {
+  auto dir = makeTempDir();
+  // Also removed when a REQUIRE fails
+  waybar::util::ScopeGuard remove_dir([&dir] {
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+  });
+  auto input = dir / "temp1_input";
+  write(input, "42000\n");
+  // Watched with poll(POLLPRI), which a regular file never reports
+  write(dir / "temp1_crit_alarm", "0\n");
+
+  std::atomic<int64_t> first = 0;
+  std::atomic<int64_t> second = 0;
+  std::atomic<int> calls = 0;
+  AdaptiveInterval::Policy policy{.interval = 20ms, .adaptive = false};
+  {
+    SensorSubscription a(input.string(), policy, false, [&](int64_t value) {
+      first = value;
+      ++calls;
+    });
+    REQUIRE(waitFor([&] { return first == 42000; }));
+    SensorSubscription b(input.string(), policy, false, [&](int64_t value) { second = value; });
+    // The new subscriber gets the current value, the others are only called on changes
+    REQUIRE(waitFor([&] { return second == 42000; }));
+    std::this_thread::sleep_for(100ms);
+    REQUIRE(calls == 1);
+
+    write(input, "43500\n");
+    REQUIRE(waitFor([&] { return first == 43500 && second == 43500; }));
+    REQUIRE(calls == 2);
+  }
+
+  // Unsubscribed
+  write(input, "44000\n");
+  std::this_thread::sleep_for(100ms);
+  REQUIRE(first == 43500);
+}
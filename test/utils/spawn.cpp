@@ -0,0 +1,114 @@
+#include "util/spawn.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace waybar::util;
+
+namespace {
+
+// Runs `cmd` with its stdout captured, returns the output and waitpid() status
+std::pair<std::string, int> run(const std::string& cmd, SpawnOptions options) {
+  int fd[2];
+  REQUIRE(pipe2(fd, O_CLOEXEC) == 0);
+  options.stdout_fd = fd[1];
+  options.pidfd = true;
+  auto pid = spawn(cmd, options);
+  close(fd[1]);
+  REQUIRE(pid > 0);
+  std::string output;
+  char buffer[256];
+  ssize_t n;
+  while ((n = read(fd[0], buffer, sizeof(buffer))) > 0) {
+    output.append(buffer, n);
+  }
+  close(fd[0]);
+  return {output, waitChild(pid)};
+}
+
+}  // namespace
+
+TEST_CASE("Split commands that don't need a shell", "[spawn][util]") {
+  using Argv = std::vector<std::string>;
+  REQUIRE(splitSimpleCommand("playerctl  metadata\t--format title") ==
+          Argv{"playerctl", "metadata", "--format", "title"});
+  REQUIRE(splitSimpleCommand("/usr/bin/pgrep -x spotify") ==
+          Argv{"/usr/bin/pgrep", "-x", "spotify"});
+  REQUIRE(splitSimpleCommand("notify-send a=b") == Argv{"notify-send", "a=b"});
+
+  for (const char* cmd : {"", "  ", "echo $HOME", "echo 'a b'", "a | b", "a; b", "a && b",
+                          "a > /tmp/out", "ls *.txt", "ls ~", "echo `date`", "a # comment",
+                          "LANG=C date", "cd /tmp", "exit 1", "a\nb"}) {
+    REQUIRE_FALSE(splitSimpleCommand(cmd).has_value());
+  }
+}
+
+TEST_CASE("Spawn commands", "[spawn][util]") {
+  SECTION("Through the shell") {
+    auto [output, status] = run("echo hello; exit 3", {});
+    REQUIRE(output == "hello\n");
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 3);
+  }
+
+  SECTION("Directly") {
+    auto [output, status] = run("printf %s-%s a b", {.direct = true});
+    REQUIRE(output == "a-b");
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+  }
+
+  SECTION("Unknown commands are reported by the shell") {
+    auto [output, status] = run("waybar-no-such-command", {.direct = true});
+    REQUIRE(WEXITSTATUS(status) == 127);
+  }
+
+  SECTION("Output name") {
+    setenv("WAYBAR_OUTPUT_NAME", "stale", 1);
+    auto [output, status] = run("echo $WAYBAR_OUTPUT_NAME", {.output_name = "DP-1"});
+    REQUIRE(output == "DP-1\n");
+    unsetenv("WAYBAR_OUTPUT_NAME");
+  }
+
+  SECTION("Own process group, unblocked signals") {
+    sigset_t mask;
+    sigset_t previous;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, &previous);
+    auto pid = spawn("sleep 10", {.die_with_parent = true, .direct = true, .pidfd = true});
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    REQUIRE(pid > 0);
+    REQUIRE(getpgid(pid) == pid);
+    REQUIRE(killpg(pid, SIGTERM) == 0);
+    auto status = waitChild(pid);
+    REQUIRE(WIFSIGNALED(status));
+    REQUIRE(WTERMSIG(status) == SIGTERM);
+  }
+
+  SECTION("Without blocking") {
+    auto pid = spawn("sleep 10", {.direct = true, .pidfd = true});
+    REQUIRE(pid > 0);
+    REQUIRE_FALSE(tryWaitChild(pid).has_value());
+    REQUIRE(killpg(pid, SIGKILL) == 0);
+    std::optional<int> status;
+    for (int i = 0; i < 1000 && !status; ++i) {
+      status = tryWaitChild(pid);
+      usleep(1000);
+    }
+    REQUIRE(status.has_value());
+    REQUIRE(WIFSIGNALED(*status));
+    REQUIRE(WTERMSIG(*status) == SIGKILL);
+  }
+}
@@ -0,0 +1,51 @@
+#include "util/tsv.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+#include <array>
+#include <string>
+#include <string_view>
+
+using namespace waybar::util;
+
+TEST_CASE("Split tab separated lines", "[tsv][util]") {
+  std::array<std::string_view, 3> fields;
+
+  REQUIRE(tsv::split("a\tbc\t\t", fields) == 4);
+  REQUIRE(fields[0] == "a");
+  REQUIRE(fields[1] == "bc");
+  REQUIRE(fields[2].empty());
+
+  // Fields missing from the line are cleared
+  REQUIRE(tsv::split("text", fields) == 1);
+  REQUIRE(fields[0] == "text");
+  REQUIRE(fields[1].empty());
+  REQUIRE(fields[2].empty());
+
+  REQUIRE(tsv::split("", fields) == 1);
+  REQUIRE(fields[0].empty());
+}
+
+TEST_CASE("Unescape tab separated fields", "[tsv][util]") {
+  std::string out = "previous";
+  tsv::unescape("plain", out);
+  REQUIRE(out == "plain");
+  tsv::unescape(R"(a\tb\nc\\d\re)", out);
+  REQUIRE(out == "a\tb\nc\\d\re");
+  tsv::unescape(R"(\x\)", out);
+  REQUIRE(out == R"(\x\)");
+  tsv::unescape("", out);
+  REQUIRE(out.empty());
+}
+
+TEST_CASE("Parse tab separated numbers", "[tsv][util]") {
+  REQUIRE(tsv::toInt("42") == 42);
+  REQUIRE(tsv::toInt("42.6") == 43);
+  REQUIRE(tsv::toInt("-3") == -3);
+  REQUIRE(tsv::toInt("") == 0);
+  REQUIRE(tsv::toInt("12%", -1) == -1);
+  REQUIRE(tsv::toInt("nan", -1) == -1);
+}